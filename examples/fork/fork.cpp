@@ -23,6 +23,9 @@ print_info(const char* _name)
     fflush(stderr);
 }
 
+// the children exit via _exit() instead of exit() when true
+bool child_quick_exit = false;
+
 int
 run(const char* _name, int nchildren)
 {
@@ -51,6 +54,11 @@ run(const char* _name, int nchildren)
                 std::thread{ _sleep }.join();
                 omnitrace_user_push_region("child_process");
                 printf("[%s][%i] child job complete\n", _name, getpid());
+                if(child_quick_exit)
+                {
+                    fflush(stdout);
+                    _exit(EXIT_SUCCESS);
+                }
                 exit(EXIT_SUCCESS);
             }
             else
@@ -123,6 +131,7 @@ main(int argc, char** argv)
     int _nrep  = 1;
     if(argc > 1) _nfork = std::stoi(argv[1]);
     if(argc > 2) _nrep = std::stoi(argv[2]);
+    if(argc > 3) child_quick_exit = (std::string{ argv[3] } == "_exit");
 
     print_info(argv[0]);
     for(int i = 0; i < _nrep; ++i)
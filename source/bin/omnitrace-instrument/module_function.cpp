@@ -26,6 +26,7 @@
 #include "internal_libs.hpp"
 #include "log.hpp"
 #include "omnitrace-instrument.hpp"
+#include "profile_guided.hpp"
 
 #include <timemory/utility/join.hpp>
 
@@ -66,7 +67,10 @@ module_function::module_function(module_t* mod, procedure_t* proc)
 {
     OMNITRACE_ADD_LOG_ENTRY("Adding function", function_name, "from module", module_name);
 
-    if(!function->isInstrumentable())
+    instrumentable = function->isInstrumentable();
+    system_lib     = module->isSystemLib();
+
+    if(!instrumentable)
     {
         verbprintf(1,
                    "Warning! module function generated for un-instrumentable "
@@ -87,7 +91,7 @@ module_function::module_function(module_t* mod, procedure_t* proc)
     for(int i = 0; i <= instruction_category_t::c_NoCategory; ++i)
         instruction_types[static_cast<instruction_category_t>(i)] = 0;
 
-    if(function->isInstrumentable())
+    if(instrumentable)
     {
         // this information is potentially not available and
         // appears to be the cause of a segfault in testing
@@ -114,6 +118,15 @@ module_function::module_function(module_t* mod, procedure_t* proc)
                     {
                         instruction_types[iitr.first.getCategory()] += 1;
                     }
+                    if(!instruction_exclude.empty())
+                    {
+                        auto _instrss = std::stringstream{};
+                        for(auto&& iitr : _instructions)
+                            _instrss << " " << iitr.first.format();
+                        auto _instr = _instrss.str();
+                        if(!_instr.empty())
+                            instruction_text.emplace_back(_instr.substr(1));
+                    }
                     // num_instructions += _instructions.size();
                     if(debug_print || verbose_level > 3 || instr_print)
                         instructions.emplace_back(std::move(_instructions));
@@ -137,6 +150,33 @@ module_function::module_function(module_t* mod, procedure_t* proc)
     }
 }
 
+void
+module_function::query_dyninst() const
+{
+    if(queried) return;
+    queried = true;
+
+    if(instrumentable)
+    {
+        entry_points = query_instr(function, BPatch_entry);
+        exit_points  = query_instr(function, BPatch_exit);
+    }
+
+    if(flow_graph) dynamic_callsites = flow_graph->containsDynamicCallsites();
+
+    procedure_vec_t _overlapping{};
+    overlapping = function->findOverlapping(_overlapping);
+
+    if(!caller_include.empty())
+    {
+        std::vector<BPatch_point*> call_points;
+        function->getCallPoints(call_points);
+        callee_names.reserve(call_points.size());
+        for(const auto& call_point : call_points)
+            callee_names.emplace_back(get_name(call_point->getCalledFunction()));
+    }
+}
+
 void
 module_function::write_header(std::ostream& os)
 {
@@ -165,14 +205,13 @@ module_function::should_instrument() const
 }
 
 bool
-module_function::should_coverage_instrument() const
+module_function::is_excluded() const
 {
     // hard constraints
-    if(!is_instrumentable()) return false;
-    if(!can_instrument_entry()) return false;
-    if(is_internal_constrained()) return false;
-    if(is_module_constrained()) return false;
-    if(is_routine_constrained()) return false;
+    if(!is_instrumentable()) return true;
+    if(is_internal_constrained()) return true;
+    if(is_module_constrained()) return true;
+    if(is_routine_constrained()) return true;
 
     // should be before user selection
     constexpr int absolute_min_instructions = 2;
@@ -182,11 +221,20 @@ module_function::should_coverage_instrument() const
             2, "Skipping", "function",
             TIMEMORY_JOIN("-", "less-than", absolute_min_instructions, "instructions"),
             function_name);
-        return false;
+        return true;
     }
 
     // user selection
-    if(is_user_excluded()) return false;
+    return is_user_excluded();
+}
+
+bool
+module_function::should_coverage_instrument() const
+{
+    if(is_excluded()) return false;
+
+    // hard constraints which require the Dyninst queries
+    if(!can_instrument_entry()) return false;
 
     if(is_overlapping_constrained()) return false;
     if(is_entry_trap_constrained()) return false;
@@ -205,27 +253,11 @@ module_function::should_coverage_instrument() const
 bool
 module_function::should_instrument(bool coverage) const
 {
-    // hard constraints
-    if(!is_instrumentable()) return false;
+    if(is_excluded()) return false;
+
+    // hard constraints which require the Dyninst queries
     if(!can_instrument_entry()) return false;
     if(!coverage && !can_instrument_exit()) return false;
-    if(is_internal_constrained()) return false;
-    if(is_module_constrained()) return false;
-    if(is_routine_constrained()) return false;
-
-    // should be before user selection
-    constexpr int absolute_min_instructions = 2;
-    if(num_instructions < absolute_min_instructions)
-    {
-        messages.emplace_back(
-            2, "Skipping", "function",
-            TIMEMORY_JOIN("-", "less-than", absolute_min_instructions, "instructions"),
-            function_name);
-        return false;
-    }
-
-    // user selection
-    if(is_user_excluded()) return false;
 
     // should be applied before dynamic-callsite check
     if(is_overlapping_constrained()) return false;
@@ -246,6 +278,10 @@ module_function::should_instrument(bool coverage) const
         if(is_visibility_constrained()) return false;
     }
 
+    // the measured call frequency and time supersede the size estimates
+    if(!coverage && profile_guided::is_enabled())
+        return !is_profile_guided_constrained() && !is_instruction_constrained();
+
     if(is_address_range_constrained()) return false;
     if(is_num_instructions_constrained()) return false;
     if(is_instruction_constrained()) return false;
@@ -256,7 +292,7 @@ module_function::should_instrument(bool coverage) const
 bool
 module_function::is_instrumentable() const
 {
-    if(!function->isInstrumentable())
+    if(!instrumentable)
     {
         messages.emplace_back(2, "Skipping", "module", "not-instrumentable", module_name);
         return false;
@@ -388,8 +424,8 @@ module_function::is_user_excluded() const
 bool
 module_function::is_overlapping() const
 {
-    procedure_vec_t _overlapping{};
-    return function->findOverlapping(_overlapping);
+    query_dyninst();
+    return overlapping;
 }
 
 symbol_linkage_t
@@ -444,19 +480,25 @@ module_function::is_internal_constrained() const
     auto _module_base = _basename(module_name);
     auto _module_real = _realpath(module_name);
 
-    if(std::regex_search(module_name, std::regex{ "lib(omnitrace|timemory|perfetto)" }))
+    static const auto _lib_regex    = std::regex{ "lib(omnitrace|timemory|perfetto)" };
+    static const auto _source_regex = std::regex{
+        ".*/source/lib/(core|common|binary|omnitrace|omnitrace-dl|omnitrace-user)/.*/"
+        ".*\\.(h|c|cpp|hpp)$"
+    };
+    static const auto _omni_regex     = std::regex{ "9omnitrace|omnitrace(::|_)" };
+    static const auto _timemory_regex = std::regex{ "3tim|tim::|timemory(::|_)" };
+    static const auto _perfetto_regex = std::regex{ "9perfetto|perfetto(::|_)" };
+
+    if(std::regex_search(module_name, _lib_regex))
         return _report("Excluding", "module", "omnitrace", 3);
-    else if(std::regex_match(module_name,
-                             std::regex{ ".*/source/lib/"
-                                         "(core|common|binary|omnitrace|omnitrace-dl|"
-                                         "omnitrace-user)/.*/.*\\.(h|c|cpp|hpp)$" }))
+    else if(std::regex_match(module_name, _source_regex))
         return _report("Excluding", "module", "omnitrace", 3);
 
-    if(std::regex_search(function_name, std::regex{ "9omnitrace|omnitrace(::|_)" }))
+    if(std::regex_search(function_name, _omni_regex))
         return _report("Excluding", "function", "omnitrace", 3);
-    else if(std::regex_search(function_name, std::regex{ "3tim|tim::|timemory(::|_)" }))
+    else if(std::regex_search(function_name, _timemory_regex))
         return _report("Excluding", "function", "timemory", 3);
-    else if(std::regex_search(function_name, std::regex{ "9perfetto|perfetto(::|_)" }))
+    else if(std::regex_search(function_name, _perfetto_regex))
         return _report("Excluding", "function", "perfetto", 3);
 
     if(_gnu_libs.find(module_name) != _gnu_libs.end() ||
@@ -495,7 +537,7 @@ module_function::is_module_constrained() const
         return true;
     };
 
-    if(module->isSystemLib()) return _report("Excluding", "system library", 3);
+    if(system_lib) return _report("Excluding", "system library", 3);
 
     // always instrument these modules
     if(module_name == "DEFAULT_MODULE" || module_name == "LIBRARY_MODULE")
@@ -640,9 +682,8 @@ module_function::is_overlapping_constrained() const
 bool
 module_function::contains_dynamic_callsites() const
 {
-    if(flow_graph) return flow_graph->containsDynamicCallsites();
-
-    return false;
+    query_dyninst();
+    return dynamic_callsites;
 }
 
 bool
@@ -650,12 +691,10 @@ module_function::contains_user_callsite() const
 {
     if(caller_include.empty()) return false;
 
-    std::vector<BPatch_point*> call_points;
-    function->getCallPoints(call_points);
-    for(const auto& call_point : call_points)
+    query_dyninst();
+    for(const auto& itr : callee_names)
     {
-        if(check_regex_restrictions(
-               std::string(get_name(call_point->getCalledFunction())), caller_include))
+        if(check_regex_restrictions(itr, caller_include))
         {
             messages.emplace_back(2, "Forcing", "function", "caller-include-regex",
                                   function_name);
@@ -698,22 +737,13 @@ module_function::is_instruction_constrained() const
 {
     if(!instruction_exclude.empty())
     {
-        for(auto&& itr : instructions)
+        for(const auto& itr : instruction_text)
         {
-            auto _instrss = std::stringstream{};
-            for(auto&& iitr : itr)
-                _instrss << " " << iitr.first.format();
-
-            auto _instr = _instrss.str();
-            if(!_instr.empty())
+            if(check_regex_restrictions(itr, instruction_exclude))
             {
-                _instr = _instr.substr(1);
-                if(check_regex_restrictions(_instr, instruction_exclude))
-                {
-                    messages.emplace_back(2, "Skipping", "function",
-                                          "instruction-exclude-regex", function_name);
-                    return true;
-                }
+                messages.emplace_back(2, "Skipping", "function",
+                                      "instruction-exclude-regex", function_name);
+                return true;
             }
         }
     }
@@ -750,6 +780,31 @@ module_function::is_num_instructions_constrained() const
     return false;
 }
 
+bool
+module_function::is_profile_guided_constrained() const
+{
+    if(!profile_guided::is_enabled()) return false;
+
+    const auto* _estimate = profile_guided::find(function_name);
+    if(!_estimate)
+    {
+        messages.emplace_back(3, "Skipping", "function", "profile-guided-not-called",
+                              function_name);
+        return true;
+    }
+
+    if(!_estimate->selected)
+    {
+        messages.emplace_back(2, "Skipping", "function", "profile-guided-overhead-budget",
+                              function_name);
+        return true;
+    }
+
+    messages.emplace_back(2, "Forcing", "function", "profile-guided-selected",
+                          function_name);
+    return false;
+}
+
 bool
 module_function::is_loop_num_instructions_constrained() const
 {
@@ -787,7 +842,8 @@ module_function::can_instrument_entry() const
     size_t _num_points = 0;
     size_t _num_traps  = 0;
 
-    std::tie(_num_points, _num_traps) = query_instr(function, BPatch_entry);
+    query_dyninst();
+    std::tie(_num_points, _num_traps) = entry_points;
 
     if(_num_points == 0)
     {
@@ -805,7 +861,8 @@ module_function::can_instrument_exit() const
     size_t _num_points = 0;
     size_t _num_traps  = 0;
 
-    std::tie(_num_points, _num_traps) = query_instr(function, BPatch_exit);
+    query_dyninst();
+    std::tie(_num_points, _num_traps) = exit_points;
 
     if(_num_points == 0)
     {
@@ -825,7 +882,8 @@ module_function::is_entry_trap_constrained() const
     size_t _num_points = 0;
     size_t _num_traps  = 0;
 
-    std::tie(_num_points, _num_traps) = query_instr(function, BPatch_entry);
+    query_dyninst();
+    std::tie(_num_points, _num_traps) = entry_points;
 
     if(!instr_traps && (_num_points - _num_traps) == 0)
     {
@@ -845,7 +903,8 @@ module_function::is_exit_trap_constrained() const
     size_t _num_points = 0;
     size_t _num_traps  = 0;
 
-    std::tie(_num_points, _num_traps) = query_instr(function, BPatch_exit);
+    query_dyninst();
+    std::tie(_num_points, _num_traps) = exit_points;
 
     if((_num_points - _num_traps) == 0)
     {
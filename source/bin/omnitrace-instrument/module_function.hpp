@@ -65,6 +65,15 @@ struct module_function
     bool should_instrument() const;
     bool should_coverage_instrument() const;
 
+    // the constraints shared by should_instrument() and should_coverage_instrument()
+    // which do not require any Dyninst queries
+    bool is_excluded() const;
+
+    // resolves the Dyninst data used by the remaining checks. The checks query it
+    // on demand but the BPatch API is not thread-safe so it must be called serially
+    // before the checks are evaluated concurrently
+    void query_dyninst() const;
+
     // hard constraints
     bool is_instrumentable() const;        // checks whether can instrument
     bool can_instrument_entry() const;     // checks for entry points
@@ -93,6 +102,9 @@ struct module_function
     bool is_address_range_constrained() const;     // checks address range constraint
     bool is_num_instructions_constrained() const;  // check # instructions constraint
 
+    // replaces the size estimates when a prior profile is provided
+    bool is_profile_guided_constrained() const;  // checks overhead budget selection
+
     bool is_visibility_constrained() const;
     bool is_linkage_constrained() const;
 
@@ -111,6 +123,18 @@ struct module_function
     std::map<instruction_category_t, int64_t>   instruction_types = {};
     std::vector<std::vector<instr_addr_pair_t>> instructions      = {};
 
+    bool     instrumentable   = false;
+    bool     system_lib       = false;
+    strvec_t instruction_text = {};
+
+    // results of the Dyninst queries, see query_dyninst()
+    mutable bool                       queried           = false;
+    mutable bool                       overlapping       = false;
+    mutable bool                       dynamic_callsites = false;
+    mutable std::tuple<size_t, size_t> entry_points      = {};
+    mutable std::tuple<size_t, size_t> exit_points       = {};
+    mutable strvec_t                   callee_names      = {};
+
     mutable str_msg_vec_t messages = {};
 
     bool is_overlapping() const;  // checks if func overlaps
@@ -226,6 +250,8 @@ module_function::serialize(ArchiveT& ar, const unsigned)
                             is_address_range_constrained()),
            cereal::make_nvp("is_num_instructions_constrained",
                             is_num_instructions_constrained()),
+           cereal::make_nvp("is_profile_guided_constrained",
+                            is_profile_guided_constrained()),
            cereal::make_nvp("is_instruction_constrained", is_instruction_constrained()),
            cereal::make_nvp("is_loop_address_range_constrained",
                             is_loop_address_range_constrained()),
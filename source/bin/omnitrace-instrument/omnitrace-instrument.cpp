@@ -27,6 +27,7 @@
 #include "fwd.hpp"
 #include "internal_libs.hpp"
 #include "log.hpp"
+#include "profile_guided.hpp"
 
 #include <timemory/backends/process.hpp>
 #include <timemory/config.hpp>
@@ -43,6 +44,7 @@
 #include <timemory/utility/signals.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <csignal>
 #include <cstddef>
@@ -165,6 +167,7 @@ bool                                       use_mpi              = false;
 bool                                       is_static_exe        = false;
 bool                                       force_config         = false;
 size_t                                     batch_size           = 50;
+size_t                                     num_jobs             = 1;
 strset_t                                   extra_libs           = {};
 std::vector<std::pair<uint64_t, string_t>> hash_ids             = {};
 std::map<string_t, bool>                   use_stubs            = {};
@@ -186,6 +189,9 @@ string_t                                   print_available      = {};
 string_t                                   print_overlapping    = {};
 strset_t                                   print_formats        = { "txt", "json" };
 std::string                                modfunc_dump_dir     = {};
+strvec_t                                   profile_inputs       = {};
+double                                     overhead_budget      = 5.0;
+double                                     overhead_per_call    = 500.0;
 auto regex_opts = std::regex_constants::egrep | std::regex_constants::optimize;
 
 std::string
@@ -297,6 +303,20 @@ find(const std::string& itr, const strvec_t& _data)
     return std::any_of(_data.begin(), _data.end(),
                        [itr](const auto& _v) { return (itr == _v); });
 }
+
+// backreferences refer to groups by number so these expressions cannot be combined
+// into an alternation with other expressions
+bool
+has_backreference(const std::string& _expr)
+{
+    for(size_t i = 0; i + 1 < _expr.length(); ++i)
+    {
+        if(_expr.at(i) != '\\') continue;
+        if(_expr.at(i + 1) >= '1' && _expr.at(i + 1) <= '9') return true;
+        ++i;
+    }
+    return false;
+}
 }  // namespace
 
 //======================================================================================//
@@ -943,6 +963,39 @@ main(int argc, char** argv)
         .action([](parser_t& p) {
             min_loop_address_range = p.get<size_t>("min-address-range-loop");
         });
+    parser
+        .add_argument(
+            { "--profile-guided" },
+            "Select the functions to instrument from one or more prior profiles: the "
+            "JSON output of the flat profile (OMNITRACE_PROFILE_BACKEND=flat) or the "
+            "timemory JSON output of an instrumented run (wall_clock.json). Functions "
+            "which were not called are excluded and, of the remaining, the functions "
+            "with the lowest estimated overhead relative to their measured time are "
+            "instrumented until the overhead budget is exhausted. Replaces the "
+            "instruction and address range heuristics. Sampling profiles (e.g. "
+            "sampling_wall_clock.json) are not supported since they do not record the "
+            "number of calls")
+        .min_count(1)
+        .dtype("filepath")
+        .action(
+            [](parser_t& p) { profile_inputs = p.get<strvec_t>("profile-guided"); });
+    parser
+        .add_argument({ "--overhead-budget" },
+                      "Maximum estimated instrumentation overhead, as a percentage of "
+                      "the runtime of the prior profile (used with --profile-guided)")
+        .count(1)
+        .dtype("double")
+        .set_default(overhead_budget)
+        .action([](parser_t& p) { overhead_budget = p.get<double>("overhead-budget"); });
+    parser
+        .add_argument({ "--overhead-per-call" },
+                      "Estimated instrumentation overhead per function call in "
+                      "nanoseconds (used with --profile-guided)")
+        .count(1)
+        .dtype("double")
+        .set_default(overhead_per_call)
+        .action(
+            [](parser_t& p) { overhead_per_call = p.get<double>("overhead-per-call"); });
     parser
         .add_argument(
             { "--coverage" },
@@ -1012,6 +1065,16 @@ main(int argc, char** argv)
         .max_count(1)
         .action(
             [](parser_t& p) { parse_all_modules = p.get<bool>("parse-all-modules"); });
+    parser
+        .add_argument({ "-j", "--jobs" },
+                      "Number of threads used to evaluate the instrumentation heuristics "
+                      "for the available functions (default: 1). Queries to Dyninst and "
+                      "the insertion of instrumentation are always serial")
+        .count(1)
+        .dtype("int")
+        .action([](parser_t& p) {
+            num_jobs = std::max<size_t>(p.get<size_t>("jobs"), 1);
+        });
 
     parser.add_argument({ "" }, "");
     parser.add_argument({ "[DYNINST OPTIONS]" }, "");
@@ -1146,6 +1209,13 @@ main(int argc, char** argv)
                        !parser.exists("min-instructions") &&
                            !parser.exists("min-address-range-loop"));
 
+    if(!profile_inputs.empty())
+    {
+        for(const auto& itr : profile_inputs)
+            profile_guided::load(itr);
+        profile_guided::select(overhead_budget, overhead_per_call);
+    }
+
     auto _omnitrace_exe_path = tim::dirname(::get_realpath("/proc/self/exe"));
     verbprintf(4, "omnitrace exe path: %s\n", _omnitrace_exe_path.c_str());
 
@@ -1251,13 +1321,16 @@ main(int argc, char** argv)
     //----------------------------------------------------------------------------------//
     //
     {
-        //  Helper function for adding regex expressions
-        auto add_regex = [](auto& regex_array, const string_t& regex_expr) {
+        //  Helper function for adding regex expressions. The expressions are compiled
+        //  into a single alternation per array once all of them have been collected
+        //  so that each name is matched against one automaton instead of N.
+        //  Expressions with backreferences are compiled on their own.
+        auto regex_exprs = std::map<regexvec_t*, strvec_t>{};
+        auto add_regex   = [&regex_exprs](auto& regex_array, const string_t& regex_expr) {
             OMNITRACE_ADD_DETAILED_LOG_ENTRY("", "Adding regular expression \"",
                                              regex_expr, "\" to regex_array@",
                                              &regex_array);
-            if(!regex_expr.empty())
-                regex_array.emplace_back(std::regex(regex_expr, regex_opts));
+            if(!regex_expr.empty()) regex_exprs[&regex_array].emplace_back(regex_expr);
         };
 
         add_regex(func_include, tim::get_env<string_t>("OMNITRACE_REGEX_INCLUDE", ""));
@@ -1301,6 +1374,23 @@ main(int argc, char** argv)
         _parse_regex_option("module-restrict", file_restrict);
         _parse_regex_option("internal-module-include", file_internal_include);
         _parse_regex_option("instruction-exclude", instruction_exclude);
+
+        for(auto& itr : regex_exprs)
+        {
+            auto _expr = std::stringstream{};
+            for(const auto& eitr : itr.second)
+            {
+                if(has_backreference(eitr))
+                    itr.first->emplace_back(std::regex(eitr, regex_opts));
+                else
+                    _expr << "|(" << eitr << ")";
+            }
+            if(_expr.str().empty()) continue;
+            OMNITRACE_ADD_DETAILED_LOG_ENTRY("", "Compiling regular expression \"",
+                                             _expr.str().substr(1),
+                                             "\" for regex_array@", itr.first);
+            itr.first->emplace_back(std::regex(_expr.str().substr(1), regex_opts));
+        }
     }
 
     //----------------------------------------------------------------------------------//
@@ -1998,11 +2088,89 @@ main(int argc, char** argv)
     //
     //----------------------------------------------------------------------------------//
 
+    enum : uint8_t
+    {
+        classify_instrument = (1 << 0),
+        classify_coverage   = (1 << 1),
+    };
+
+    // the constraints which do not need Dyninst are evaluated first so that only the
+    // remaining functions are queried. The queries are serial because the BPatch API
+    // is not thread-safe and the checks on either side of them are evaluated on a pool
+    // of threads. The results are inserted serially in the original order so the
+    // output does not depend on the scheduling
+    auto _classify_module_functions = [](const fmodset_t& _funcs, bool _instr,
+                                         bool _coverage) {
+        constexpr size_t chunk_size = 64;
+
+        auto _funcs_v = std::vector<const module_function*>{};
+        _funcs_v.reserve(_funcs.size());
+        for(const auto& itr : _funcs)
+            _funcs_v.emplace_back(&itr);
+
+        auto _nchunks  = (_funcs_v.size() + chunk_size - 1) / chunk_size;
+        auto _nthreads = std::max<size_t>(std::min<size_t>(num_jobs, _nchunks), 1);
+
+        auto _parallel_for = [&](auto&& _func) {
+            auto _index  = std::atomic<size_t>{ 0 };
+            auto _worker = [&]() {
+                size_t _beg = 0;
+                while((_beg = _index.fetch_add(chunk_size)) < _funcs_v.size())
+                {
+                    auto _end = std::min<size_t>(_beg + chunk_size, _funcs_v.size());
+                    for(size_t i = _beg; i < _end; ++i)
+                        _func(i);
+                }
+            };
+
+            auto _threads = std::vector<std::thread>{};
+            for(size_t i = 1; i < _nthreads; ++i)
+                _threads.emplace_back(_worker);
+            _worker();
+            for(auto& itr : _threads)
+                itr.join();
+        };
+
+        auto _excluded = std::vector<uint8_t>(_funcs_v.size(), 0);
+        _parallel_for([&](size_t i) { _excluded.at(i) = _funcs_v.at(i)->is_excluded(); });
+
+        size_t _nqueried = 0;
+        for(size_t i = 0; i < _funcs_v.size(); ++i)
+        {
+            if(_excluded.at(i) != 0) continue;
+            _funcs_v.at(i)->query_dyninst();
+            ++_nqueried;
+        }
+
+        auto _result = std::vector<uint8_t>(_funcs_v.size(), 0);
+        _parallel_for([&](size_t i) {
+            if(_excluded.at(i) != 0) return;
+            const auto* itr = _funcs_v.at(i);
+            uint8_t     _v  = 0;
+            if(_instr && itr->should_instrument()) _v |= classify_instrument;
+            if(_coverage && itr->should_coverage_instrument()) _v |= classify_coverage;
+            _result.at(i) = _v;
+        });
+
+        verbprintf(2,
+                   "Evaluated the heuristics for %zu functions (%zu queried) with %zu "
+                   "threads\n",
+                   _funcs_v.size(), _nqueried, _nthreads);
+        return _result;
+    };
+
+    // make sure the internal library data is not lazily parsed by the worker threads
+    parse_internal_libs_data();
+
     if(instr_mode != "sampling")
     {
+        auto _classes = _classify_module_functions(available_module_functions, true,
+                                                   coverage_mode != CODECOV_NONE);
+        size_t _idx   = 0;
         for(const auto& itr : available_module_functions)
         {
-            if(itr.should_instrument())
+            auto _v = _classes.at(_idx++);
+            if((_v & classify_instrument) != 0)
             {
                 _insert_module_function(instrumented_module_functions, itr);
             }
@@ -2010,11 +2178,8 @@ main(int argc, char** argv)
             {
                 _insert_module_function(excluded_module_functions, itr);
             }
-            if(coverage_mode != CODECOV_NONE)
-            {
-                if(itr.should_coverage_instrument())
-                    _insert_module_function(coverage_module_functions, itr);
-            }
+            if((_v & classify_coverage) != 0)
+                _insert_module_function(coverage_module_functions, itr);
             if(itr.is_overlapping())
                 _insert_module_function(overlapping_module_functions, itr);
         }
@@ -2026,14 +2191,15 @@ main(int argc, char** argv)
             _insert_module_function(instrumented_module_functions,
                                     module_function{ main_func->getModule(), main_func });
 
+        auto _classes = _classify_module_functions(available_module_functions, false,
+                                                   coverage_mode != CODECOV_NONE);
+        size_t _idx   = 0;
         for(const auto& itr : available_module_functions)
         {
+            auto _v = _classes.at(_idx++);
             _insert_module_function(excluded_module_functions, itr);
-            if(coverage_mode != CODECOV_NONE)
-            {
-                if(itr.should_coverage_instrument())
-                    _insert_module_function(coverage_module_functions, itr);
-            }
+            if((_v & classify_coverage) != 0)
+                _insert_module_function(coverage_module_functions, itr);
             if(itr.is_overlapping())
                 _insert_module_function(overlapping_module_functions, itr);
         }
@@ -2299,6 +2465,7 @@ main(int argc, char** argv)
                   "coverage_module_functions", print_formats);
     dump_info("overlapping", overlapping_module_functions, 0, werror,
               "overlapping_module_functions", print_formats);
+    profile_guided::dump("profile_guided_selection", 1);
 
     auto _dump_info = [](const std::string& _label, const string_t& _mode,
                          const fmodset_t& _modset) {
@@ -0,0 +1,409 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "profile_guided.hpp"
+#include "fwd.hpp"
+#include "log.hpp"
+
+#include <timemory/mpl/policy.hpp>
+#include <timemory/settings.hpp>
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/utility/filepath.hpp>
+#include <timemory/utility/join.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <limits>
+#include <regex>
+#include <unordered_map>
+#include <vector>
+
+namespace profile_guided
+{
+namespace
+{
+namespace cereal = ::tim::cereal;
+namespace policy = ::tim::policy;
+
+using input_policy = policy::input_archive<cereal::JSONInputArchive>;
+using estimates_t  = std::vector<function_estimate>;
+
+struct profile_data
+{
+    bool                                            loaded    = false;
+    double                                          total_ns  = 0.0;
+    std::unordered_map<string_t, function_estimate> functions = {};
+};
+
+profile_data&
+get_profile_data()
+{
+    static auto _v = profile_data{};
+    return _v;
+}
+
+// strips the tree decoration of hierarchical labels (e.g. ">>> |_|_foo"), the
+// annotations appended to sampled frames (e.g. "foo [file:line]"), and the parameter
+// list of demangled signatures so that the labels match the names provided by dyninst
+string_t
+normalize(string_t _name)
+{
+    static const auto _prefix = std::regex{ "^(>>>)?( |\\|_)*" };
+    static const auto _suffix = std::regex{ " \\[.*\\]$" };
+    static const auto _const  = std::regex{ "\\) const$" };
+
+    _name = std::regex_replace(_name, _prefix, "");
+    _name = std::regex_replace(_name, _suffix, "");
+    _name = std::regex_replace(_name, _const, ")");
+
+    if(_name.empty() || _name.back() != ')') return _name;
+
+    int64_t _depth = 0;
+    for(size_t i = _name.length(); i > 0; --i)
+    {
+        auto _c = _name.at(i - 1);
+        if(_c == ')')
+            ++_depth;
+        else if(_c == '(' && --_depth == 0)
+        {
+            auto           _head = _name.substr(0, i - 1);
+            constexpr auto _op   = std::string_view{ "operator" };
+            // e.g. "operator()" is a name, not a parameter list
+            if(_head.empty() || (_head.length() >= _op.length() &&
+                                 _head.substr(_head.length() - _op.length()) == _op))
+                return _name;
+            return _head;
+        }
+    }
+    return _name;
+}
+
+struct flat_region
+{
+    string_t name      = {};
+    uint64_t count     = 0;
+    uint64_t inclusive = 0;
+    uint64_t exclusive = 0;
+
+    template <typename ArchiveT>
+    void serialize(ArchiveT& ar, const unsigned)
+    {
+        ar(cereal::make_nvp("name", name), cereal::make_nvp("count", count),
+           cereal::make_nvp("inclusive_ns", inclusive),
+           cereal::make_nvp("exclusive_ns", exclusive));
+    }
+};
+
+// output of OMNITRACE_PROFILE_BACKEND=flat: exact call counts and exclusive times
+estimates_t
+load_flat_profile(std::istream& _ifs)
+{
+    auto _regions = std::vector<flat_region>{};
+    {
+        auto ar = input_policy::get(_ifs);
+
+        ar->setNextName("omnitrace");
+        ar->startNode();
+        ar->setNextName("flat_profile");
+        ar->startNode();
+        (*ar)(cereal::make_nvp("regions", _regions));
+        ar->finishNode();
+        ar->finishNode();
+    }
+
+    auto _data = estimates_t{};
+    _data.reserve(_regions.size());
+    for(const auto& itr : _regions)
+    {
+        auto _v         = function_estimate{};
+        _v.name         = itr.name;
+        _v.calls        = itr.count;
+        _v.self_ns      = itr.exclusive;
+        _v.inclusive_ns = itr.inclusive;
+        _data.emplace_back(std::move(_v));
+    }
+    return _data;
+}
+
+// hierarchical timemory output of an instrumented run, e.g. wall_clock.json. The
+// graph is stored in pre-order so the exclusive time is the inclusive time minus the
+// inclusive time of the entries one level deeper which follow it. The laps of the
+// sampling components (e.g. sampling_wall_clock.json) are the number of samples, not
+// the number of calls, so these profiles are rejected
+estimates_t
+load_timemory_profile(std::istream& _ifs)
+{
+    struct graph_node
+    {
+        int64_t  depth     = 0;
+        uint64_t laps      = 0;
+        double   inclusive = 0.0;
+        double   children  = 0.0;
+        string_t prefix    = {};
+    };
+
+    auto _data = estimates_t{};
+    auto ar    = input_policy::get(_ifs);
+
+    ar->setNextName("timemory");
+    ar->startNode();
+
+    // the component is the first (and typically only) entry
+    const char* _component = ar->getNodeName();
+    if(_component && std::string_view{ _component }.find("sampling") == 0)
+        throw std::runtime_error(TIMEMORY_JOIN(
+            "", "'", _component,
+            "' does not record the number of calls. Use the flat profile "
+            "(OMNITRACE_PROFILE_BACKEND=flat) or the profile of an instrumented run"));
+    ar->startNode();
+
+    // conversion from the display unit to nanoseconds
+    double _unit = 1.0;
+    (*ar)(cereal::make_nvp("unit_value", _unit));
+
+    ar->setNextName("ranks");
+    ar->startNode();
+    cereal::size_type _nranks = 0;
+    ar->loadSize(_nranks);
+    for(cereal::size_type i = 0; i < _nranks; ++i)
+    {
+        ar->startNode();
+        ar->setNextName("graph");
+        ar->startNode();
+
+        auto _stack = std::vector<graph_node>{};
+        auto _flush = [&_stack, &_data](int64_t _depth) {
+            while(!_stack.empty() && _stack.back().depth >= _depth)
+            {
+                const auto& _node = _stack.back();
+                auto        _v    = function_estimate{};
+                _v.name           = _node.prefix;
+                _v.calls          = _node.laps;
+                _v.self_ns        = std::max(_node.inclusive - _node.children, 0.0);
+                _v.inclusive_ns   = _node.inclusive;
+                _data.emplace_back(std::move(_v));
+                _stack.pop_back();
+            }
+        };
+
+        cereal::size_type _nnodes = 0;
+        ar->loadSize(_nnodes);
+        for(cereal::size_type j = 0; j < _nnodes; ++j)
+        {
+            auto _node = graph_node{};
+            ar->startNode();
+            (*ar)(cereal::make_nvp("prefix", _node.prefix),
+                  cereal::make_nvp("depth", _node.depth));
+            ar->setNextName("entry");
+            ar->startNode();
+            (*ar)(cereal::make_nvp("laps", _node.laps),
+                  cereal::make_nvp("repr_display", _node.inclusive));
+            ar->finishNode();
+            ar->finishNode();
+
+            _node.inclusive *= _unit;
+            _flush(_node.depth);
+            if(!_stack.empty()) _stack.back().children += _node.inclusive;
+            _stack.emplace_back(std::move(_node));
+        }
+        _flush(std::numeric_limits<int64_t>::min());
+
+        ar->finishNode();
+        ar->finishNode();
+    }
+    ar->finishNode();
+
+    ar->finishNode();
+    ar->finishNode();
+
+    return _data;
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return get_profile_data().loaded;
+}
+
+void
+load(const string_t& _fname)
+{
+    std::ifstream _ifs{ _fname };
+    if(!_ifs)
+        throw std::runtime_error(TIMEMORY_JOIN("", "[omnitrace][exe] Error opening '",
+                                               _fname, "' for input"));
+
+    verbprintf(1, "Reading profile '%s'...\n", _fname.c_str());
+
+    auto _errors = std::vector<string_t>{};
+    for(auto* _loader : { &load_flat_profile, &load_timemory_profile })
+    {
+        try
+        {
+            _ifs.clear();
+            _ifs.seekg(0, std::ios::beg);
+
+            auto  _estimates = (*_loader)(_ifs);
+            auto& _data      = get_profile_data();
+            for(auto& itr : _estimates)
+            {
+                auto _name = normalize(itr.name);
+                if(_name.empty()) continue;
+
+                auto& _entry = _data.functions[_name];
+                _entry.name  = _name;
+                _entry.calls += itr.calls;
+                _entry.self_ns += itr.self_ns;
+                _entry.inclusive_ns += itr.inclusive_ns;
+                _data.total_ns += itr.self_ns;
+            }
+            _data.loaded = true;
+
+            verbprintf(1, "Read %zu entries from '%s'\n", _estimates.size(),
+                       _fname.c_str());
+            return;
+        } catch(std::exception& _e)
+        {
+            _errors.emplace_back(_e.what());
+        }
+    }
+
+    std::stringstream _msg{};
+    _msg << "[omnitrace][exe] Error reading '" << _fname
+         << "'. Expected the JSON output of the flat profile or timemory:";
+    for(auto& itr : _errors)
+        _msg << "\n    " << itr;
+    throw std::runtime_error(_msg.str());
+}
+
+void
+select(double _budget, double _per_call_ns)
+{
+    auto& _data = get_profile_data();
+    if(!_data.loaded) return;
+
+    if(_data.total_ns <= 0.0)
+    {
+        errprintf(0, "profile-guided :: the profile(s) did not record any time\n");
+        return;
+    }
+
+    auto _entries = std::vector<function_estimate*>{};
+    for(auto& itr : _data.functions)
+    {
+        auto& _v       = itr.second;
+        _v.overhead_ns = _v.calls * _per_call_ns;
+        _v.selected    = false;
+        if(_v.inclusive_ns > 0.0) _entries.emplace_back(&_v);
+    }
+
+    // the functions which accumulate the most time per unit of overhead provide the
+    // most information for the least perturbation
+    auto _ratio = [](const function_estimate* _v) {
+        return _v->overhead_ns / _v->inclusive_ns;
+    };
+    std::sort(_entries.begin(), _entries.end(),
+              [&_ratio](const function_estimate* _lhs, const function_estimate* _rhs) {
+                  auto _lhs_ratio = _ratio(_lhs);
+                  auto _rhs_ratio = _ratio(_rhs);
+                  return (_lhs_ratio == _rhs_ratio) ? (_lhs->name < _rhs->name)
+                                                    : (_lhs_ratio < _rhs_ratio);
+              });
+
+    auto   _limit    = 0.01 * _budget * _data.total_ns;
+    double _overhead = 0.0;
+    size_t _selected = 0;
+    for(auto* itr : _entries)
+    {
+        if(_overhead + itr->overhead_ns > _limit) continue;
+        _overhead += itr->overhead_ns;
+        itr->selected = true;
+        ++_selected;
+    }
+
+    verbprintf(0,
+               "profile-guided :: selected %zu of %zu functions (estimated overhead: "
+               "%.3f%% of %.3f sec, budget: %.3f%%)\n",
+               _selected, _data.functions.size(), 100.0 * _overhead / _data.total_ns,
+               _data.total_ns * 1.0e-9, _budget);
+}
+
+const function_estimate*
+find(const string_t& _name)
+{
+    auto& _data = get_profile_data();
+    auto  itr   = _data.functions.find(_name);
+    if(itr == _data.functions.end()) itr = _data.functions.find(normalize(_name));
+    return (itr == _data.functions.end()) ? nullptr : &itr->second;
+}
+
+void
+dump(const string_t& _oname, int _level)
+{
+    auto& _data = get_profile_data();
+    if(!_data.loaded) return;
+
+    auto _cfg         = tim::settings::compose_filename_config{};
+    _cfg.subdirectory = "instrumentation";
+    auto _fname       = tim::settings::compose_output_filename(_oname, "txt", _cfg);
+
+    std::ofstream ofs{};
+    if(!tim::filepath::open(ofs, _fname))
+    {
+        errprintf(_level, "Error opening '%s' for output\n", _fname.c_str());
+        return;
+    }
+
+    auto _entries = std::vector<const function_estimate*>{};
+    size_t _width = 8;
+    for(const auto& itr : _data.functions)
+    {
+        _entries.emplace_back(&itr.second);
+        _width = std::max<size_t>(_width, itr.first.length());
+    }
+
+    std::sort(_entries.begin(), _entries.end(),
+              [](const function_estimate* _lhs, const function_estimate* _rhs) {
+                  if(_lhs->selected != _rhs->selected) return _lhs->selected;
+                  return _lhs->inclusive_ns > _rhs->inclusive_ns;
+              });
+
+    verbprintf(_level, "Outputting '%s'...\n", _fname.c_str());
+
+    ofs << std::setw(10) << "Selected" << std::setw(14) << "Calls" << std::setw(16)
+        << "Self (sec)" << std::setw(16) << "Incl (sec)" << std::setw(16)
+        << "Overhead (sec)" << "  " << std::left << std::setw(_width) << "Function"
+        << std::right << "\n";
+    ofs << std::setprecision(6) << std::fixed;
+    for(const auto* itr : _entries)
+    {
+        ofs << std::setw(10) << ((itr->selected) ? "yes" : "no") << std::setw(14)
+            << itr->calls << std::setw(16) << itr->self_ns * 1.0e-9 << std::setw(16)
+            << itr->inclusive_ns * 1.0e-9 << std::setw(16) << itr->overhead_ns * 1.0e-9
+            << "  " << itr->name << "\n";
+    }
+}
+}  // namespace profile_guided
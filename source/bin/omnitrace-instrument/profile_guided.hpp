@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "fwd.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace profile_guided
+{
+// per-function estimates extracted from a prior profile
+struct function_estimate
+{
+    string_t name         = {};
+    uint64_t calls        = 0;      // number of calls
+    double   self_ns      = 0.0;    // exclusive time
+    double   inclusive_ns = 0.0;    // inclusive time
+    double   overhead_ns  = 0.0;    // estimated cost of instrumenting the function
+    bool     selected     = false;  // within the overhead budget
+};
+
+// returns true once a profile has been loaded
+bool
+is_enabled();
+
+// reads a flat profile (flat-profile.json) or the timemory JSON profile of an
+// instrumented run (e.g. wall_clock.json). Sampling profiles do not record the number
+// of calls and are rejected. Throws on failure
+void
+load(const string_t& _fname);
+
+// ranks the functions by estimated overhead per unit of measured time and selects
+// functions until the cumulative overhead reaches _budget percent of the runtime
+void
+select(double _budget, double _per_call_ns);
+
+// returns nullptr if the function was not found in the profile
+const function_estimate*
+find(const string_t& _name);
+
+// writes the estimates and selection to <output>/instrumentation/<_oname>.txt
+void
+dump(const string_t& _oname, int _level);
+}  // namespace profile_guided
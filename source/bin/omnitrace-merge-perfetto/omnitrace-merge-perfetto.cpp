@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Combines the perfetto traces written by each rank into a single trace. Perfetto
+// traces are a sequence of length-delimited TracePacket messages so the traces are
+// combined by concatenation. The inputs are streamed through a fixed-size buffer so
+// the memory usage does not depend on the size or number of the traces.
+
+#include "common/defines.h"
+
+#include <timemory/log/color.hpp>
+#include <timemory/utility/argparse.hpp>
+#include <timemory/utility/console.hpp>
+#include <timemory/utility/filepath.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace color    = ::tim::log::color;
+namespace filepath = ::tim::filepath;  // NOLINT
+namespace console  = ::tim::utility::console;
+namespace argparse = ::tim::argparse;
+
+namespace
+{
+using parser_t     = argparse::argument_parser;
+using parser_err_t = typename parser_t::result_type;
+
+int verbose_level = 0;
+
+// reads a base-128 varint. Returns false if the stream ends before the varint
+bool
+read_varint(std::istream& _ifs, uint64_t& _value)
+{
+    _value = 0;
+    for(int _shift = 0; _shift < 64; _shift += 7)
+    {
+        auto _c = _ifs.get();
+        if(_c == std::istream::traits_type::eof()) return false;
+        _value |= (static_cast<uint64_t>(_c & 0x7f) << _shift);
+        if((_c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// verifies that the file is a sequence of TracePacket messages, i.e. field 1
+// of the Trace message with wire type 2 (length-delimited)
+bool
+validate(const std::string& _fname, size_t& _npackets)
+{
+    constexpr int trace_packet_tag = (1 << 3) | 2;
+
+    auto _ifs = std::ifstream{ _fname, std::ios::binary | std::ios::ate };
+    if(!_ifs) return false;
+
+    auto _size = static_cast<uint64_t>(_ifs.tellg());
+    _ifs.seekg(0, std::ios::beg);
+
+    _npackets = 0;
+    while(true)
+    {
+        auto _tag = _ifs.get();
+        if(_tag == std::istream::traits_type::eof()) break;
+
+        uint64_t _len = 0;
+        if(_tag != trace_packet_tag || !read_varint(_ifs, _len)) return false;
+
+        auto _pos = static_cast<uint64_t>(_ifs.tellg());
+        if(_pos + _len > _size) return false;
+        _ifs.seekg(_len, std::ios::cur);
+        ++_npackets;
+    }
+    return true;
+}
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+    auto _output   = std::string{};
+    auto _inputs   = std::vector<std::string>{};
+    bool _validate = true;
+    bool _remove   = false;
+
+    const auto* _desc = R"desc(
+    Combines the perfetto traces of each rank into a single perfetto trace. This is
+    typically used when OMNITRACE_PERFETTO_COMBINE_TRACES could not combine the traces
+    at the end of the run and each rank wrote its own trace.
+    )desc";
+
+    auto parser = parser_t{ "omnitrace-merge-perfetto", _desc };
+
+    parser.on_error([](parser_t&, const parser_err_t& _err) {
+        std::cerr << color::fatal() << _err << color::end() << "\n";
+        exit(EXIT_FAILURE);
+    });
+
+    parser.enable_help("", "Usage: omnitrace-merge-perfetto -o <OUTPUT> -i <INPUTS...>");
+    parser.enable_version("omnitrace-merge-perfetto", OMNITRACE_ARGPARSE_VERSION_INFO);
+
+    auto _cols = std::get<0>(console::get_columns());
+    if(_cols > parser.get_help_width() + 8)
+        parser.set_description_width(
+            std::min<int>(_cols - parser.get_help_width() - 8, 120));
+
+    parser.add_argument({ "--verbose" }, "Enable informational messages")
+        .max_count(1)
+        .action([](parser_t& p) {
+            verbose_level = (p.get_count("verbose") == 0) ? 1 : p.get<int>("verbose");
+        });
+    parser.add_argument({ "-o", "--output" }, "Output filename for the combined trace")
+        .count(1)
+        .dtype("filepath")
+        .action([&](parser_t& p) { _output = p.get<std::string>("output"); });
+    parser.add_argument({ "-i", "--input" }, "Perfetto traces to combine (in order)")
+        .min_count(1)
+        .dtype("filepath")
+        .action(
+            [&](parser_t& p) { _inputs = p.get<std::vector<std::string>>("input"); });
+    parser
+        .add_argument({ "--validate" },
+                      "Verify that each input is a sequence of perfetto trace packets "
+                      "before combining")
+        .max_count(1)
+        .dtype("boolean")
+        .action([&](parser_t& p) { _validate = p.get<bool>("validate"); });
+    parser
+        .add_argument({ "--remove" },
+                      "Remove the input traces after they were successfully combined")
+        .max_count(1)
+        .dtype("boolean")
+        .action([&](parser_t& p) { _remove = p.get<bool>("remove"); });
+
+    auto _cerr = parser.parse_args(argc, argv);
+    if(parser.exists("help")) return EXIT_SUCCESS;
+    if(_cerr)
+    {
+        std::cerr << _cerr.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(_output.empty() || _inputs.empty())
+    {
+        std::cerr << color::fatal()
+                  << "Error! an output (-o) and at least one input (-i) are required"
+                  << color::end() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for(const auto& itr : _inputs)
+    {
+        if(itr == _output)
+        {
+            std::cerr << color::fatal() << "Error! input '" << itr
+                      << "' is also the output" << color::end() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        size_t _npackets = 0;
+        if(!std::ifstream{ itr, std::ios::binary })
+        {
+            std::cerr << color::fatal() << "Error! input '" << itr << "' does not exist"
+                      << color::end() << std::endl;
+            return EXIT_FAILURE;
+        }
+        else if(_validate && !validate(itr, _npackets))
+        {
+            std::cerr << color::fatal() << "Error! input '" << itr
+                      << "' is not a valid perfetto trace" << color::end() << std::endl;
+            return EXIT_FAILURE;
+        }
+        else if(_validate && verbose_level >= 1)
+        {
+            std::cerr << color::info() << "[omnitrace-merge-perfetto] '" << itr
+                      << "' contains " << _npackets << " packets" << color::end()
+                      << std::endl;
+        }
+    }
+
+    auto _ofs = std::ofstream{};
+    if(!filepath::open(_ofs, _output, std::ios::out | std::ios::binary))
+    {
+        std::cerr << color::fatal() << "Error! output '" << _output
+                  << "' could not be opened" << color::end() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto _buffer = std::vector<char>(16 * 1024 * 1024);
+    for(const auto& itr : _inputs)
+    {
+        auto _ifs = std::ifstream{ itr, std::ios::binary };
+        while(_ifs && _ofs)
+        {
+            _ifs.read(_buffer.data(), _buffer.size());
+            if(_ifs.gcount() > 0) _ofs.write(_buffer.data(), _ifs.gcount());
+        }
+
+        if(!_ofs || !_ifs.eof())
+        {
+            std::cerr << color::fatal() << "Error! failed to copy '" << itr << "' to '"
+                      << _output << "'" << color::end() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if(verbose_level >= 1)
+            std::cerr << color::info() << "[omnitrace-merge-perfetto] Combined '" << itr
+                      << "'" << color::end() << std::endl;
+    }
+    _ofs.close();
+
+    if(_remove)
+    {
+        for(const auto& itr : _inputs)
+            std::remove(itr.c_str());
+    }
+
+    if(verbose_level >= 0)
+        std::cerr << "[omnitrace-merge-perfetto] Outputting '" << _output << "'... Done"
+                  << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -286,6 +286,68 @@ configure_settings(bool _init)
         bool, "OMNITRACE_USE_TIMEMORY", "[DEPRECATED] Renamed to OMNITRACE_PROFILE",
         !_config->get<bool>("OMNITRACE_TRACE"), "backend", "timemory", "deprecated");
 
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_PROFILE_BACKEND",
+        "Storage for the instrumented regions when OMNITRACE_PROFILE is enabled. "
+        "'timemory' stores the regions in the timemory call-graph. 'flat' aggregates the "
+        "call count, inclusive, and exclusive time of each region in per-thread tables "
+        "with a fraction of the per-call overhead and writes a flat profile at "
+        "finalization",
+        "timemory", "backend", "timemory", "profile")
+        ->set_choices({ "timemory", "flat" });
+
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_THROTTLE_REGIONS",
+        "Stop recording instrumented functions which are called frequently and have a "
+        "short mean duration. See OMNITRACE_THROTTLE_REGIONS_COUNT and "
+        "OMNITRACE_THROTTLE_REGIONS_MEAN_DURATION. The throttled functions are reported "
+        "at finalization so that they can be excluded from the instrumentation",
+        false, "trace", "profile", "analysis");
+
+    OMNITRACE_CONFIG_SETTING(
+        size_t, "OMNITRACE_THROTTLE_REGIONS_COUNT",
+        "Minimum number of calls to an instrumented function on a thread before it "
+        "may be throttled",
+        size_t{ 10000 }, "trace", "profile", "analysis", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        double, "OMNITRACE_THROTTLE_REGIONS_MEAN_DURATION",
+        "Instrumented functions with a mean duration less than this value (in "
+        "microseconds) after OMNITRACE_THROTTLE_REGIONS_COUNT calls are throttled",
+        10.0, "trace", "profile", "analysis", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_TRACE_BACKEND",
+        "Encoding of the instrumented host regions when OMNITRACE_TRACE is enabled. "
+        "'perfetto' encodes each region entry and exit through the perfetto SDK. "
+        "'event-log' appends fixed-size (timestamp, region, kind) records to per-thread "
+        "buffers (spilled to temporary files when full) which are converted into "
+        "perfetto slices at finalization",
+        "perfetto", "backend", "perfetto", "trace")
+        ->set_choices({ "perfetto", "event-log" });
+
+    OMNITRACE_CONFIG_SETTING(size_t, "OMNITRACE_EVENT_LOG_BUFFER_SIZE",
+                             "Number of records in each per-thread buffer when "
+                             "OMNITRACE_TRACE_BACKEND=event-log",
+                             size_t{ 65536 }, "backend", "perfetto", "trace", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(bool, "OMNITRACE_PROFILE_FLAT_EDGES",
+                             "When OMNITRACE_PROFILE_BACKEND=flat, also record the call "
+                             "count and inclusive time of each caller -> callee edge",
+                             false, "backend", "timemory", "profile", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_TIMESTAMP_SOURCE",
+        "Source of the timestamps for the trace, profile, and samples. 'clock' reads "
+        "CLOCK_REALTIME for every timestamp. 'counter' reads the invariant TSC (x86_64) "
+        "or the virtual counter (arm64) and converts the ticks to CLOCK_REALTIME "
+        "nanoseconds using the frequency reported by the hardware or measured since "
+        "the library was loaded. The timestamps compared across processes are "
+        "corrected by a linear fit between initialization and finalization. 'counter' "
+        "falls back to 'clock' when the counter is not a constant-rate timestamp source",
+        "clock", "trace", "profile", "sampling", "advanced")
+        ->set_choices({ "clock", "counter" });
+
     OMNITRACE_CONFIG_SETTING(bool, "OMNITRACE_USE_CAUSAL",
                              "Enable causal profiling analysis", false, "backend",
                              "causal", "analysis");
@@ -328,6 +390,14 @@ configure_settings(bool _init)
         "Enable tagging filenames with process identifier (either MPI rank or pid)", true,
         "io", "filename");
 
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_FORK_CHILD_PROFILING",
+        "Continue sampling and profiling in child processes created by fork(). The "
+        "forking thread is sampled in the child and the child writes its own output "
+        "suffixed by its PID. Perfetto tracing is not resumed in the child because the "
+        "threads of the tracing service do not survive fork()",
+        false, "backend", "sampling", "profile", "fork");
+
     OMNITRACE_CONFIG_SETTING(bool, "OMNITRACE_USE_KOKKOSP",
                              "Enable support for Kokkos Tools", false, "kokkos",
                              "backend");
@@ -336,6 +406,12 @@ configure_settings(bool _init)
                              "Enable support for MPI functions", true, "mpi", "backend",
                              "parallelism");
 
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_MPI_WAIT_STATES",
+        "Classify the time spent in blocking MPI calls as late-sender, late-receiver, "
+        "or collective imbalance (requires OMNITRACE_USE_MPIP)",
+        false, "mpi", "analysis", "advanced");
+
     OMNITRACE_CONFIG_SETTING(
         bool, "OMNITRACE_USE_RCCLP",
         "Enable support for ROCm Communication Collectives Library (RCCL) Performance",
@@ -364,6 +440,17 @@ configure_settings(bool _init)
                              "Enable support for OpenMP-Tools", false, "openmp", "ompt",
                              "backend");
 
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_OMPT_CALLBACKS",
+        "Classes of OpenMP-Tools callbacks to register when OMNITRACE_USE_OMPT is "
+        "enabled: 'parallel' (parallel regions and implicit tasks), 'work' "
+        "(worksharing constructs), 'sync' (barriers, taskwait, taskgroup), and 'task' "
+        "(explicit tasks). These callbacks record directly into the perfetto trace and "
+        "the profile. Use 'timemory' to instead register the full timemory OMPT toolset "
+        "(which includes target offload and mutex callbacks)",
+        std::string{ "parallel work sync task" }, "openmp", "ompt", "advanced")
+        ->set_choices({ "parallel", "work", "sync", "task", "timemory" });
+
     OMNITRACE_CONFIG_SETTING(bool, "OMNITRACE_USE_CODE_COVERAGE",
                              "Enable support for code coverage", false, "coverage",
                              "backend", "advanced");
@@ -425,6 +512,14 @@ configure_settings(bool _init)
                              "Defaults to OMNITRACE_SAMPLING_FREQ when <= 0.0",
                              -1.0, "sampling", "advanced");
 
+    OMNITRACE_CONFIG_SETTING(
+        double, "OMNITRACE_SAMPLING_OVERHEAD",
+        "Maximum percentage of the run time of each thread spent in the sample handler "
+        "(e.g. 2.0). When > 0.0, the timer samples are decimated and the period of the "
+        "overflow event is increased while a thread is over this budget and restored "
+        "when it is under it. The effective rates are reported at finalization",
+        0.0, "sampling", "advanced");
+
     OMNITRACE_CONFIG_SETTING(
         double, "OMNITRACE_SAMPLING_DELAY",
         "Time (in seconds) to wait before the first sampling signal is delivered, "
@@ -535,6 +630,25 @@ configure_settings(bool _init)
                              "cause deadlocks with MPI distributions.",
                              false, "backend", "parallelism", "gotcha", "advanced");
 
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION",
+        "Only record pthread lock acquisitions which are contended. Each lock call is "
+        "first attempted via the corresponding trylock function and uncontended "
+        "acquisitions are not traced. Contended acquisitions record the wait time, the "
+        "lock address, and the holder/waiter thread IDs, which are aggregated into "
+        "per-lock statistics reported during finalization. Applies to the lock types "
+        "enabled via OMNITRACE_TRACE_THREAD_LOCKS, OMNITRACE_TRACE_THREAD_RW_LOCKS, and "
+        "OMNITRACE_TRACE_THREAD_SPIN_LOCKS",
+        false, "backend", "parallelism", "gotcha", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        double, "OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION_THRESHOLD",
+        "When OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION is enabled, contended lock "
+        "acquisitions which waited for at least this amount of time (in microseconds) "
+        "are emitted to the trace. All contended acquisitions are included in the "
+        "per-lock statistics regardless of this value",
+        10.0, "backend", "parallelism", "gotcha", "advanced");
+
     OMNITRACE_CONFIG_SETTING(bool, "OMNITRACE_TRACE_THREAD_BARRIERS",
                              "Enable tracing calls to pthread_barrier functions.", true,
                              "backend", "parallelism", "gotcha", "advanced");
@@ -586,6 +700,25 @@ configure_settings(bool _init)
         "This is recommended.",
         false, "sampling", "advanced");
 
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_SAMPLING_OFFCPU",
+        "Record the call-stack of every thread when it is switched out by the scheduler "
+        "(Linux perf context-switch records) and attribute the time until it is switched "
+        "back in to that call-stack. The blocked time is merged with the on-CPU samples "
+        "(OMNITRACE_SAMPLING_CPUTIME) under an [off-cpu] entry. Unlike "
+        "OMNITRACE_SAMPLING_REALTIME, blocked threads are not interrupted. This requires "
+        "a /proc/sys/kernel/perf_event_paranoid value of 1 or less",
+        false, "sampling", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_SAMPLING_PERF_EVENTS",
+        "Hardware and software perf events (e.g. PERF_COUNT_HW_CPU_CYCLES "
+        "PERF_COUNT_HW_INSTRUCTIONS) counted as a single group per thread and read "
+        "with one syscall in each sample. When set, these replace OMNITRACE_PAPI_EVENTS "
+        "for the per-sample hardware counters",
+        std::string{}, "sampling", "hardware_counters", "advanced")
+        ->set_choices(perf::get_config_choices());
+
     OMNITRACE_CONFIG_SETTING(int, "OMNITRACE_SAMPLING_CPUTIME_SIGNAL",
                              "Modify this value only if the target process is also using "
                              "the same signal (SIGPROF)",
@@ -601,6 +734,48 @@ configure_settings(bool _init)
                              "the same signal (SIGRTMIN + 1)",
                              SIGRTMIN + 1, "sampling", "advanced");
 
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_SAMPLING_MEMORY",
+        "Replace the overflow sampling event (OMNITRACE_SAMPLING_OVERFLOW) with the "
+        "precise memory event (Intel PEBS or AMD IBS) which records the data address, "
+        "data source, and latency of the sampled accesses and report the NUMA locality "
+        "of the accesses per function and per allocation site",
+        false, "sampling", "hardware_counters", "numa", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(std::string, "OMNITRACE_SAMPLING_MEMORY_EVENT",
+                             "Memory accesses sampled when OMNITRACE_SAMPLING_MEMORY is "
+                             "enabled",
+                             std::string{ "mem-loads" }, "sampling", "hardware_counters",
+                             "numa", "advanced")
+        ->set_choices({ "mem-loads", "mem-stores" });
+
+    OMNITRACE_CONFIG_SETTING(size_t, "OMNITRACE_SAMPLING_MEMORY_ALLOCATION_SIZE",
+                             "Minimum size (in bytes) of the allocations which the "
+                             "sampled memory accesses are attributed to",
+                             size_t{ 65536 }, "sampling", "numa", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_SAMPLING_BRANCH",
+        "Record the last taken branches (Intel LBR, AMD BRS, or ARM BRBE) with each "
+        "overflow sample (OMNITRACE_SAMPLING_OVERFLOW) and report the taken-branch "
+        "edges, the execution counts of the straight-line code between them, and the "
+        "hot loops per source line. Requires a hardware overflow event, e.g. "
+        "PERF_COUNT_HW_CPU_CYCLES",
+        false, "sampling", "hardware_counters", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(
+        bool, "OMNITRACE_HEAP_PROFILE",
+        "Sample the heap allocations (malloc, calloc, realloc, aligned_alloc, "
+        "posix_memalign, and the C++ operator new which calls malloc) at a mean interval "
+        "of OMNITRACE_HEAP_PROFILE_INTERVAL bytes and report the estimated allocation "
+        "rate, bytes, allocation latency, and live heap at exit per allocation site",
+        false, "sampling", "gotcha", "advanced");
+
+    OMNITRACE_CONFIG_SETTING(size_t, "OMNITRACE_HEAP_PROFILE_INTERVAL",
+                             "Mean number of bytes allocated between the sampled heap "
+                             "allocations when OMNITRACE_HEAP_PROFILE is enabled",
+                             size_t{ 524288 }, "sampling", "gotcha", "advanced");
+
     OMNITRACE_CONFIG_SETTING(std::string, "OMNITRACE_SAMPLING_OVERFLOW_EVENT",
                              "Metric for overflow sampling",
                              std::string{ "perf::PERF_COUNT_HW_CACHE_REFERENCES" },
@@ -661,6 +836,15 @@ configure_settings(bool _init)
                              "default to the value of OMNITRACE_COLLAPSE_PROCESSES",
                              false, "perfetto", "data", "advanced");
 
+    OMNITRACE_CONFIG_SETTING(
+        std::string, "OMNITRACE_PERFETTO_COMBINE_METHOD",
+        "Method for combining the perfetto traces of each rank when "
+        "OMNITRACE_PERFETTO_COMBINE_TRACES is enabled. 'mpi-io' writes each rank's "
+        "trace into its offset of the output file in parallel and never holds more "
+        "than one rank's trace in memory. 'gather' collects the traces on rank 0",
+        "mpi-io", "perfetto", "data", "advanced")
+        ->set_choices({ "mpi-io", "gather" });
+
     OMNITRACE_CONFIG_SETTING(
         bool, "OMNITRACE_PERFETTO_ROCTRACER_PER_STREAM",
         "Separate roctracer GPU side traces (copies, kernels) into separate "
@@ -1320,6 +1504,20 @@ get_use_sampling_cputime()
     return static_cast<tim::tsettings<bool>&>(*_v->second).get();
 }
 
+bool
+get_use_sampling_offcpu()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_OFFCPU");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+std::string
+get_sampling_perf_events()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_PERF_EVENTS");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
 std::set<int> get_sampling_signals(int64_t)
 {
     auto _v = std::set<int>{};
@@ -1406,7 +1604,9 @@ configure_disabled_settings(const std::shared_ptr<settings>& _config)
 #if !defined(TIMEMORY_USE_MPI) || TIMEMORY_USE_MPI == 0
     _config->disable("OMNITRACE_PERFETTO_COMBINE_TRACES");
     _config->disable("OMNITRACE_COLLAPSE_PROCESSES");
+    _config->disable("OMNITRACE_PERFETTO_COMBINE_METHOD");
     _config->find("OMNITRACE_PERFETTO_COMBINE_TRACES")->second->set_hidden(true);
+    _config->find("OMNITRACE_PERFETTO_COMBINE_METHOD")->second->set_hidden(true);
     _config->find("OMNITRACE_COLLAPSE_PROCESSES")->second->set_hidden(true);
 #endif
 
@@ -1847,6 +2047,62 @@ get_use_timemory()
     return static_cast<tim::tsettings<bool>&>(*_v->second).get();
 }
 
+std::string
+get_profile_backend()
+{
+    static auto _v = get_config()->find("OMNITRACE_PROFILE_BACKEND");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
+std::string
+get_trace_backend()
+{
+    static auto _v = get_config()->find("OMNITRACE_TRACE_BACKEND");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
+size_t
+get_event_log_buffer_size()
+{
+    static auto _v = get_config()->find("OMNITRACE_EVENT_LOG_BUFFER_SIZE");
+    return static_cast<tim::tsettings<size_t>&>(*_v->second).get();
+}
+
+bool
+get_profile_flat_edges()
+{
+    static auto _v = get_config()->find("OMNITRACE_PROFILE_FLAT_EDGES");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+bool
+get_throttle_regions()
+{
+    static auto _v = get_config()->find("OMNITRACE_THROTTLE_REGIONS");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+size_t
+get_throttle_regions_count()
+{
+    static auto _v = get_config()->find("OMNITRACE_THROTTLE_REGIONS_COUNT");
+    return static_cast<tim::tsettings<size_t>&>(*_v->second).get();
+}
+
+double
+get_throttle_regions_mean_duration()
+{
+    static auto _v = get_config()->find("OMNITRACE_THROTTLE_REGIONS_MEAN_DURATION");
+    return static_cast<tim::tsettings<double>&>(*_v->second).get();
+}
+
+std::string
+get_timestamp_source()
+{
+    static auto _v = get_config()->find("OMNITRACE_TIMESTAMP_SOURCE");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
 bool&
 get_use_causal()
 {
@@ -1937,6 +2193,13 @@ get_use_pid()
     return static_cast<tim::tsettings<bool>&>(*_v->second).get();
 }
 
+bool
+get_fork_child_profiling()
+{
+    static auto _v = get_config()->find("OMNITRACE_FORK_CHILD_PROFILING");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
 bool&
 get_use_mpip()
 {
@@ -1944,6 +2207,13 @@ get_use_mpip()
     return static_cast<tim::tsettings<bool>&>(*_v->second).get();
 }
 
+bool
+get_mpi_wait_states()
+{
+    static auto _v = get_config()->find("OMNITRACE_MPI_WAIT_STATES");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
 bool
 get_use_kokkosp()
 {
@@ -1969,6 +2239,17 @@ get_use_ompt()
 #endif
 }
 
+std::set<std::string>
+get_ompt_callbacks()
+{
+    static auto _v = get_config()->find("OMNITRACE_OMPT_CALLBACKS");
+    auto&       _val = static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+    auto        _ret = std::set<std::string>{};
+    for(auto itr : tim::delimit(_val, " ,;:\t\n"))
+        _ret.emplace(std::move(itr));
+    return _ret;
+}
+
 bool
 get_use_code_coverage()
 {
@@ -2071,6 +2352,13 @@ get_perfetto_combined_traces()
 #endif
 }
 
+std::string
+get_perfetto_combine_method()
+{
+    static auto _v = get_config()->find("OMNITRACE_PERFETTO_COMBINE_METHOD");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
 std::string
 get_perfetto_fill_policy()
 {
@@ -2232,6 +2520,48 @@ get_sampling_realtime_freq()
     return _val;
 }
 
+bool
+get_use_sampling_memory()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_MEMORY");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+std::string
+get_sampling_memory_event()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_MEMORY_EVENT");
+    return static_cast<tim::tsettings<std::string>&>(*_v->second).get();
+}
+
+size_t
+get_sampling_memory_allocation_size()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_MEMORY_ALLOCATION_SIZE");
+    return static_cast<tim::tsettings<size_t>&>(*_v->second).get();
+}
+
+bool
+get_use_sampling_branch()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_BRANCH");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+bool
+get_use_heap_profile()
+{
+    static auto _v = get_config()->find("OMNITRACE_HEAP_PROFILE");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+size_t
+get_heap_profile_interval()
+{
+    static auto _v = get_config()->find("OMNITRACE_HEAP_PROFILE_INTERVAL");
+    return static_cast<tim::tsettings<size_t>&>(*_v->second).get();
+}
+
 double
 get_sampling_overflow_freq()
 {
@@ -2241,6 +2571,13 @@ get_sampling_overflow_freq()
     return _val;
 }
 
+double
+get_sampling_overhead()
+{
+    static auto _v = get_config()->find("OMNITRACE_SAMPLING_OVERHEAD");
+    return static_cast<tim::tsettings<double>&>(*_v->second).get();
+}
+
 double
 get_sampling_delay()
 {
@@ -2382,6 +2719,21 @@ get_trace_thread_spin_locks()
     return static_cast<tim::tsettings<bool>&>(*_v->second).get();
 }
 
+bool
+get_trace_thread_locks_contention()
+{
+    static auto _v = get_config()->find("OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION");
+    return static_cast<tim::tsettings<bool>&>(*_v->second).get();
+}
+
+double
+get_trace_thread_locks_contention_threshold()
+{
+    static auto _v =
+        get_config()->find("OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION_THRESHOLD");
+    return static_cast<tim::tsettings<double>&>(*_v->second).get();
+}
+
 bool
 get_trace_thread_barriers()
 {
@@ -2666,7 +3018,8 @@ get_causal_output_filename()
 {
     static auto _v     = get_config()->find("OMNITRACE_CAUSAL_FILE");
     auto        _fname = static_cast<tim::tsettings<std::string>&>(*_v->second).get();
-    for(auto&& itr : std::initializer_list<std::string>{ ".txt", ".json", ".xml" })
+    for(auto&& itr :
+        std::initializer_list<std::string>{ ".txt", ".json", ".jsonl", ".xml" })
     {
         auto _pos = _fname.find(itr);
         // if extension is found at end of string, remove
@@ -191,6 +191,30 @@ get_use_perfetto() OMNITRACE_HOT;
 bool&
 get_use_timemory() OMNITRACE_HOT;
 
+std::string
+get_profile_backend();
+
+std::string
+get_trace_backend();
+
+size_t
+get_event_log_buffer_size();
+
+bool
+get_profile_flat_edges();
+
+bool
+get_throttle_regions();
+
+size_t
+get_throttle_regions_count();
+
+double
+get_throttle_regions_mean_duration();
+
+std::string
+get_timestamp_source();
+
 bool&
 get_use_causal() OMNITRACE_HOT;
 
@@ -215,9 +239,15 @@ get_use_process_sampling() OMNITRACE_HOT;
 bool&
 get_use_pid();
 
+bool
+get_fork_child_profiling();
+
 bool&
 get_use_mpip();
 
+bool
+get_mpi_wait_states();
+
 bool
 get_use_kokkosp();
 
@@ -227,6 +257,9 @@ get_use_kokkosp_kernel_logger();
 bool
 get_use_ompt();
 
+std::set<std::string>
+get_ompt_callbacks();
+
 bool
 get_use_code_coverage();
 
@@ -257,6 +290,9 @@ get_perfetto_buffer_size();
 bool
 get_perfetto_combined_traces();
 
+std::string
+get_perfetto_combine_method();
+
 std::string
 get_perfetto_fill_policy();
 
@@ -303,6 +339,42 @@ get_sampling_realtime_freq();
 double
 get_sampling_overflow_freq();
 
+double
+get_sampling_overhead();
+
+bool
+get_use_sampling_overflow();
+
+bool
+get_use_sampling_realtime();
+
+bool
+get_use_sampling_cputime();
+
+bool
+get_use_sampling_offcpu();
+
+std::string
+get_sampling_perf_events();
+
+bool
+get_use_sampling_memory();
+
+std::string
+get_sampling_memory_event();
+
+size_t
+get_sampling_memory_allocation_size();
+
+bool
+get_use_sampling_branch();
+
+bool
+get_use_heap_profile();
+
+size_t
+get_heap_profile_interval();
+
 double
 get_sampling_delay();
 
@@ -354,6 +426,12 @@ get_trace_thread_rwlocks();
 bool
 get_trace_thread_spin_locks();
 
+bool
+get_trace_thread_locks_contention();
+
+double
+get_trace_thread_locks_contention_threshold();
+
 bool
 get_trace_thread_barriers();
 
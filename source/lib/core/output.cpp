@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "output.hpp"
+#include "config.hpp"
+#include "debug.hpp"
+#include "timemory.hpp"
+
+#include <timemory/utility/filepath.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace omnitrace
+{
+namespace output
+{
+namespace
+{
+bool
+get_setting(const std::string& _v)
+{
+    auto&& _b = config::get_setting_value<bool>(_v);
+    OMNITRACE_CI_THROW(!_b, "Error! No configuration setting named '%s'", _v.c_str());
+    return _b.value_or(true);
+}
+
+void
+write_file(const std::string& _label, const std::string& _ext, const text_func_t& _func)
+{
+    auto          _fname = tim::settings::compose_output_filename(_label, _ext);
+    std::ofstream ofs{};
+    if(tim::filepath::open(ofs, _fname))
+    {
+        if(get_verbose() >= 0)
+            operation::file_output_message<tim::project::omnitrace>{}(_fname, _label);
+        _func(ofs);
+    }
+    else
+    {
+        OMNITRACE_THROW("Error opening %s output file: %s", _label.c_str(),
+                        _fname.c_str());
+    }
+}
+}  // namespace
+
+void
+write_text_and_json(const std::string& _label, const text_func_t& _text,
+                    const json_func_t& _json)
+{
+    if(_text && get_setting("OMNITRACE_TEXT_OUTPUT")) write_file(_label, ".txt", _text);
+
+    if(_json && get_setting("OMNITRACE_JSON_OUTPUT"))
+    {
+        std::stringstream oss{};
+        {
+            auto ar = tim::policy::output_archive<json_archive_t>::get(oss);
+
+            ar->setNextName("omnitrace");
+            ar->startNode();
+            _json(*ar);
+            ar->finishNode();
+        }
+        write_file(_label, ".json",
+                   [&oss](std::ostream& _os) { _os << oss.str() << "\n"; });
+    }
+}
+}  // namespace output
+}  // namespace omnitrace
@@ -0,0 +1,46 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <timemory/tpls/cereal/cereal.hpp>
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+namespace omnitrace
+{
+namespace output
+{
+using json_archive_t = tim::cereal::PrettyJSONOutputArchive;
+using text_func_t    = std::function<void(std::ostream&)>;
+using json_func_t    = std::function<void(json_archive_t&)>;
+
+/// writes <label>.txt when OMNITRACE_TEXT_OUTPUT is enabled and <label>.json when
+/// OMNITRACE_JSON_OUTPUT is enabled. The json function is invoked inside of the
+/// top-level "omnitrace" node. Either function may be empty.
+void
+write_text_and_json(const std::string& _label, const text_func_t& _text,
+                    const json_func_t& _json);
+}  // namespace output
+}  // namespace omnitrace
@@ -21,9 +21,17 @@
 // SOFTWARE.
 
 #include "perf.hpp"
+#include "common.hpp"
 #include "debug.hpp"
 
 #include <timemory/units.hpp>
+#include <timemory/utility/delimit.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <string>
 
 namespace omnitrace
 {
@@ -31,6 +39,45 @@ namespace perf
 {
 namespace units = ::tim::units;
 
+namespace
+{
+std::string
+read_pmu_file(std::string_view _pmu, std::string_view _file)
+{
+    auto _ifs = std::ifstream{ JOIN("", "/sys/bus/event_source/devices/", _pmu, "/",
+                                    _file) };
+    auto _v   = std::string{};
+    if(_ifs) std::getline(_ifs, _v);
+    return _v;
+}
+
+// deposits the value into the bits of config, config1, or config2 described by the
+// format specification of the PMU, e.g. "config:0-7" or "config1:0-15"
+bool
+set_pmu_format_field(struct perf_event_attr& _pe, std::string_view _pmu,
+                     const std::string& _field, uint64_t _value)
+{
+    auto _spec = read_pmu_file(_pmu, JOIN("", "format/", _field));
+    auto _pos  = _spec.find(':');
+    if(_pos == std::string::npos) return false;
+
+    auto  _target = _spec.substr(0, _pos);
+    auto* _config = (_target == "config1")   ? &_pe.config1
+                    : (_target == "config2") ? &_pe.config2
+                                             : &_pe.config;
+
+    for(const auto& itr : tim::delimit(_spec.substr(_pos + 1), ","))
+    {
+        auto _range = tim::delimit(itr, "-");
+        auto _lo    = std::stoul(_range.front());
+        auto _hi    = std::stoul(_range.back());
+        for(auto i = _lo; i <= _hi; ++i, _value >>= 1)
+            *_config |= ((_value & 1) << i);
+    }
+    return true;
+}
+}  // namespace
+
 std::vector<std::string>
 get_config_choices()
 {
@@ -240,5 +287,67 @@ config_overflow_sampling(struct perf_event_attr& _pe, std::string_view _event,
         _pe.sample_period = static_cast<uint64_t>(_freq);
     }
 }
+
+std::optional<std::string>
+config_memory_sampling(struct perf_event_attr& _pe, std::string_view _event,
+                       uint64_t _period)
+{
+    // same load-latency threshold (in cycles) as the default of `perf mem`
+    constexpr uint64_t load_latency = 30;
+
+    _pe.config        = 0;
+    _pe.config1       = 0;
+    _pe.config2       = 0;
+    _pe.sample_period = _period;
+
+    // Intel: the kernel exports the PEBS load-latency and precise-store events of the
+    // core PMU as aliases, e.g. "event=0xcd,umask=0x1,ldlat=3"
+    for(const auto* _pmu : { "cpu", "cpu_core" })
+    {
+        auto _type  = read_pmu_file(_pmu, "type");
+        auto _alias = read_pmu_file(_pmu, JOIN("", "events/", _event));
+        if(_type.empty() || _alias.empty()) continue;
+
+        _pe.type       = std::stoul(_type);
+        _pe.precise_ip = 2;
+        for(const auto& itr : tim::delimit(_alias, ","))
+        {
+            auto _pos   = itr.find('=');
+            auto _field = itr.substr(0, _pos);
+            auto _value = (_pos == std::string::npos)
+                              ? uint64_t{ 1 }
+                              : std::strtoull(itr.substr(_pos + 1).c_str(), nullptr, 0);
+            if(_field == "ldlat") _value = std::max(_value, load_latency);
+            if(!set_pmu_format_field(_pe, _pmu, _field, _value))
+                return JOIN("", "unknown format field '", _field, "' in the ", _pmu,
+                            " PMU event '", _event, "'");
+        }
+        return std::optional<std::string>{};
+    }
+
+    // AMD: instruction-based sampling of micro-ops reports the data address, the
+    // data source, and the latency of the sampled loads and stores
+    auto _ibs_type = read_pmu_file("ibs_op", "type");
+    if(!_ibs_type.empty())
+    {
+        // the micro-ops are sampled regardless of their type so the samples are a mix
+        // of the loads and stores and the choice of the event cannot be honored
+        static auto _warned = std::atomic<bool>{ false };
+        if(!_warned.exchange(true))
+        {
+            OMNITRACE_WARNING_F(0,
+                                "AMD IBS samples both memory loads and stores. The "
+                                "memory sampling event '%s' is ignored\n",
+                                std::string{ _event }.c_str());
+        }
+
+        _pe.type       = std::stoul(_ibs_type);
+        _pe.precise_ip = 0;
+        return std::optional<std::string>{};
+    }
+
+    return JOIN("", "no PMU supports sampling the data addresses of ", _event,
+                " (requires Intel PEBS or AMD IBS)");
+}
 }  // namespace perf
 }  // namespace omnitrace
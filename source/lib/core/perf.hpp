@@ -28,6 +28,9 @@
 
 #include <cstdint>
 #include <linux/perf_event.h>
+#include <optional>
+#include <string>
+#include <string_view>
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
 #    include <sys/syscall.h>
@@ -287,5 +290,11 @@ int        get_hw_cache_config(std::string_view);
 
 void
 config_overflow_sampling(struct perf_event_attr&, std::string_view, double);
+
+/// configures the precise event which samples the data address of memory loads
+/// ("mem-loads") or stores ("mem-stores"). AMD IBS cannot select between them and
+/// samples both (with a warning). Returns an error message if unsupported
+std::optional<std::string>
+config_memory_sampling(struct perf_event_attr&, std::string_view, uint64_t);
 }  // namespace perf
 }  // namespace omnitrace
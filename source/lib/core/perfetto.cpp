@@ -26,6 +26,18 @@
 #include "perfetto_fwd.hpp"
 #include "utility.hpp"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(TIMEMORY_USE_MPI) && TIMEMORY_USE_MPI > 0
+#    include <mpi.h>
+#endif
+
 namespace omnitrace
 {
 namespace perfetto
@@ -63,6 +75,231 @@ get_session(pid_t _pid = process::get_id())
         _v.emplace(_pid, std::unique_ptr<::perfetto::TracingSession>{});
     return _v.at(_pid);
 }
+
+// streams the trace data held by the tracing session to the callback in chunks
+// instead of materializing the entire trace in memory
+template <typename FuncT>
+size_t
+read_session_data(::perfetto::TracingSession* _session, FuncT&& _func)
+{
+    size_t _nbytes  = 0;
+    auto   _promise = std::promise<void>{};
+    auto   _future  = _promise.get_future();
+
+    _session->ReadTrace([&](::perfetto::TracingSession::ReadTraceCallbackArgs _args) {
+        if(_args.data && _args.size > 0)
+        {
+            _func(_args.data, _args.size);
+            _nbytes += _args.size;
+        }
+        if(!_args.has_more) _promise.set_value();
+    });
+
+    _future.wait();
+    return _nbytes;
+}
+
+bool
+write_fd(int _fd, const char* _data, size_t _size)
+{
+    while(_size > 0)
+    {
+        auto _n = ::write(_fd, _data, _size);
+        if(_n < 0)
+        {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        _data += _n;
+        _size -= _n;
+    }
+    return true;
+}
+
+// copies the file contents in the kernel when possible, otherwise falls back
+// to copying through a fixed-size buffer
+bool
+copy_fd(int _src, int _dst)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+    size_t _ncopied = 0;
+    while(true)
+    {
+        auto _n = ::copy_file_range(_src, nullptr, _dst, nullptr, (1UL << 30), 0);
+        if(_n == 0) return true;
+        if(_n > 0)
+        {
+            _ncopied += _n;
+            continue;
+        }
+        if(errno == EINTR) continue;
+        // cross-filesystem copies are not supported by older kernels
+        if(_ncopied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                             errno == EOPNOTSUPP))
+            break;
+        return false;
+    }
+#endif
+
+    auto _buffer = std::vector<char>(4 * units::MB);
+    while(true)
+    {
+        auto _n = ::read(_src, _buffer.data(), _buffer.size());
+        if(_n == 0) return true;
+        if(_n < 0)
+        {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        if(!write_fd(_dst, _buffer.data(), _n)) return false;
+    }
+}
+
+// moves the temporary file to the output file. Renames when the files are on the
+// same filesystem, otherwise copies the data without reading it into memory
+bool
+move_file(const std::string& _src, const std::string& _dst)
+{
+    {
+        // creates the output directory (if necessary)
+        std::ofstream _ofs{};
+        if(!filepath::open(_ofs, _dst, std::ios::out | std::ios::binary)) return false;
+    }
+
+    if(::rename(_src.c_str(), _dst.c_str()) == 0) return true;
+
+    OMNITRACE_VERBOSE(2, "Renaming '%s' to '%s' failed (%s). Copying...\n", _src.c_str(),
+                      _dst.c_str(), strerror(errno));
+
+    int _ifd = ::open(_src.c_str(), O_RDONLY);
+    if(_ifd < 0) return false;
+    int _ofd = ::open(_dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(_ofd < 0)
+    {
+        ::close(_ifd);
+        return false;
+    }
+
+    auto _success = copy_fd(_ifd, _ofd);
+    ::close(_ifd);
+    ::close(_ofd);
+    if(_success) ::remove(_src.c_str());
+    return _success;
+}
+
+size_t
+get_file_size(const std::string& _fname)
+{
+    struct stat _buf = {};
+    if(::stat(_fname.c_str(), &_buf) != 0) return 0;
+    return static_cast<size_t>(_buf.st_size);
+}
+
+// inserts the rank before the extension, e.g. perfetto-trace.proto ->
+// perfetto-trace.rank-1.proto
+std::string
+get_shard_filename(const std::string& _fname, int _rank)
+{
+    auto _dir = _fname.find_last_of('/');
+    auto _ext = _fname.find_last_of('.');
+    if(_ext == std::string::npos || (_dir != std::string::npos && _ext < _dir))
+        return JOIN('.', _fname, JOIN('-', "rank", _rank));
+    return JOIN('.', _fname.substr(0, _ext), JOIN('-', "rank", _rank),
+                _fname.substr(_ext + 1));
+}
+
+#if defined(TIMEMORY_USE_MPI) && TIMEMORY_USE_MPI > 0
+// writes the shard of each rank into its offset of the combined output file via
+// MPI-IO. Only an exclusive scan of the shard sizes is communicated so the memory
+// required by each rank is bounded by the size of the copy buffer regardless of the
+// number of ranks. Rank 0's output filename is used by all ranks.
+bool
+combine_mpi_io(const std::string& _shard, std::string& _filename, size_t& _nbytes)
+{
+    constexpr size_t max_chunk_size = 16 * units::MB;
+
+    auto _comm = MPI_COMM_WORLD;
+    int  _rank = 0;
+    PMPI_Comm_rank(_comm, &_rank);
+
+    uint64_t _len = _filename.length();
+    PMPI_Bcast(&_len, 1, MPI_UINT64_T, 0, _comm);
+    auto _output = (_rank == 0) ? _filename : std::string(_len, '\0');
+    PMPI_Bcast(_output.data(), _len, MPI_CHAR, 0, _comm);
+    _filename = _output;
+
+    uint64_t _size   = get_file_size(_shard);
+    uint64_t _offset = 0;
+    uint64_t _total  = 0;
+    PMPI_Exscan(&_size, &_offset, 1, MPI_UINT64_T, MPI_SUM, _comm);
+    PMPI_Allreduce(&_size, &_total, 1, MPI_UINT64_T, MPI_SUM, _comm);
+    // the result of the exclusive scan is undefined on rank 0
+    if(_rank == 0) _offset = 0;
+
+    _nbytes = _total;
+    if(_total == 0) return true;
+
+    // rank 0 creates the output directory and truncates any existing file
+    int _success = 1;
+    if(_rank == 0)
+    {
+        std::ofstream _ofs{};
+        _success = (filepath::open(_ofs, _filename,
+                                   std::ios::out | std::ios::binary | std::ios::trunc))
+                       ? 1
+                       : 0;
+    }
+    PMPI_Bcast(&_success, 1, MPI_INT, 0, _comm);
+    if(_success == 0) return false;
+
+    auto _fh     = MPI_File{};
+    int  _opened = (PMPI_File_open(_comm, _filename.c_str(),
+                                  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                                  &_fh) == MPI_SUCCESS)
+                       ? 1
+                       : 0;
+    int  _all_opened = 0;
+    PMPI_Allreduce(&_opened, &_all_opened, 1, MPI_INT, MPI_LAND, _comm);
+    if(_all_opened == 0)
+    {
+        if(_opened != 0) PMPI_File_close(&_fh);
+        return false;
+    }
+
+    auto _set_size = PMPI_File_set_size(_fh, static_cast<MPI_Offset>(_total));
+    _success       = (_set_size == MPI_SUCCESS) ? 1 : 0;
+
+    int _ifd = (_size > 0) ? ::open(_shard.c_str(), O_RDONLY) : -1;
+    if(_size > 0 && _ifd < 0) _success = 0;
+
+    auto     _buffer = std::vector<char>(std::min<size_t>(_size, max_chunk_size));
+    uint64_t _pos    = 0;
+    while(_success != 0 && _pos < _size)
+    {
+        auto _n = ::read(_ifd, _buffer.data(),
+                         std::min<size_t>(_buffer.size(), _size - _pos));
+        if(_n < 0 && errno == EINTR) continue;
+        if(_n <= 0)
+        {
+            _success = 0;
+            break;
+        }
+        auto _status = MPI_Status{};
+        if(PMPI_File_write_at(_fh, static_cast<MPI_Offset>(_offset + _pos),
+                              _buffer.data(), static_cast<int>(_n), MPI_BYTE,
+                              &_status) != MPI_SUCCESS)
+            _success = 0;
+        _pos += _n;
+    }
+
+    if(_ifd >= 0) ::close(_ifd);
+    PMPI_File_close(&_fh);
+
+    int _all_success = 0;
+    PMPI_Allreduce(&_success, &_all_success, 1, MPI_INT, MPI_LAND, _comm);
+    return (_all_success != 0);
+}
+#endif
 }  // namespace
 
 void
@@ -160,116 +397,272 @@ stop()
 void
 post_process(tim::manager* _timemory_manager, bool& _perfetto_output_error)
 {
-    using char_vec_t = std::vector<char>;
-
     stop();
 
     auto& tracing_session = get_perfetto_session();
     if(!tracing_session) return;
 
-    auto _get_session_data = [&tracing_session]() {
-        auto _data     = char_vec_t{};
-        auto _tmp_file = get_perfetto_tmp_file();
-        if(_tmp_file && *_tmp_file)
-        {
-            _tmp_file->close();
-            FILE* _fdata = fopen(_tmp_file->filename.c_str(), "rb");
+    auto _filename = config::get_perfetto_output_filename();
 
-            if(!_fdata)
-            {
-                OMNITRACE_VERBOSE(
-                    -1, "Error! perfetto temp trace file '%s' could not be read",
-                    _tmp_file->filename.c_str());
-                return char_vec_t{ tracing_session->ReadTraceBlocking() };
-            }
+    using file_output_message_t = operation::file_output_message<tim::project::omnitrace>;
+
+    auto _report = [&_filename](file_output_message_t& _fom, size_t _nbytes) {
+        if(config::get_verbose() >= 0)
+            _fom(_filename, std::string{ "perfetto" },
+                 " (%.2f KB / %.2f MB / %.2f GB)... ",
+                 static_cast<double>(_nbytes) / units::KB,
+                 static_cast<double>(_nbytes) / units::MB,
+                 static_cast<double>(_nbytes) / units::GB);
+    };
 
-            fseek(_fdata, 0, SEEK_END);
-            size_t _fnum_elem = ftell(_fdata);
-            fseek(_fdata, 0, SEEK_SET);  // same as rewind(f);
+    auto _report_empty = [&_filename]() {
+        if(dmp::rank() == 0)
+        {
+            OMNITRACE_VERBOSE(
+                0, "perfetto trace data is empty. File '%s' will not be written...\n",
+                _filename.c_str());
+        }
+    };
 
-            _data.resize(_fnum_elem + 1);
-            auto _fnum_read = fread(_data.data(), sizeof(char), _fnum_elem, _fdata);
-            fclose(_fdata);
+    auto _report_success = [&](file_output_message_t& _fom) {
+        if(config::get_verbose() >= 0) _fom.append("%s", "Done");  // NOLINT
+        if(_timemory_manager)
+            _timemory_manager->add_file_output("protobuf", "perfetto", _filename);
+    };
 
-            OMNITRACE_CI_THROW(
-                _fnum_read != _fnum_elem,
-                "Error! read %zu elements from perfetto trace file '%s'. Expected %zu\n",
-                _fnum_read, _tmp_file->filename.c_str(), _fnum_elem);
+    auto& _tmp_file = get_perfetto_tmp_file();
+    auto  _tmp_dtor = scope::destructor{ [&_tmp_file]() {
+        if(_tmp_file)
+        {
+            _tmp_file->close();
+            _tmp_file->remove();
+            _tmp_file.reset();
         }
+    } };
+
+    // append whatever the session still holds in memory to the temporary file
+    auto _append_tmp_file = [&]() {
+        _tmp_file->flush();
+        int  _fd      = _tmp_file->fd;
+        bool _success = true;
+        ::lseek(_fd, 0, SEEK_END);
+        read_session_data(tracing_session.get(),
+                          [_fd, &_success](const char* _data, size_t _size) {
+                              if(_success) _success = write_fd(_fd, _data, _size);
+                          });
+        _tmp_file->close();
 
-        return utility::combine(_data,
-                                char_vec_t{ tracing_session->ReadTraceBlocking() });
+        if(!_success)
+        {
+            OMNITRACE_WARNING_F(-1,
+                                "failed to append the remaining session data to perfetto "
+                                "temp trace file '%s'. The trace will be incomplete\n",
+                                _tmp_file->filename.c_str());
+            _perfetto_output_error = true;
+        }
+        return _success;
     };
 
-    auto trace_data = char_vec_t{};
 #if defined(TIMEMORY_USE_MPI) && TIMEMORY_USE_MPI > 0
+    if(get_perfetto_combined_traces() &&
+       config::get_perfetto_combine_method() == "mpi-io" && dmp::is_initialized() &&
+       dmp::size() > 1)
+    {
+        // each rank finalizes its trace into a shard file and then the shards are
+        // written into the combined output file in parallel
+        auto _shard = std::string{};
+        if(_tmp_file && *_tmp_file)
+        {
+            _shard = _tmp_file->filename;
+            _append_tmp_file();
+        }
+        else
+        {
+            _shard = get_shard_filename(_filename, dmp::rank());
+            std::ofstream ofs{};
+            bool          _open_error = false;
+            read_session_data(tracing_session.get(),
+                              [&](const char* _data, size_t _size) {
+                                  if(_open_error) return;
+                                  if(!ofs.is_open() &&
+                                     !filepath::open(ofs, _shard,
+                                                     std::ios::out | std::ios::binary))
+                                  {
+                                      _open_error = true;
+                                      return;
+                                  }
+                                  ofs.write(_data, _size);
+                              });
+            ofs.close();
+            if(_open_error)
+            {
+                OMNITRACE_WARNING_F(-1, "failed to write perfetto shard '%s'\n",
+                                    _shard.c_str());
+                _perfetto_output_error = true;
+            }
+        }
+
+        size_t _nbytes = 0;
+        if(combine_mpi_io(_shard, _filename, _nbytes))
+        {
+            if(!_tmp_file) ::remove(_shard.c_str());
+            if(dmp::rank() == 0)
+            {
+                if(_nbytes > 0)
+                {
+                    auto _fom = file_output_message_t{};
+                    _report(_fom, _nbytes);
+                    _report_success(_fom);
+                }
+                else
+                {
+                    _report_empty();
+                }
+            }
+        }
+        else if(get_file_size(_shard) > 0)
+        {
+            // keep the trace of this rank so that it can be combined offline
+            auto _fallback = get_shard_filename(_filename, dmp::rank());
+            if(_fallback != _shard && !move_file(_shard, _fallback)) _fallback = _shard;
+            OMNITRACE_VERBOSE(-1,
+                              "Error! combining the perfetto traces via MPI-IO failed. "
+                              "The trace of rank %i was written to '%s'. Use "
+                              "omnitrace-merge-perfetto to combine the traces of each "
+                              "rank\n",
+                              dmp::rank(), _fallback.c_str());
+            _perfetto_output_error = true;
+        }
+        return;
+    }
+
     if(get_perfetto_combined_traces())
     {
+        using char_vec_t         = std::vector<char>;
         using perfetto_mpi_get_t = tim::operation::finalize::mpi_get<char_vec_t, true>;
 
-        auto _trace_data = _get_session_data();
-        auto _rank_data  = std::vector<char_vec_t>{};
-        auto _combine    = [](char_vec_t& _dst, const char_vec_t& _src) -> char_vec_t& {
+        auto _trace_data = char_vec_t{};
+        if(_tmp_file && *_tmp_file)
+        {
+            _tmp_file->close();
+            auto _fsize = get_file_size(_tmp_file->filename);
+            auto _ifs   = std::ifstream{ _tmp_file->filename, std::ios::binary };
+            _trace_data.resize(_fsize);
+            if(_fsize > 0 && !_ifs.read(_trace_data.data(), _fsize))
+            {
+                OMNITRACE_VERBOSE(
+                    -1, "Error! perfetto temp trace file '%s' could not be read\n",
+                    _tmp_file->filename.c_str());
+                _trace_data.clear();
+            }
+        }
+        read_session_data(tracing_session.get(), [&_trace_data](const char* _data,
+                                                                size_t      _size) {
+            _trace_data.insert(_trace_data.end(), _data, _data + _size);
+        });
+
+        auto _rank_data = std::vector<char_vec_t>{};
+        auto _combine   = [](char_vec_t& _dst, const char_vec_t& _src) -> char_vec_t& {
             _dst.reserve(_dst.size() + _src.size());
             for(auto&& itr : _src)
                 _dst.emplace_back(itr);
             return _dst;
         };
 
+        auto trace_data = char_vec_t{};
         perfetto_mpi_get_t{ get_perfetto_combined_traces(),
                             settings::node_count() }(_rank_data, _trace_data, _combine);
         for(auto& itr : _rank_data)
             trace_data =
                 (trace_data.empty()) ? std::move(itr) : _combine(trace_data, itr);
+
+        if(!trace_data.empty())
+        {
+            auto          _fom = file_output_message_t{};
+            std::ofstream ofs{};
+            _report(_fom, trace_data.size());
+            if(!filepath::open(ofs, _filename, std::ios::out | std::ios::binary))
+            {
+                _fom.append("Error opening '%s'...", _filename.c_str());
+                _perfetto_output_error = true;
+            }
+            else
+            {
+                ofs.write(trace_data.data(), trace_data.size());
+                _report_success(_fom);
+            }
+        }
+        else
+        {
+            _report_empty();
+        }
+        return;
     }
-    else
-    {
-        trace_data = _get_session_data();
-    }
-#else
-    trace_data = _get_session_data();
 #endif
 
-    auto _filename = config::get_perfetto_output_filename();
-    if(!trace_data.empty())
+    if(_tmp_file && *_tmp_file)
     {
-        operation::file_output_message<tim::project::omnitrace> _fom{};
-        // Write the trace into a file.
-        if(config::get_verbose() >= 0)
-            _fom(_filename, std::string{ "perfetto" },
-                 " (%.2f KB / %.2f MB / %.2f GB)... ",
-                 static_cast<double>(trace_data.size()) / units::KB,
-                 static_cast<double>(trace_data.size()) / units::MB,
-                 static_cast<double>(trace_data.size()) / units::GB);
-        std::ofstream ofs{};
-        if(!filepath::open(ofs, _filename, std::ios::out | std::ios::binary))
+        // append the remaining session data to the temporary file and then move
+        // the temporary file to the output file
+        _append_tmp_file();
+
+        auto _nbytes = get_file_size(_tmp_file->filename);
+        if(_nbytes > 0)
         {
-            _fom.append("Error opening '%s'...", _filename.c_str());
-            _perfetto_output_error = true;
+            auto _fom = file_output_message_t{};
+            _report(_fom, _nbytes);
+            if(!move_file(_tmp_file->filename, _filename))
+            {
+                _fom.append("Error writing '%s'...", _filename.c_str());
+                _perfetto_output_error = true;
+            }
+            else
+            {
+                _report_success(_fom);
+            }
         }
         else
         {
-            // Write the trace into a file.
-            ofs.write(&trace_data[0], trace_data.size());
-            if(config::get_verbose() >= 0) _fom.append("%s", "Done");  // NOLINT
-            if(_timemory_manager)
-                _timemory_manager->add_file_output("protobuf", "perfetto", _filename);
+            _report_empty();
         }
-        ofs.close();
     }
-    else if(dmp::rank() == 0)
+    else
     {
-        OMNITRACE_VERBOSE(
-            0, "perfetto trace data is empty. File '%s' will not be written...\n",
-            _filename.c_str());
-    }
+        // without a temporary file, stream the session data directly to the output
+        // file. The output file is only created when there is data to write.
+        std::ofstream ofs{};
+        bool          _open_error = false;
+        auto          _nbytes     = read_session_data(
+            tracing_session.get(), [&](const char* _data, size_t _size) {
+                if(_open_error) return;
+                if(!ofs.is_open() &&
+                   !filepath::open(ofs, _filename, std::ios::out | std::ios::binary))
+                {
+                    _open_error = true;
+                    return;
+                }
+                ofs.write(_data, _size);
+            });
+        ofs.close();
 
-    auto& _tmp_file = get_perfetto_tmp_file();
-    if(_tmp_file)
-    {
-        _tmp_file->close();
-        _tmp_file->remove();
-        _tmp_file.reset();
+        if(_nbytes > 0)
+        {
+            auto _fom = file_output_message_t{};
+            _report(_fom, _nbytes);
+            if(_open_error)
+            {
+                _fom.append("Error opening '%s'...", _filename.c_str());
+                _perfetto_output_error = true;
+            }
+            else
+            {
+                _report_success(_fom);
+            }
+        }
+        else
+        {
+            _report_empty();
+        }
     }
 }
 
@@ -0,0 +1,229 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "timestamp.hpp"
+#include "config.hpp"
+#include "debug.hpp"
+#include "defines.hpp"
+
+#include <timemory/manager.hpp>
+
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <cpuid.h>
+#endif
+
+namespace omnitrace
+{
+namespace timestamp
+{
+namespace
+{
+struct clock_sample
+{
+    uint64_t ticks     = 0;
+    uint64_t realtime  = 0;
+    uint64_t monotonic = 0;
+};
+
+// reads the counter between two reads of each clock and keeps the reading with the
+// narrowest bracket so that preemption during the calibration does not skew it
+clock_sample
+sample_clocks()
+{
+    auto _best  = clock_sample{};
+    auto _width = std::numeric_limits<uint64_t>::max();
+    for(int i = 0; i < 32; ++i)
+    {
+        auto _real_beg = ::tim::get_clock_real_now<uint64_t, std::nano>();
+        auto _mono_beg = ::tim::get_clock_monotonic_now<uint64_t, std::nano>();
+        auto _ticks    = read_counter();
+        auto _mono_end = ::tim::get_clock_monotonic_now<uint64_t, std::nano>();
+        auto _real_end = ::tim::get_clock_real_now<uint64_t, std::nano>();
+        if(_real_end - _real_beg < _width)
+        {
+            _width = _real_end - _real_beg;
+            _best  = { _ticks, _real_beg + (_real_end - _real_beg) / 2,
+                      _mono_beg + (_mono_end - _mono_beg) / 2 };
+        }
+    }
+    return _best;
+}
+
+// reference for measuring the frequency when the hardware does not report it
+const clock_sample load_sample = sample_clocks();
+
+// frequency of the counter reported by the hardware or zero if it is not reported
+double
+get_reported_frequency()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // CPUID.15H: EBX/EAX is the ratio of the TSC to the crystal clock and ECX is
+    // the frequency of the crystal clock
+    unsigned int _eax = 0, _ebx = 0, _ecx = 0, _edx = 0;
+    if(__get_cpuid_max(0, nullptr) < 0x15) return 0.0;
+    if(__get_cpuid(0x15, &_eax, &_ebx, &_ecx, &_edx) == 0) return 0.0;
+    if(_eax == 0 || _ebx == 0 || _ecx == 0) return 0.0;
+    return static_cast<double>(_ecx) * _ebx / _eax;
+#elif defined(__aarch64__)
+    uint64_t _v = 0;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(_v));
+    return static_cast<double>(_v);
+#else
+    return 0.0;
+#endif
+}
+
+// the scale applied to the nanoseconds since the reference point in fixed-point
+uint64_t
+get_fixed_point(double _v, uint32_t _shift)
+{
+    return static_cast<uint64_t>(std::llround(std::ldexp(_v, _shift)));
+}
+}  // namespace
+
+bool
+counter_is_available()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // CPUID.80000007H:EDX[8] reports the invariant TSC
+    unsigned int _eax = 0, _ebx = 0, _ecx = 0, _edx = 0;
+    if(__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+    if(__get_cpuid(0x80000007, &_eax, &_ebx, &_ecx, &_edx) == 0) return false;
+    return (_edx & (1U << 8)) != 0;
+#elif defined(__aarch64__)
+    // the generic timer runs at a constant frequency
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+setup()
+{
+    auto& _cal = get_calibration();
+    if(_cal.enabled || config::get_timestamp_source() != "counter") return;
+
+    if(!counter_is_available())
+    {
+        OMNITRACE_VERBOSE(0, "OMNITRACE_TIMESTAMP_SOURCE=counter is not supported on "
+                             "this CPU (no invariant counter). Using CLOCK_REALTIME\n");
+        return;
+    }
+
+    auto _ref  = sample_clocks();
+    auto _freq = get_reported_frequency();
+    if(_freq <= 0.0)
+    {
+        // the monotonic clock is not subject to the adjustments made to the realtime
+        // clock
+        constexpr uint64_t min_elapsed = 1000000;
+        auto               _elapsed    = _ref.monotonic - load_sample.monotonic;
+        if(_ref.ticks <= load_sample.ticks || _elapsed < min_elapsed)
+        {
+            OMNITRACE_VERBOSE(0, "Calibration of the timestamp counter failed. Using "
+                                 "CLOCK_REALTIME\n");
+            return;
+        }
+        _freq = static_cast<double>(_ref.ticks - load_sample.ticks) /
+                (static_cast<double>(_elapsed) * 1.0e-9);
+    }
+
+    _cal.frequency = _freq;
+    _cal.mult      = get_fixed_point(1.0e9 / _freq, _cal.shift);
+    _cal.fit_mult  = get_fixed_point(1.0, _cal.shift);
+    _cal.ticks     = _ref.ticks;
+    _cal.realtime  = _ref.realtime;
+    _cal.monotonic = _ref.monotonic;
+    _cal.enabled   = true;
+
+    OMNITRACE_VERBOSE(1, "Timestamp counter frequency: %.3f MHz\n", _freq * 1.0e-6);
+}
+
+const calibration&
+get_fit()
+{
+    auto& _cal = get_calibration();
+    if(!_cal.enabled || _cal.fitted) return _cal;
+
+    // the rate is fit against the monotonic clock since it is not subject to the
+    // adjustments made to the realtime clock
+    auto _sample    = sample_clocks();
+    auto _predicted = to_nsec(_sample.ticks, _cal);
+    if(_predicted > _cal.realtime && _sample.monotonic > _cal.monotonic)
+    {
+        auto _scale = static_cast<double>(_sample.monotonic - _cal.monotonic) /
+                      static_cast<double>(_predicted - _cal.realtime);
+        _cal.fit_mult = get_fixed_point(_scale, _cal.shift);
+    }
+    _cal.fitted = true;
+
+    // difference (in nanoseconds) between the clocks and the fitted counter
+    auto _fitted     = fit(_predicted);
+    auto _real_drift = static_cast<int64_t>(_sample.realtime - _fitted);
+    auto _mono_drift = static_cast<int64_t>((_sample.monotonic - _cal.monotonic) -
+                                            (_fitted - _cal.realtime));
+    auto _init_drift = static_cast<int64_t>(_fitted - _predicted);
+
+    OMNITRACE_VERBOSE(1,
+                      "Timestamp counter drift: %lli nsec (CLOCK_REALTIME), %lli nsec "
+                      "(CLOCK_MONOTONIC), %lli nsec (initial frequency)\n",
+                      static_cast<long long>(_real_drift),
+                      static_cast<long long>(_mono_drift),
+                      static_cast<long long>(_init_drift));
+
+    OMNITRACE_METADATA("TIMESTAMP_COUNTER_FREQUENCY", _cal.frequency);
+    OMNITRACE_METADATA("TIMESTAMP_COUNTER_REALTIME_DRIFT_NSEC", _real_drift);
+    OMNITRACE_METADATA("TIMESTAMP_COUNTER_MONOTONIC_DRIFT_NSEC", _mono_drift);
+    OMNITRACE_METADATA("TIMESTAMP_COUNTER_INITIAL_DRIFT_NSEC", _init_drift);
+
+    return _cal;
+}
+
+uint64_t
+fit(uint64_t _ts)
+{
+    using uint128_t = unsigned __int128;
+
+    const auto& _cal = get_fit();
+    if(!_cal.enabled) return _ts;
+    if(_ts >= _cal.realtime)
+        return _cal.realtime +
+               static_cast<uint64_t>(
+                   (uint128_t{ _ts - _cal.realtime } * _cal.fit_mult) >> _cal.shift);
+    return _cal.realtime -
+           static_cast<uint64_t>(
+               (uint128_t{ _cal.realtime - _ts } * _cal.fit_mult) >> _cal.shift);
+}
+
+void
+shutdown()
+{
+    get_fit();
+}
+}  // namespace timestamp
+}  // namespace omnitrace
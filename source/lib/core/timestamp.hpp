@@ -0,0 +1,130 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "common/defines.h"
+
+#include <timemory/components/timing/backends.hpp>
+
+#include <cstdint>
+#include <ratio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+namespace omnitrace
+{
+namespace timestamp
+{
+/// maps hardware counter ticks onto CLOCK_REALTIME nanoseconds via a fixed-point
+/// multiply: realtime + (((ticks - base) * mult) >> shift)
+struct calibration
+{
+    bool     enabled   = false;
+    bool     fitted    = false;
+    uint32_t shift     = 32;
+    uint64_t mult      = 0;
+    uint64_t fit_mult  = 0;  // scales the nanoseconds since the reference point
+    uint64_t ticks     = 0;  // counter value at the reference point
+    uint64_t realtime  = 0;  // CLOCK_REALTIME (ns) at the reference point
+    uint64_t monotonic = 0;  // CLOCK_MONOTONIC (ns) at the reference point
+    double   frequency = 0;  // counter ticks per second
+};
+
+/// sets up the counter when OMNITRACE_TIMESTAMP_SOURCE is "counter" and the counter
+/// is usable (e.g. the TSC is invariant). The frequency reported by the hardware is
+/// used when available. Otherwise, it is measured since the library was loaded.
+/// When the counter is not used, timestamps continue to be read from CLOCK_REALTIME
+void
+setup();
+
+/// fits the timestamps and reports how far the counter drifted from CLOCK_REALTIME
+/// and CLOCK_MONOTONIC over the lifetime of the process
+void
+shutdown();
+
+/// re-samples the clocks (once) and fits a line through the samples taken at setup()
+/// and here. The timestamps returned by now() keep the initial frequency so that
+/// they remain consistent with each other during the run
+const calibration&
+get_fit();
+
+/// converts a timestamp returned by now() to the two-point fit. Used by the
+/// post-processing which compares timestamps with other processes
+uint64_t
+fit(uint64_t _ts);
+
+/// whether the hardware counter is a constant-rate timestamp source on this CPU
+bool
+counter_is_available();
+
+inline calibration&
+get_calibration()
+{
+    static calibration _v = {};
+    return _v;
+}
+
+/// reads the time-stamp counter on x86 and the virtual counter on arm64
+OMNITRACE_INLINE uint64_t
+read_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t _v = 0;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(_v));
+    return _v;
+#else
+    return 0;
+#endif
+}
+
+OMNITRACE_INLINE uint64_t
+to_nsec(uint64_t _ticks, const calibration& _cal = get_calibration())
+{
+    using uint128_t = unsigned __int128;
+    if(OMNITRACE_LIKELY(_ticks >= _cal.ticks))
+        return _cal.realtime +
+               static_cast<uint64_t>((uint128_t{ _ticks - _cal.ticks } * _cal.mult) >>
+                                     _cal.shift);
+    // another core read its counter slightly before the reference point
+    return _cal.realtime -
+           static_cast<uint64_t>((uint128_t{ _cal.ticks - _ticks } * _cal.mult) >>
+                                 _cal.shift);
+}
+
+/// current time in CLOCK_REALTIME nanoseconds
+template <typename Tp = uint64_t>
+OMNITRACE_INLINE Tp
+now()
+{
+    const auto& _cal = get_calibration();
+    if(OMNITRACE_LIKELY(_cal.enabled))
+        return static_cast<Tp>(to_nsec(read_counter(), _cal));
+    return ::tim::get_clock_real_now<Tp, std::nano>();
+}
+}  // namespace timestamp
+}  // namespace omnitrace
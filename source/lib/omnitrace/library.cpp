@@ -37,7 +37,9 @@
 #include "core/locking.hpp"
 #include "core/perfetto_fwd.hpp"
 #include "core/timemory.hpp"
+#include "core/timestamp.hpp"
 #include "core/utility.hpp"
+#include "library/branch_sampling.hpp"
 #include "library/causal/data.hpp"
 #include "library/causal/experiment.hpp"
 #include "library/causal/sampling.hpp"
@@ -46,8 +48,13 @@
 #include "library/components/mpi_gotcha.hpp"
 #include "library/components/numa_gotcha.hpp"
 #include "library/components/pthread_gotcha.hpp"
+#include "library/components/pthread_mutex_gotcha.hpp"
 #include "library/components/rocprofiler.hpp"
 #include "library/coverage.hpp"
+#include "library/event_log.hpp"
+#include "library/flat_profile.hpp"
+#include "library/heap_profiler.hpp"
+#include "library/memory_sampling.hpp"
 #include "library/ompt.hpp"
 #include "library/process_sampler.hpp"
 #include "library/ptl.hpp"
@@ -57,6 +64,7 @@
 #include "library/sampling.hpp"
 #include "library/thread_data.hpp"
 #include "library/thread_info.hpp"
+#include "library/throttle.hpp"
 #include "library/tracing.hpp"
 #include "omnitrace/categories.h"  // in omnitrace-user
 
@@ -486,9 +494,24 @@ omnitrace_init_tooling_hidden()
     // ideally these have already been started
     omnitrace_preinit_hidden();
 
+    // calibrate the hardware counter before any timestamps are recorded
+    timestamp::setup();
+
     // start these gotchas once settings have been initialized
     if(get_init_bundle()) get_init_bundle()->start();
 
+    if(memory_sampling::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Setting up the memory sampling allocation tracking...\n");
+        memory_sampling::setup();
+    }
+
+    if(heap_profiler::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Setting up the heap profiler...\n");
+        heap_profiler::setup();
+    }
+
     if(get_use_sampling()) sampling::block_signals();
 
     // perfetto initialization
@@ -496,6 +519,9 @@ omnitrace_init_tooling_hidden()
     {
         OMNITRACE_VERBOSE_F(1, "Setting up Perfetto...\n");
         omnitrace::perfetto::setup();
+        event_log::setup();
+        if(event_log::is_enabled())
+            OMNITRACE_VERBOSE_F(1, "Setting up the host region event log...\n");
     }
 
     tasking::setup();
@@ -504,6 +530,10 @@ omnitrace_init_tooling_hidden()
 
     if(get_use_timemory())
     {
+        flat_profile::setup();
+        if(flat_profile::is_enabled())
+            OMNITRACE_VERBOSE_F(1, "Setting up the flat profile aggregator...\n");
+
         comp::user_global_bundle::global_init();
         std::set<int> _comps{};
         // convert string into set of enumerations
@@ -551,6 +581,12 @@ omnitrace_init_tooling_hidden()
 
     categories::setup();
 
+    if(config::get_throttle_regions())
+    {
+        OMNITRACE_VERBOSE_F(1, "Setting up the region throttling...\n");
+        throttle::setup();
+    }
+
     // if static objects are destroyed in the inverse order of when they are
     // created this should ensure that finalization is called before perfetto
     // ends the tracing session
@@ -685,6 +721,8 @@ omnitrace_finalize_hidden(void)
     }
     else if(_is_child)
     {
+        // returns to the exit function so the child exits with its own status
+        if(component::fork_gotcha::finalize_child()) return;
         set_state(State::Finalized);
         std::quick_exit(EXIT_SUCCESS);
         return;
@@ -726,6 +764,8 @@ omnitrace_finalize_hidden(void)
 
     set_state(State::Finalized);
 
+    timestamp::shutdown();
+
     push_enable_sampling_on_child_threads(false);
     set_sampling_on_all_future_threads(false);
 
@@ -762,6 +802,24 @@ omnitrace_finalize_hidden(void)
     OMNITRACE_DEBUG_F("Copying over all timemory hash information to main thread...\n");
     tracing::copy_timemory_hash_ids();
 
+    if(throttle::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the region throttling...\n");
+        throttle::post_process();
+    }
+
+    if(flat_profile::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the flat profile...\n");
+        flat_profile::post_process();
+    }
+
+    if(event_log::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Converting the host region event log...\n");
+        event_log::post_process();
+    }
+
     // stop the main bundle which has stats for run
     if(get_main_bundle())
     {
@@ -817,6 +875,8 @@ omnitrace_finalize_hidden(void)
 
         pthread_gotcha::shutdown();
         component::numa_gotcha::shutdown();
+        memory_sampling::shutdown();
+        heap_profiler::shutdown();
     }
 
     // stop the gotcha bundle
@@ -905,6 +965,30 @@ omnitrace_finalize_hidden(void)
         sampling::post_process();
     }
 
+    if(memory_sampling::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the memory access samples...\n");
+        memory_sampling::post_process();
+    }
+
+    if(branch_sampling::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the branch records...\n");
+        branch_sampling::post_process();
+    }
+
+    if(heap_profiler::is_enabled())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the heap profile...\n");
+        heap_profiler::post_process();
+    }
+
+    if(config::get_trace_thread_locks_contention())
+    {
+        OMNITRACE_VERBOSE_F(1, "Post-processing the lock contention...\n");
+        component::pthread_mutex_gotcha::post_process();
+    }
+
     if(get_use_causal())
     {
         OMNITRACE_VERBOSE_F(1, "Finishing the causal experiments...\n");
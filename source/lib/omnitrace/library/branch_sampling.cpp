@@ -0,0 +1,410 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/branch_sampling.hpp"
+#include "binary/analysis.hpp"
+#include "common/join.hpp"
+#include "core/common.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/output.hpp"
+#include "core/state.hpp"
+#include "library/thread_data.hpp"
+
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/utility/demangle.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omnitrace
+{
+namespace branch_sampling
+{
+namespace
+{
+// straight-line code longer than this is assumed to be a mismatched pair of branch
+// records (e.g. a record lost across a signal) instead of an executed block
+constexpr uint64_t max_block_size = 4096;
+
+// counts of (from, to) address pairs. Each table is only updated by the overflow
+// signal handler of its thread so the updates do not need to be atomic
+struct branch_table
+{
+    static constexpr size_t table_size = (1 << 12);
+    static constexpr size_t max_probes = 32;
+
+    struct entry
+    {
+        uint64_t from    = 0;
+        uint64_t to      = 0;
+        uint64_t count   = 0;
+        uint64_t mispred = 0;
+    };
+
+    using table_t = std::array<entry, table_size>;
+
+    uint64_t samples  = 0;
+    uint64_t branches = 0;
+    uint64_t dropped  = 0;
+    table_t  edges    = {};
+    table_t  blocks   = {};
+
+    void add(table_t&, uint64_t _from, uint64_t _to, bool _mispred);
+};
+
+void
+branch_table::add(table_t& _table, uint64_t _from, uint64_t _to, bool _mispred)
+{
+    auto _hash = (_from * 0x9E3779B97F4A7C15ULL) ^ (_to * 0xC2B2AE3D27D4EB4FULL);
+    _hash ^= (_hash >> 29);
+
+    for(size_t i = 0; i < max_probes; ++i)
+    {
+        auto& _v = _table[(_hash + i) & (table_size - 1)];
+        if(_v.count == 0)
+        {
+            _v.from = _from;
+            _v.to   = _to;
+        }
+        else if(_v.from != _from || _v.to != _to)
+        {
+            continue;
+        }
+        _v.count += 1;
+        _v.mispred += (_mispred) ? 1 : 0;
+        return;
+    }
+    ++dropped;
+}
+
+using branch_table_instances = thread_data<branch_table, category::sampling>;
+
+struct location
+{
+    bool        valid    = false;
+    std::string function = {};
+    std::string source   = {};
+};
+
+// a hot loop (source is the header, target is the latch), a straight-line block
+// (source is the first instruction, target is the taken branch at the end), or a
+// taken-branch edge (source is the branch, target is the destination)
+struct branch_entry
+{
+    std::string function = {};
+    std::string source   = {};
+    std::string target   = {};
+    uint64_t    count    = 0;
+    uint64_t    mispred  = 0;
+    uint64_t    bytes    = 0;
+
+    double get_ratio(uint64_t _v, uint64_t _total) const
+    {
+        return (_total > 0) ? (100.0 * _v) / static_cast<double>(_total) : 0.0;
+    }
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("function", function), cereal::make_nvp("source", source),
+           cereal::make_nvp("target", target), cereal::make_nvp("count", count),
+           cereal::make_nvp("mispredicted", mispred), cereal::make_nvp("bytes", bytes));
+    }
+};
+
+auto&
+get_unavailable()
+{
+    static auto _v = std::atomic<bool>{ false };
+    return _v;
+}
+
+void
+set_unavailable(const std::string& _reason)
+{
+    if(get_unavailable().exchange(true)) return;
+    OMNITRACE_WARNING_F(0,
+                        "branch-record sampling is not available: %s. Overflow "
+                        "sampling will continue without branch records\n",
+                        _reason.c_str());
+}
+
+const location&
+resolve(uintptr_t _addr)
+{
+    static auto _cache = std::unordered_map<uintptr_t, location>{};
+
+    auto itr = _cache.find(_addr);
+    if(itr != _cache.end()) return itr->second;
+
+    auto _v     = location{};
+    auto _entry = binary::lookup_ipaddr_entry<true>(_addr);
+    if(_entry)
+    {
+        _v.valid    = true;
+        _v.function = tim::demangle(_entry->name);
+        // the first line is the innermost inlined function
+        if(_entry->lineinfo && !_entry->lineinfo.lines.empty() &&
+           _entry->lineinfo.lines.front().line > 0)
+        {
+            const auto& _line = _entry->lineinfo.lines.front();
+            _v.source         = TIMEMORY_JOIN(':', _line.location, _line.line);
+        }
+    }
+    if(_v.source.empty()) _v.source = TIMEMORY_JOIN("", "0x", std::hex, _addr);
+
+    return _cache.emplace(_addr, _v).first->second;
+}
+
+void
+write_report(const std::string& _label, uint64_t _total,
+             const std::vector<branch_entry>& _loops,
+             const std::vector<branch_entry>& _blocks,
+             const std::vector<branch_entry>& _edges)
+{
+    output::write_text_and_json(
+        _label,
+        [&](std::ostream& ofs) {
+            auto _write = [&ofs, _total](const char* _title, const char* _count,
+                                         const char* _link, const auto& _data) {
+                ofs << std::setw(12) << _count << "  " << std::setw(10) << "BRANCH (%)"
+                    << "  " << std::setw(11) << "MISPRED (%)"
+                    << "  " << std::setw(8) << "BYTES"
+                    << "  " << _title << "\n";
+                ofs << std::fixed << std::setprecision(2);
+                for(const auto& itr : _data)
+                {
+                    ofs << std::setw(12) << itr.count << "  " << std::setw(10)
+                        << itr.get_ratio(itr.count, _total) << "  " << std::setw(11)
+                        << itr.get_ratio(itr.mispred, itr.count) << "  " << std::setw(8)
+                        << itr.bytes << "  " << itr.function << " :: " << itr.source
+                        << _link << itr.target << "\n";
+                }
+                ofs << "\n";
+            };
+
+            _write("LOOP (HEADER <- LATCH)", "ITERATIONS", " <- ", _loops);
+            _write("BLOCK (FIRST .. BRANCH)", "EXECUTIONS", " .. ", _blocks);
+            _write("TAKEN BRANCH (SOURCE -> TARGET)", "TAKEN", " -> ", _edges);
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("taken_branches", _total),
+               cereal::make_nvp("loops", _loops), cereal::make_nvp("blocks", _blocks),
+               cereal::make_nvp("edges", _edges));
+        });
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return config::get_use_sampling() && config::get_use_sampling_overflow() &&
+           config::get_use_sampling_branch();
+}
+
+bool
+configure(struct perf_event_attr& _pe)
+{
+    if(get_unavailable()) return false;
+
+    // the branch records are stored by the PMU so a software event cannot record them
+    if(_pe.type != PERF_TYPE_HARDWARE && _pe.type != PERF_TYPE_RAW)
+    {
+        set_unavailable("the overflow event is not a hardware event (e.g. "
+                        "PERF_COUNT_HW_CPU_CYCLES)");
+        return false;
+    }
+
+    _pe.sample_type |= PERF_SAMPLE_BRANCH_STACK;
+    _pe.branch_sample_type = PERF_SAMPLE_BRANCH_USER | PERF_SAMPLE_BRANCH_ANY;
+
+    return true;
+}
+
+void
+disable(struct perf_event_attr& _pe, const std::string& _reason)
+{
+    _pe.sample_type &= ~static_cast<uint64_t>(PERF_SAMPLE_BRANCH_STACK);
+    _pe.branch_sample_type = 0;
+    set_unavailable(TIMEMORY_JOIN("",
+                                  "the CPU, kernel, or hypervisor does not provide "
+                                  "branch records (LBR, BRS, or BRBE) for this event (",
+                                  _reason, ")"));
+}
+
+void
+setup(int64_t _tid)
+{
+    branch_table_instances::construct(construct_on_thread{ _tid });
+}
+
+void
+add_sample(int64_t _tid, const struct perf_branch_entry* _data, size_t _n)
+{
+    auto* _tables = branch_table_instances::get();
+    if(!_tables || _data == nullptr || _n == 0) return;
+    if(static_cast<size_t>(_tid) >= _tables->size()) return;
+
+    // the table is allocated before the sampling starts, never in the signal handler
+    auto& _table = _tables->at(_tid);
+    if(!_table) return;
+
+    _table->samples += 1;
+    for(size_t i = 0; i < _n; ++i)
+    {
+        const auto& _branch = _data[i];
+        if(_branch.from == 0 || _branch.to == 0) continue;
+
+        _table->branches += 1;
+        _table->add(_table->edges, _branch.from, _branch.to, _branch.mispred != 0);
+
+        // the records are most recent first so the code from the target of the
+        // older branch up to the source of this branch ran without a taken branch
+        if(i + 1 < _n)
+        {
+            auto _beg = _data[i + 1].to;
+            auto _end = _branch.from;
+            if(_beg != 0 && _beg <= _end && (_end - _beg) <= max_block_size)
+                _table->add(_table->blocks, _beg, _end, false);
+        }
+    }
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    using key_t      = std::pair<uint64_t, uint64_t>;
+    using counts_t   = std::map<key_t, std::pair<uint64_t, uint64_t>>;
+    auto _edges      = counts_t{};
+    auto _blocks     = counts_t{};
+    auto _samples    = uint64_t{ 0 };
+    auto _branches   = uint64_t{ 0 };
+    auto _dropped    = uint64_t{ 0 };
+    auto _merge      = [](counts_t& _dst, const branch_table::table_t& _src) {
+        for(const auto& itr : _src)
+        {
+            if(itr.count == 0) continue;
+            auto& _v = _dst[key_t{ itr.from, itr.to }];
+            _v.first += itr.count;
+            _v.second += itr.mispred;
+        }
+    };
+
+    if(auto* _tables = branch_table_instances::get(); _tables)
+    {
+        for(const auto& itr : *_tables)
+        {
+            if(!itr) continue;
+            _samples += itr->samples;
+            _branches += itr->branches;
+            _dropped += itr->dropped;
+            _merge(_edges, itr->edges);
+            _merge(_blocks, itr->blocks);
+        }
+    }
+
+    // several addresses map to the same source line so the entries are combined by
+    // the function and the source locations
+    using entry_key_t = std::tuple<std::string, std::string, std::string>;
+    auto _loop_data   = std::map<entry_key_t, branch_entry>{};
+    auto _block_data  = std::map<entry_key_t, branch_entry>{};
+    auto _edge_data   = std::map<entry_key_t, branch_entry>{};
+    auto _update      = [](auto& _data, const location& _src, const location& _dst,
+                      uint64_t _count, uint64_t _mispred, uint64_t _bytes) {
+        auto  _key = entry_key_t{ _src.function, _src.source, _dst.source };
+        auto& _v   = _data[_key];
+        if(_v.count == 0)
+            _v = branch_entry{ _src.function, _src.source, _dst.source, 0, 0, 0 };
+        _v.count += _count;
+        _v.mispred += _mispred;
+        _v.bytes = std::max(_v.bytes, _bytes);
+    };
+
+    for(const auto& itr : _edges)
+    {
+        auto _from = itr.first.first;
+        auto _to   = itr.first.second;
+        // copies are stored since the cache may rehash
+        auto _src = resolve(_from);
+        auto _dst = resolve(_to);
+        if(!_src.valid || !_dst.valid) continue;
+
+        _update(_edge_data, _src, _dst, itr.second.first, itr.second.second, 0);
+
+        // a taken branch backwards within a function closes a loop
+        if(_to <= _from && _src.function == _dst.function)
+            _update(_loop_data, _dst, _src, itr.second.first, itr.second.second,
+                    _from - _to);
+    }
+
+    for(const auto& itr : _blocks)
+    {
+        auto _beg = resolve(itr.first.first);
+        auto _end = resolve(itr.first.second);
+        if(!_beg.valid || !_end.valid) continue;
+        _update(_block_data, _beg, _end, itr.second.first, 0,
+                itr.first.second - itr.first.first);
+    }
+
+    OMNITRACE_VERBOSE(1,
+                      "branch sampling :: %zu samples :: %zu taken branches :: %zu "
+                      "loops :: %zu blocks :: %zu dropped\n",
+                      static_cast<size_t>(_samples), static_cast<size_t>(_branches),
+                      _loop_data.size(), _block_data.size(),
+                      static_cast<size_t>(_dropped));
+
+    if(_branches == 0) return;
+
+    auto _sorted = [](const auto& _data) {
+        auto _v = std::vector<branch_entry>{};
+        _v.reserve(_data.size());
+        for(const auto& itr : _data)
+            _v.emplace_back(itr.second);
+        std::sort(_v.begin(), _v.end(), [](const auto& _lhs, const auto& _rhs) {
+            return _lhs.count > _rhs.count;
+        });
+        return _v;
+    };
+
+    write_report("branch-profile", _branches, _sorted(_loop_data), _sorted(_block_data),
+                 _sorted(_edge_data));
+}
+}  // namespace branch_sampling
+}  // namespace omnitrace
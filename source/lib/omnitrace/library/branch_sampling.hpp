@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct perf_event_attr;
+struct perf_branch_entry;
+
+namespace omnitrace
+{
+namespace branch_sampling
+{
+/// returns true when OMNITRACE_SAMPLING_BRANCH and overflow sampling are enabled
+bool
+is_enabled();
+
+/// adds the user-space taken branches to the samples of the overflow sampling event.
+/// Returns false (and reports why once) when the overflow event cannot record branches
+bool
+configure(struct perf_event_attr&);
+
+/// removes the branches from the overflow sampling event after the event failed to
+/// open with them and reports why once. Branches are not requested afterwards
+void
+disable(struct perf_event_attr&, const std::string& _reason);
+
+/// allocates the branch counts of the thread. Must be called before the overflow
+/// sampling of the thread is started
+void
+setup(int64_t _tid);
+
+/// counts the taken branches (most recent first) of a sample. Async-signal-safe
+void
+add_sample(int64_t _tid, const struct perf_branch_entry*, size_t);
+
+/// writes the hot loops, straight-line blocks, and taken-branch edges per source line
+void
+post_process();
+}  // namespace branch_sampling
+}  // namespace omnitrace
@@ -29,6 +29,7 @@
 #include "library/causal/data.hpp"
 #include "library/causal/delay.hpp"
 #include "library/causal/experiment.hpp"
+#include "library/causal/sampling.hpp"
 #include "library/perf.hpp"
 #include "library/runtime.hpp"
 #include "library/thread_data.hpp"
@@ -105,11 +106,14 @@ overflow::sample(int _sig)
 
     m_index = causal::experiment::get_index();
 
+    // the records are still consumed so the ring buffer does not fill up
+    auto _discard = causal::sampling::in_blocking_call();
+
     _perf_event->stop();
 
     for(auto itr : *_perf_event)
     {
-        if(itr.is_sample())
+        if(itr.is_sample() && !_discard)
         {
             auto _sample_ip = itr.get_ip();
             auto _data      = callchain_t{};
@@ -156,7 +160,7 @@ backtrace::sample(int _sig)
     static thread_local size_t _select_count = select_init;
     static thread_local size_t _select_zeros = 0;
 
-    if((_protect_flag & 1) == 1 ||
+    if((_protect_flag & 1) == 1 || causal::sampling::in_blocking_call() ||
        OMNITRACE_UNLIKELY(!trait::runtime_enabled<causal::component::backtrace>::get()))
     {
         return;
@@ -149,9 +149,11 @@ blocking_gotcha::operator()(gotcha_index<Idx>, Ret (*_func)(Args...),
 {
     int64_t _delay_value = causal::delay::get_global().load(std::memory_order_relaxed);
 
-    causal::sampling::block_backtrace_samples();
+    // the pthread functions restart or spuriously wake after a signal handler so the
+    // samples are discarded instead of stopping perf and masking the signals
+    causal::sampling::begin_blocking_call();
     auto _ret = (*_func)(_args...);
-    causal::sampling::unblock_backtrace_samples();
+    causal::sampling::end_blocking_call();
 
     if(get_thread_state() < ::omnitrace::ThreadState::Internal)
     {
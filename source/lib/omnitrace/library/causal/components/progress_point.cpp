@@ -23,7 +23,9 @@
 #include "library/causal/components/progress_point.hpp"
 #include "core/common.hpp"
 #include "core/concepts.hpp"
+#include "core/containers/aligned_static_vector.hpp"
 #include "core/debug.hpp"
+#include "core/locking.hpp"
 #include "core/timemory.hpp"
 #include "library/causal/experiment.hpp"
 #include "library/thread_data.hpp"
@@ -32,29 +34,52 @@
 #include <timemory/mpl/type_traits.hpp>
 #include <timemory/units.hpp>
 
+#include <atomic>
+
 namespace omnitrace
 {
 namespace causal
 {
 namespace component
 {
+// per-thread totals of a progress point. Only the owning thread writes the counters so
+// an increment is a relaxed load and store instead of a locked read-modify-write. The
+// counters are never reset and each one occupies its own cache line so that reading
+// them from the experiment thread neither loses counts nor causes false sharing
+struct alignas(container::cacheline_align_v) progress_counter
+{
+    using counter_type = std::atomic<int64_t>;
+
+    static void add(counter_type& _counter, int64_t _v)
+    {
+        _counter.store(_counter.load(std::memory_order_relaxed) + _v,
+                       std::memory_order_relaxed);
+    }
+
+    tim::hash_value_t hash      = 0;
+    counter_type      delta     = { 0 };
+    counter_type      arrival   = { 0 };
+    counter_type      departure = { 0 };
+};
+
 namespace
 {
-using progress_allocator_t = tim::data::ring_buffer_allocator<progress_point>;
-using progress_map_t       = std::unordered_map<tim::hash_value_t, progress_point*>;
+using progress_allocator_t = tim::data::ring_buffer_allocator<progress_counter>;
 
-auto&
-get_progress_map()
+// the owning thread inserts new progress points while holding the lock and reads
+// without it. get_progress_points() holds the lock while walking the counters
+struct progress_registry
 {
-    using thread_data_t = thread_data<identity<progress_map_t>>;
-    static auto& _v     = thread_data_t::instance(construct_on_init{});
-    return _v;
-}
+    locking::atomic_mutex                                    mutex    = {};
+    std::unordered_map<tim::hash_value_t, progress_counter*> counters = {};
+};
+
+using progress_registry_data_t = thread_data<progress_registry, progress_point>;
 
-progress_map_t&
-get_progress_map(int64_t _tid)
+auto&
+get_progress_registry(int64_t _tid)
 {
-    return get_progress_map()->at(_tid);
+    return progress_registry_data_t::instance(construct_on_thread{ _tid });
 }
 
 auto&
@@ -67,19 +92,23 @@ get_progress_allocator(int64_t _tid)
 std::unordered_map<tim::hash_value_t, progress_point>
 progress_point::get_progress_points()
 {
-    auto _data = std::unordered_map<tim::hash_value_t, progress_point>{};
-    if(!get_progress_map()) return _data;
-    for(const auto& titr : *get_progress_map())
+    auto  _data       = std::unordered_map<tim::hash_value_t, progress_point>{};
+    auto* _registries = progress_registry_data_t::get();
+    if(!_registries) return _data;
+
+    for(auto& titr : *_registries)
     {
-        for(const auto& itr : titr)
+        if(!titr) continue;
+        auto _lk = locking::atomic_lock{ titr->mutex };
+        for(const auto& itr : titr->counters)
         {
-            if(itr.second)
-            {
-                auto& ditr = _data[itr.first];
-                ditr += *itr.second;
-                ditr.set_hash(itr.second->get_hash());
-                itr.second->set_value(0);
-            }
+            const auto* _counter = itr.second;
+            if(!_counter) continue;
+            auto& ditr = _data[itr.first];
+            ditr.set_hash(itr.first);
+            ditr.m_delta += _counter->delta.load(std::memory_order_relaxed);
+            ditr.m_arrival += _counter->arrival.load(std::memory_order_relaxed);
+            ditr.m_departure += _counter->departure.load(std::memory_order_relaxed);
         }
     }
     return _data;
@@ -123,6 +152,14 @@ progress_point::set_value(int64_t _v)
     m_departure = _v;
 }
 
+void
+progress_point::flush(progress_counter& _v) const
+{
+    progress_counter::add(_v.delta, m_delta);
+    progress_counter::add(_v.arrival, m_arrival);
+    progress_counter::add(_v.departure, m_departure);
+}
+
 progress_point&
 progress_point::operator+=(const progress_point& _v)
 {
@@ -214,27 +251,27 @@ push_node<causal::component::progress_point>::operator()(type&        _obj, scop
                                                          hash_value_t _hash,
                                                          int64_t      _tid) const
 {
-    auto itr = causal::component::get_progress_map(_tid).emplace(_hash, nullptr);
-    if(itr.second && !itr.first->second)
+    auto& _registry = causal::component::get_progress_registry(_tid);
+    auto  itr       = _registry->counters.find(_hash);
+    if(itr == _registry->counters.end())
     {
         auto& _alloc = causal::component::get_progress_allocator(_tid);
         auto* _val   = _alloc->allocate(1);
         _alloc->construct(_val);
-        _val->set_hash(_hash);
-        itr.first->second = _val;
+        _val->hash = _hash;
+
+        auto _lk = locking::atomic_lock{ _registry->mutex };
+        itr      = _registry->counters.emplace(_hash, _val).first;
     }
     _obj.set_hash(_hash);
-    _obj.set_iterator(itr.first->second);
+    _obj.set_iterator(itr->second);
 }
 
 void
 pop_node<causal::component::progress_point>::operator()(type& _obj, int64_t) const
 {
     auto* itr = _obj.get_iterator();
-    if(itr && !(_obj.get_is_invalid() || _obj.get_is_running()))
-    {
-        *itr += _obj;
-    }
+    if(itr && !(_obj.get_is_invalid() || _obj.get_is_running())) _obj.flush(*itr);
 }
 }  // namespace operation
 }  // namespace tim
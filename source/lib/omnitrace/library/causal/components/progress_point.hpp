@@ -42,12 +42,14 @@ namespace causal
 {
 namespace component
 {
+struct progress_counter;
+
 struct progress_point : comp::base<progress_point, void>
 {
     using base_type     = comp::base<progress_point, void>;
     using value_type    = int64_t;
     using hash_type     = tim::hash_value_t;
-    using iterator_type = progress_point*;
+    using iterator_type = progress_counter*;
 
     static std::string label();
     static std::string description();
@@ -58,6 +60,7 @@ struct progress_point : comp::base<progress_point, void>
     void            stop();
     void            mark();
     void            set_value(int64_t);
+    void            flush(progress_counter&) const;  // adds counts to thread totals
     progress_point& operator+=(const progress_point&);
     progress_point& operator-=(const progress_point&);
 
@@ -99,14 +102,17 @@ struct progress_point : comp::base<progress_point, void>
         ar(cereal::make_nvp("departure", m_departure));
     }
 
+    // returns the totals of every progress point summed over all threads. The totals
+    // only ever increase so the progress made between two calls is the difference
+    // of the two snapshots
     static std::unordered_map<tim::hash_value_t, progress_point> get_progress_points();
 
 private:
-    hash_type       m_hash      = 0;
-    int64_t         m_delta     = 0;
-    int64_t         m_arrival   = 0;
-    int64_t         m_departure = 0;
-    progress_point* m_iterator  = nullptr;
+    hash_type     m_hash      = 0;
+    int64_t       m_delta     = 0;
+    int64_t       m_arrival   = 0;
+    int64_t       m_departure = 0;
+    iterator_type m_iterator  = nullptr;
 };
 }  // namespace component
 }  // namespace causal
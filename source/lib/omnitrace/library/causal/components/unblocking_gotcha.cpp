@@ -112,9 +112,9 @@ unblocking_gotcha::operator()(gotcha_index<Idx>, Ret (*_func)(Args...),
         {
             int64_t _delay_value = (_active) ? causal::delay::get_global().load() : 0;
 
-            causal::sampling::block_backtrace_samples();
+            causal::sampling::begin_blocking_call();
             auto _ret = (*_func)(_args...);
-            causal::sampling::unblock_backtrace_samples();
+            causal::sampling::end_blocking_call();
 
             causal::delay::postblock(_delay_value);
             return _ret;
@@ -132,9 +132,9 @@ unblocking_gotcha::operator()(gotcha_index<kill_idx>, int (*_func)(pid_t, int),
 
     if(_active && _pid == process::get_id()) causal::delay::process();
 
-    causal::sampling::block_backtrace_samples();
+    causal::sampling::begin_blocking_call();
     auto _ret = (*_func)(_pid, _sig);
-    causal::sampling::unblock_backtrace_samples();
+    causal::sampling::end_blocking_call();
 
     return _ret;
 }
@@ -36,8 +36,11 @@
 #include <timemory/mpl/types.hpp>
 #include <timemory/process/threading.hpp>
 
+#include <algorithm>
 #include <atomic>
-#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
 #include <random>
 
 namespace omnitrace
@@ -55,8 +58,62 @@ get_delay_data()
     return _v;
 }
 
+// pending delays shorter than this are deferred until they accumulate
+constexpr int64_t batch_delay_threshold = 1 * units::usec;
+// bounds on the calibrated wait below which spinning is preferred to sleeping
+constexpr int64_t min_spin_threshold = 5 * units::usec;
+constexpr int64_t max_spin_threshold = 200 * units::usec;
+
+int64_t sleep_overhead = 0;
+int64_t spin_threshold = max_spin_threshold;
+
+// time the thread waited beyond what was required. Consumed before waiting again
+int64_t&
+get_overshoot_credit()
+{
+    static thread_local int64_t _v = 0;
+    return _v;
+}
+
+// the target is in the time base of tracing::now(), which may be the hardware counter,
+// so the remaining time is converted to an absolute CLOCK_MONOTONIC time. Unlike
+// CLOCK_REALTIME, it is not stepped by adjustments to the system time
+void
+sleep_until(int64_t _target)
+{
+    auto _remaining = _target - tracing::now<int64_t>();
+    if(_remaining <= 0) return;
+
+    auto _mono = ::tim::get_clock_monotonic_now<int64_t, std::nano>() + _remaining;
+    auto _ts   = timespec{ static_cast<time_t>(_mono / units::sec),
+                         static_cast<long>(_mono % units::sec) };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &_ts, nullptr) == EINTR)
+    {}
+}
+
+void
+spin_until(int64_t _target)
+{
+    while(tracing::now() < _target)
+    {}
+}
+
+// waits for at least _value nanoseconds and returns the time actually waited.
+// short waits spin because the wake-up latency of a sleep is of the same order
+// as the wait itself. Long waits sleep until the wake-up latency before the
+// target and spin the remainder
 int64_t
-compute_sleep_for_overhead()
+wait_for(int64_t _value)
+{
+    auto _beg    = tracing::now();
+    auto _target = _beg + _value;
+    if(_value > spin_threshold) sleep_until(_target - sleep_overhead);
+    spin_until(_target);
+    return (tracing::now() - _beg);
+}
+
+void
+compute_sleep_overhead()
 {
     using random_engine_t = std::mt19937_64;
     auto   _engine        = random_engine_t{ std::random_device{}() };
@@ -68,38 +125,40 @@ compute_sleep_for_overhead()
     {
         auto    _val = _dist(_engine);
         int64_t _beg = tracing::now();
-        std::this_thread::sleep_for(std::chrono::nanoseconds{ _val });
+        sleep_until(_beg + _val);
         int64_t _end = tracing::now();
         if(i < _nwarm) continue;
         auto _diff = (_end - _beg);
-        OMNITRACE_CONDITIONAL_THROW(
-            _diff < _val, "Error! sleep_for(%zu) [nanoseconds] >= %zu", _val, _diff);
+        OMNITRACE_CONDITIONAL_THROW(_diff < _val,
+                                    "Error! clock_nanosleep(%zu) [nanoseconds] >= %zu",
+                                    _val, _diff);
         _stats += (_diff - _val);
     }
 
+    sleep_overhead = _stats.get_mean();
+    spin_threshold = std::clamp<int64_t>(_stats.get_mean() + 2 * _stats.get_stddev(),
+                                         min_spin_threshold, max_spin_threshold);
+
     OMNITRACE_BASIC_VERBOSE(2,
-                            "[causal] overhead of std::this_thread::sleep_for(...) "
-                            "invocation = %6.3f usec +/- %e\n",
+                            "[causal] overhead of clock_nanosleep(...) invocation = "
+                            "%6.3f usec +/- %e. Delays < %6.3f usec will spin\n",
                             _stats.get_mean() / units::usec,
-                            _stats.get_stddev() / units::usec);
+                            _stats.get_stddev() / units::usec,
+                            static_cast<double>(spin_threshold) / units::usec);
 
     tim::manager::instance()->add_metadata([_stats](auto& ar) {
         ar(tim::cereal::make_nvp("causal thread sleep overhead [nsec]", _stats));
     });
 
     (void) get_delay_data();
-
-    return _stats.get_mean();
 }
-
-int64_t sleep_for_overhead = 0;
 }  // namespace
 
 void
 delay::setup()
 {
     static std::once_flag _once{};
-    std::call_once(_once, []() { sleep_for_overhead = compute_sleep_for_overhead(); });
+    std::call_once(_once, []() { compute_sleep_overhead(); });
 }
 
 void
@@ -113,17 +172,30 @@ delay::process()
         }
         else if(get_global() > get_local())
         {
-            ::omnitrace::causal::sampling::pause();
-            auto _beg = tracing::now();
-            std::this_thread::sleep_for(
-                std::chrono::nanoseconds{ get_global() - get_local() });
-            get_local() += (tracing::now() - _beg);
-            ::omnitrace::causal::sampling::resume();
+            auto  _pending = get_global() - get_local();
+            auto& _credit  = get_overshoot_credit();
+
+            // time previously waited beyond the requirement counts towards this delay
+            auto _consumed = std::min(_credit, _pending);
+            _credit -= _consumed;
+            _pending -= _consumed;
+            get_local() += _consumed;
+
+            if(_pending >= batch_delay_threshold)
+            {
+                ::omnitrace::causal::sampling::begin_blocking_call();
+                auto _elapsed = wait_for(_pending);
+                ::omnitrace::causal::sampling::end_blocking_call();
+
+                get_local() += _pending;
+                _credit += std::max<int64_t>(_elapsed - _pending, 0);
+            }
         }
     }
     else
     {
-        get_local() = get_global();
+        get_local()            = get_global();
+        get_overshoot_credit() = 0;
     }
 }
 
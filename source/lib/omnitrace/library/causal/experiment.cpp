@@ -539,28 +539,30 @@ experiment::save_experiments(std::string _fname_base, const filename_config_t& _
     bool _causal_output_reset =
         config::get_setting_value<bool>("OMNITRACE_CAUSAL_FILE_RESET").value_or(false);
 
+    // records are appended one per line so that the cost of saving is independent of
+    // the number of previous runs. omnitrace-causal-plot reads this file directly and
+    // can convert it to the aggregated JSON layout
+    auto _open_mode =
+        std::ios::out | ((_causal_output_reset) ? std::ios::trunc : std::ios::app);
+
     {
-        auto _saved_experiments = (_causal_output_reset)
-                                      ? std::vector<experiment::record>{}
-                                      : load_experiments(_fname_base, _cfg, false);
-        _saved_experiments.emplace_back(current_record);
         std::stringstream oss{};
         {
             auto ar =
-                tim::policy::output_archive<cereal::PrettyJSONOutputArchive>::get(oss);
+                tim::policy::output_archive<cereal::MinimalJSONOutputArchive>::get(oss);
 
             ar->setNextName("omnitrace");
             ar->startNode();
             ar->setNextName("causal");
             ar->startNode();
-            (*ar)(cereal::make_nvp("records", _saved_experiments));
+            (*ar)(cereal::make_nvp("record", current_record));
             ar->finishNode();
             ar->finishNode();
         }
 
-        auto _fname = tim::settings::compose_output_filename(_fname_base, "json", _cfg);
+        auto _fname = tim::settings::compose_output_filename(_fname_base, "jsonl", _cfg);
         auto ofs    = std::ofstream{};
-        if(tim::filepath::open(ofs, _fname))
+        if(tim::filepath::open(ofs, _fname, _open_mode))
         {
             if(get_verbose() >= 0)
                 operation::file_output_message<experiment>{}(
@@ -576,31 +578,14 @@ experiment::save_experiments(std::string _fname_base, const filename_config_t& _
 
     auto _fname = tim::settings::compose_output_filename(_fname_base, "coz", _cfg);
 
-    // read in existing data
-    auto _existing = std::stringstream{};
-    if(!_causal_output_reset)
-    {
-        std::ifstream ifs{ _fname };
-        if(ifs)
-        {
-            while(ifs && ifs.good())
-            {
-                std::string _line;
-                std::getline(ifs, _line);
-                _existing << _line << "\n";
-            }
-        }
-    }
-
     std::ofstream ofs{};
     ofs.setf(std::ios::fixed);
-    if(tim::filepath::open(ofs, _fname))
+    if(tim::filepath::open(ofs, _fname, _open_mode))
     {
         if(get_verbose() >= 0)
             operation::file_output_message<experiment>{}(
                 _fname, std::string{ "causal_experiments" });
 
-        ofs << _existing.str();
         ofs << "startup\ttime=" << current_record.startup << "\n";
 
         for(auto& itr : current_record.experiments)
@@ -683,21 +668,43 @@ std::vector<experiment::record>
 experiment::load_experiments(std::string _fname, const filename_config_t& _cfg,
                              bool _throw_on_error)
 {
-    _fname = tim::settings::compose_input_filename(_fname, "json", _cfg);
+    _fname = tim::settings::compose_input_filename(_fname, "jsonl", _cfg);
 
     auto ifs   = std::ifstream{};
     auto _data = std::vector<experiment::record>{};
     if(tim::filepath::open(ifs, _fname))
     {
-        auto ar = tim::policy::input_archive<cereal::JSONInputArchive>::get(ifs);
-
-        ar->setNextName("omnitrace");
-        ar->startNode();
-        ar->setNextName("causal");
-        ar->startNode();
-        (*ar)(cereal::make_nvp("records", _data));
-        ar->finishNode();
-        ar->finishNode();
+        size_t _lineno = 0;
+        while(ifs && ifs.good())
+        {
+            auto _line = std::string{};
+            std::getline(ifs, _line);
+            ++_lineno;
+            if(_line.empty()) continue;
+
+            try
+            {
+                auto _iss = std::stringstream{ _line };
+                auto ar = tim::policy::input_archive<cereal::JSONInputArchive>::get(_iss);
+                auto _record = experiment::record{};
+
+                ar->setNextName("omnitrace");
+                ar->startNode();
+                ar->setNextName("causal");
+                ar->startNode();
+                (*ar)(cereal::make_nvp("record", _record));
+                ar->finishNode();
+                ar->finishNode();
+                _data.emplace_back(std::move(_record));
+            } catch(std::exception& _e)
+            {
+                // a run which was killed while saving leaves a truncated final record
+                OMNITRACE_VERBOSE(0,
+                                  "Skipping malformed causal record on line %zu of %s: "
+                                  "%s\n",
+                                  _lineno, _fname.c_str(), _e.what());
+            }
+        }
     }
     else
     {
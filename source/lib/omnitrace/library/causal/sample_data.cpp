@@ -21,11 +21,14 @@
 // SOFTWARE.
 
 #include "library/causal/sample_data.hpp"
+#include "core/locking.hpp"
+#include "library/thread_data.hpp"
 
 #include <chrono>
 #include <cstdint>
 #include <map>
 #include <set>
+#include <vector>
 
 namespace omnitrace
 {
@@ -33,29 +36,127 @@ namespace causal
 {
 namespace
 {
-auto samples = std::map<uint32_t, std::map<uintptr_t, uint64_t>>{};
+// open-addressing table of (experiment index, pc) -> count. Each thread records into
+// its own table so recording a sample neither allocates (once the table has grown to
+// the working set) nor contends with other threads. The lock is only ever contended
+// when the tables are merged by get_samples()
+struct sample_table
+{
+    struct entry
+    {
+        uintptr_t address = 0;  // zero marks an empty slot
+        uint32_t  index   = 0;
+        uint64_t  count   = 0;
+    };
+
+    void add(uint32_t _index, uintptr_t _addr, uint64_t _count);
+    void rehash(size_t _n);
+
+    template <typename FuncT>
+    void for_each(FuncT&& _func)
+    {
+        auto _lk = locking::atomic_lock{ mutex };
+        for(const auto& itr : entries)
+            if(itr.address != 0) _func(itr);
+    }
+
+    size_t                size    = 0;
+    std::vector<entry>    entries = std::vector<entry>(1024);
+    locking::atomic_mutex mutex   = {};
+};
+
+using sample_table_data_t = thread_data<sample_table, sample_table>;
+
+inline size_t
+get_slot(uint32_t _index, uintptr_t _addr, size_t _mask)
+{
+    // instruction addresses are not uniformly distributed in the low bits
+    constexpr uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+    return ((_addr ^ (static_cast<uint64_t>(_index) << 48)) * multiplier >> 16) & _mask;
 }
 
-std::vector<sample_data>
-get_samples(uint32_t _index)
+void
+sample_table::add(uint32_t _index, uintptr_t _addr, uint64_t _count)
+{
+    auto _lk   = locking::atomic_lock{ mutex };
+    auto _mask = entries.size() - 1;
+    for(auto i = get_slot(_index, _addr, _mask);; i = (i + 1) & _mask)
+    {
+        auto& _entry = entries[i];
+        if(OMNITRACE_LIKELY(_entry.address == _addr && _entry.index == _index))
+        {
+            _entry.count += _count;
+            return;
+        }
+        if(_entry.address == 0)
+        {
+            _entry = entry{ _addr, _index, _count };
+            // keep the load factor below 0.5
+            if(2 * ++size > entries.size()) rehash(2 * entries.size());
+            return;
+        }
+    }
+}
+
+void
+sample_table::rehash(size_t _n)
+{
+    auto _old = std::vector<entry>(_n);
+    std::swap(entries, _old);
+    auto _mask = entries.size() - 1;
+    for(const auto& itr : _old)
+    {
+        if(itr.address == 0) continue;
+        auto i = get_slot(itr.index, itr.address, _mask);
+        while(entries[i].address != 0)
+            i = (i + 1) & _mask;
+        entries[i] = itr;
+    }
+}
+
+auto
+merge_samples()
 {
-    auto _data = std::vector<sample_data>{};
-    _data.reserve(samples.at(_index).size());
-    for(const auto& itr : samples.at(_index))
+    auto  _data   = std::map<uint32_t, std::map<uintptr_t, uint64_t>>{};
+    auto* _tables = sample_table_data_t::get();
+    if(!_tables) return _data;
+
+    for(auto& itr : *_tables)
     {
-        _data.emplace_back(sample_data{ itr.first, itr.second });
+        if(!itr) continue;
+        itr->for_each([&_data](const sample_table::entry& _v) {
+            _data[_v.index][_v.address] += _v.count;
+        });
     }
     return _data;
 }
+}  // namespace
+
+std::vector<sample_data>
+get_samples(uint32_t _index)
+{
+    auto _samples = merge_samples();
+    auto _data    = std::vector<sample_data>{};
+    auto itr      = _samples.find(_index);
+    if(itr == _samples.end()) return _data;
+
+    _data.reserve(itr->second.size());
+    for(const auto& sitr : itr->second)
+        _data.emplace_back(sample_data{ sitr.first, sitr.second });
+    return _data;
+}
 
 std::map<uint32_t, std::vector<sample_data>>
 get_samples()
 {
     auto _data = std::map<uint32_t, std::vector<sample_data>>{};
 
-    for(const auto& itr : samples)
+    for(const auto& itr : merge_samples())
     {
-        _data[itr.first] = get_samples(itr.first);
+        auto& _v = _data[itr.first];
+        _v.reserve(itr.second.size());
+        for(const auto& sitr : itr.second)
+            _v.emplace_back(sample_data{ sitr.first, sitr.second });
     }
 
     return _data;
@@ -64,7 +165,8 @@ get_samples()
 void
 add_sample(uint32_t _index, uintptr_t _addr, uint64_t _count)
 {
-    samples[_index][_addr] += _count;
+    if(_addr == 0 || _count == 0) return;
+    sample_table_data_t::instance(construct_on_thread{})->add(_index, _addr, _count);
 }
 
 void
@@ -25,6 +25,7 @@
 #include "core/concepts.hpp"
 #include "core/defines.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <set>
@@ -51,6 +52,38 @@ block_backtrace_samples();
 void
 unblock_backtrace_samples();
 
+// number of blocking calls the calling thread is currently executing. The sample
+// handlers discard the samples delivered while this is non-zero. Unlike
+// block_backtrace_samples(), it does not stop the perf event or modify the signal
+// mask so it must not be used around calls which fail with EINTR when interrupted
+// by a signal handler (e.g. sigwaitinfo)
+inline int&
+get_blocking_call_depth()
+{
+    static thread_local int _v = 0;
+    return _v;
+}
+
+inline bool
+in_blocking_call()
+{
+    return get_blocking_call_depth() > 0;
+}
+
+inline void
+begin_blocking_call()
+{
+    ++get_blocking_call_depth();
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline void
+end_blocking_call()
+{
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    --get_blocking_call_depth();
+}
+
 template <typename Tp = tim::scope::thread_scope>
 void pause(Tp = {});
 
@@ -0,0 +1,200 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/components/allocation_gotcha.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/state.hpp"
+#include "core/timestamp.hpp"
+#include "library/heap_profiler.hpp"
+#include "library/memory_sampling.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <sys/mman.h>
+
+namespace omnitrace
+{
+namespace component
+{
+namespace
+{
+auto&
+get_allocation_gotcha()
+{
+    static auto _v = tim::lightweight_tuple<allocation_gotcha_t>{};
+    return _v;
+}
+
+size_t
+get_minimum_size()
+{
+    static auto _v = (memory_sampling::is_enabled())
+                         ? config::get_sampling_memory_allocation_size()
+                         : std::numeric_limits<size_t>::max();
+    return _v;
+}
+
+// identifies the wrapper by the address of its gotcha data instead of the name
+template <size_t Idx>
+bool
+is_wrapper(const tim::component::gotcha_data& _data)
+{
+    static const auto* _v = allocation_gotcha_t::at(Idx);
+    return (&_data == _v);
+}
+
+bool
+is_active()
+{
+    return (get_state() == State::Active && get_thread_state() == ThreadState::Enabled);
+}
+}  // namespace
+
+void
+allocation_gotcha::setup()
+{
+    if(get_allocation_gotcha().get<allocation_gotcha_t>()->get_is_running()) return;
+
+    if(get_verbose_env() < 3 && !get_debug_env())
+    {
+        for(size_t i = 0; i < allocation_gotcha_t::capacity(); ++i)
+        {
+            auto* itr = allocation_gotcha_t::at(i);
+            if(itr) itr->verbose = -1;
+        }
+    }
+
+    allocation_gotcha_t::get_initializer() = []() {
+        allocation_gotcha_t::configure<malloc_idx, void*, size_t>("malloc");
+        allocation_gotcha_t::configure<calloc_idx, void*, size_t, size_t>("calloc");
+        allocation_gotcha_t::configure<realloc_idx, void*, void*, size_t>("realloc");
+        allocation_gotcha_t::configure<aligned_alloc_idx, void*, size_t, size_t>(
+            "aligned_alloc");
+        allocation_gotcha_t::configure<posix_memalign_idx, int, void**, size_t, size_t>(
+            "posix_memalign");
+        allocation_gotcha_t::configure<mmap_idx, void*, void*, size_t, int, int, int,
+                                       off_t>("mmap");
+        // releases only matter for the live heap of the heap profiler
+        if(heap_profiler::is_enabled())
+            allocation_gotcha_t::configure<free_idx, void, void*>("free");
+    };
+
+    get_allocation_gotcha().start();
+}
+
+void
+allocation_gotcha::shutdown()
+{
+    allocation_gotcha_t::disable();
+}
+
+void
+allocation_gotcha::begin(size_t _size)
+{
+    m_size    = _size;
+    m_sampled = heap_profiler::sample(_size);
+    m_tracked = (_size >= get_minimum_size()) ? _size : 0;
+    if(m_sampled || m_tracked > 0)
+    {
+        if(!is_active())
+        {
+            m_sampled = false;
+            m_tracked = 0;
+        }
+        else if(m_sampled)
+        {
+            m_beg = timestamp::now();
+        }
+    }
+}
+
+void
+allocation_gotcha::end(void* _ret)
+{
+    if(m_sampled)
+    {
+        auto _latency = timestamp::now() - m_beg;
+        heap_profiler::record(_ret, m_size, _latency);
+    }
+    if(m_tracked > 0)
+        memory_sampling::record_allocation(reinterpret_cast<uintptr_t>(_ret), m_tracked);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::incoming, size_t _size)
+{
+    begin(_size);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data& _data, audit::incoming, size_t _a, size_t _b)
+{
+    // calloc(count, size) or aligned_alloc(alignment, size)
+    begin(is_wrapper<calloc_idx>(_data) ? (_a * _b) : _b);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::incoming, void* _ptr, size_t _size)
+{
+    m_prev = _ptr;
+    begin(_size);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::incoming, void** _memptr, size_t,
+                         size_t _size)
+{
+    m_memptr = _memptr;
+    begin(_size);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::incoming, void*, size_t _size, int,
+                         int, int, off_t)
+{
+    // mappings are only attributed for memory sampling, they are not heap allocations
+    m_tracked = (_size >= get_minimum_size() && is_active()) ? _size : 0;
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::incoming, void* _ptr)
+{
+    heap_profiler::release(_ptr);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::outgoing, void* _ret)
+{
+    if(_ret == nullptr || _ret == MAP_FAILED) return;
+    // a successful realloc releases the previous allocation
+    if(m_prev != nullptr) heap_profiler::release(m_prev);
+    end(_ret);
+}
+
+void
+allocation_gotcha::audit(const gotcha_data&, audit::outgoing, int _ret)
+{
+    if(_ret == 0 && m_memptr != nullptr) end(*m_memptr);
+}
+}  // namespace component
+}  // namespace omnitrace
@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/common.hpp"
+#include "core/defines.hpp"
+#include "core/timemory.hpp"
+
+#include <timemory/components/base.hpp>
+#include <timemory/components/gotcha/backends.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace omnitrace
+{
+namespace component
+{
+// records the address ranges and call sites of large allocations so that the
+// addresses of the sampled memory accesses can be attributed to allocation sites
+// and forwards the sampled allocations and the releases to the heap profiler
+struct allocation_gotcha : tim::component::base<allocation_gotcha, void>
+{
+    static constexpr size_t gotcha_capacity    = 7;
+    static constexpr size_t malloc_idx         = 0;
+    static constexpr size_t calloc_idx         = 1;
+    static constexpr size_t realloc_idx        = 2;
+    static constexpr size_t aligned_alloc_idx  = 3;
+    static constexpr size_t posix_memalign_idx = 4;
+    static constexpr size_t mmap_idx           = 5;
+    static constexpr size_t free_idx           = 6;
+
+    using gotcha_data = tim::component::gotcha_data;
+
+    OMNITRACE_DEFAULT_OBJECT(allocation_gotcha)
+
+    // string id for component
+    static std::string label() { return "allocation_gotcha"; }
+
+    // generate the gotcha wrappers and activate them
+    static void setup();
+    static void shutdown();
+
+    void start() {}
+    void stop() {}
+
+    // malloc
+    void audit(const gotcha_data&, audit::incoming, size_t);
+    // calloc, aligned_alloc
+    void audit(const gotcha_data&, audit::incoming, size_t, size_t);
+    // realloc
+    void audit(const gotcha_data&, audit::incoming, void*, size_t);
+    // posix_memalign
+    void audit(const gotcha_data&, audit::incoming, void**, size_t, size_t);
+    // mmap
+    void audit(const gotcha_data&, audit::incoming, void*, size_t, int, int, int, off_t);
+    // free
+    void audit(const gotcha_data&, audit::incoming, void*);
+
+    void audit(const gotcha_data&, audit::outgoing, void*);
+    void audit(const gotcha_data&, audit::outgoing, int);
+
+private:
+    void begin(size_t);
+    void end(void*);
+
+    bool     m_sampled = false;  // sampled by the heap profiler
+    size_t   m_size    = 0;
+    size_t   m_tracked = 0;  // size of an allocation tracked for memory sampling
+    uint64_t m_beg     = 0;
+    void*    m_prev    = nullptr;
+    void**   m_memptr  = nullptr;
+};
+}  // namespace component
+
+using allocation_bundle_t =
+    tim::component_bundle<category::numa, component::allocation_gotcha>;
+using allocation_gotcha_t =
+    tim::component::gotcha<component::allocation_gotcha::gotcha_capacity,
+                           allocation_bundle_t, category::numa>;
+}  // namespace omnitrace
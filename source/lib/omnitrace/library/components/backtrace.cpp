@@ -30,6 +30,7 @@
 #include "library/ptl.hpp"
 #include "library/runtime.hpp"
 #include "library/sampling.hpp"
+#include "library/sampling_overhead.hpp"
 
 #include <timemory/backends/papi.hpp>
 #include <timemory/backends/threading.hpp>
@@ -188,6 +189,9 @@ backtrace::sample(int signo)
 {
     if(signo == get_sampling_overflow_signal()) return;
 
+    // decimated to stay within OMNITRACE_SAMPLING_OVERHEAD
+    if(sampling_overhead::is_skipped(tim::threading::get_id())) return;
+
     // on RedHat, the unw_step within get_unw_stack involves a mutex lock
     OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
 
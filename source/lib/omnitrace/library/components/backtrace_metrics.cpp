@@ -26,8 +26,10 @@
 #include "core/debug.hpp"
 #include "core/perfetto.hpp"
 #include "library/components/ensure_storage.hpp"
+#include "library/perf.hpp"
 #include "library/ptl.hpp"
 #include "library/runtime.hpp"
+#include "library/sampling_overhead.hpp"
 #include "library/thread_info.hpp"
 #include "library/tracing.hpp"
 
@@ -52,6 +54,7 @@
 #include <timemory/storage.hpp>
 #include <timemory/units.hpp>
 #include <timemory/utility/backtrace.hpp>
+#include <timemory/utility/delimit.hpp>
 #include <timemory/utility/demangle.hpp>
 #include <timemory/utility/types.hpp>
 #include <timemory/variadic.hpp>
@@ -87,6 +90,7 @@ using backtrace_metrics_init_instances =
 using sampler_running_instances = thread_data<bool, category::sampling>;
 using papi_vector_instances     = thread_data<hw_counters, category::sampling>;
 using papi_label_instances = thread_data<std::vector<std::string>, category::sampling>;
+using perf_group_instances = thread_data<perf::perf_group, category::sampling>;
 
 namespace
 {
@@ -105,6 +109,12 @@ get_papi_vector(int64_t _tid)
     return papi_vector_instances::instance(construct_on_thread{ _tid });
 }
 
+unique_ptr_t<perf::perf_group>&
+get_perf_group(int64_t _tid)
+{
+    return perf_group_instances::instance(construct_on_thread{ _tid });
+}
+
 unique_ptr_t<backtrace_metrics>&
 get_backtrace_metrics_init(int64_t _tid)
 {
@@ -137,6 +147,13 @@ backtrace_metrics::get_hw_counter_labels(int64_t _tid)
     return (_v) ? *_v : std::vector<std::string>{};
 }
 
+bool
+backtrace_metrics::use_perf_counters()
+{
+    static bool _v = !config::get_sampling_perf_events().empty();
+    return _v;
+}
+
 void
 backtrace_metrics::start()
 {}
@@ -160,7 +177,8 @@ auto get_enabled(tim::type_list<Tp...>)
 void
 backtrace_metrics::sample(int)
 {
-    if(!get_enabled(type_list<category::process_sampling, backtrace_metrics>{}).all())
+    if(!get_enabled(type_list<category::process_sampling, backtrace_metrics>{}).all() ||
+       sampling_overhead::is_skipped(threading::get_id()))
     {
         m_valid.reset();
         return;
@@ -178,12 +196,21 @@ backtrace_metrics::sample(int)
                  _cache.get_num_voluntary_context_switch();
     m_page_flt = _cache.get_num_major_page_faults() + _cache.get_num_minor_page_faults();
 
-    if constexpr(tim::trait::is_available<hw_counters>::value)
-    {
-        constexpr auto hw_counters_idx = tim::index_of<hw_counters, categories_t>::value;
-        constexpr auto hw_category_idx =
-            tim::index_of<category::thread_hardware_counter, categories_t>::value;
+    constexpr auto hw_counters_idx = tim::index_of<hw_counters, categories_t>::value;
+    constexpr auto hw_category_idx =
+        tim::index_of<category::thread_hardware_counter, categories_t>::value;
 
+    if(use_perf_counters())
+    {
+        // all the events are read with a single syscall on the group leader so this
+        // does not depend on PAPI being available or enabled at runtime
+        const auto& _group = get_perf_group(threading::get_id());
+        m_valid.set(hw_counters_idx,
+                    m_valid.test(hw_category_idx) && _group && _group->is_open() &&
+                        _group->read(m_hw_counter.data(), m_hw_counter.size()) > 0);
+    }
+    else if constexpr(tim::trait::is_available<hw_counters>::value)
+    {
         auto _tid = threading::get_id();
         if(m_valid.test(hw_category_idx) && m_valid.test(hw_counters_idx))
         {
@@ -207,7 +234,28 @@ backtrace_metrics::configure(bool _setup, int64_t _tid)
         (void) get_debug_sampling();  // make sure query in sampler does not allocate
         assert(_tid == threading::get_id());
 
-        if constexpr(tim::trait::is_available<hw_counters>::value)
+        if(use_perf_counters())
+        {
+            perfetto_counter_track<hw_counters>::init();
+            auto& _group = get_perf_group(_tid);
+            // the values are stored in the papi_array of the metrics
+            auto _err = _group->open(
+                tim::delimit(config::get_sampling_perf_events(), " ,;\t\n"),
+                num_hw_counters);
+            if(_err)
+            {
+                OMNITRACE_WARNING_F(0, "perf counters unavailable on thread %li: %s\n",
+                                    _tid, _err->c_str());
+            }
+            else
+            {
+                _group->start();
+                *get_papi_labels(_tid) = _group->get_labels();
+                OMNITRACE_VERBOSE(2, "perf counters :: %zu events :: thread %li\n",
+                                  _group->size(), _tid);
+            }
+        }
+        else if constexpr(tim::trait::is_available<hw_counters>::value)
         {
             perfetto_counter_track<hw_counters>::init();
             OMNITRACE_DEBUG("HW COUNTER: starting...\n");
@@ -223,7 +271,15 @@ backtrace_metrics::configure(bool _setup, int64_t _tid)
         OMNITRACE_DEBUG("Destroying sampler for thread %lu...\n", _tid);
         *_running = false;
 
-        if constexpr(tim::trait::is_available<hw_counters>::value)
+        if(use_perf_counters())
+        {
+            if(_tid == threading::get_id() && get_perf_group(_tid))
+            {
+                get_perf_group(_tid)->close();
+                OMNITRACE_DEBUG("HW COUNTER: perf events closed...\n");
+            }
+        }
+        else if constexpr(tim::trait::is_available<hw_counters>::value)
         {
             if(_tid == threading::get_id())
             {
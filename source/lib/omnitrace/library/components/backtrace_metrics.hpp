@@ -85,6 +85,10 @@ struct backtrace_metrics : comp::empty_base
     static void                     fini_perfetto(int64_t _tid, valid_array_t);
     static std::vector<std::string> get_hw_counter_labels(int64_t);
 
+    /// whether the hardware counters are read from a perf event group
+    /// (OMNITRACE_SAMPLING_PERF_EVENTS) instead of PAPI
+    static bool use_perf_counters();
+
     template <typename Tp>
     static bool get_valid(Tp, valid_array_t);
 
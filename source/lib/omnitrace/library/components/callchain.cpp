@@ -28,11 +28,13 @@
 #include "core/debug.hpp"
 #include "core/perfetto.hpp"
 #include "core/state.hpp"
+#include "library/branch_sampling.hpp"
 #include "library/components/ensure_storage.hpp"
 #include "library/perf.hpp"
 #include "library/ptl.hpp"
 #include "library/runtime.hpp"
 #include "library/sampling.hpp"
+#include "library/sampling_overhead.hpp"
 #include "library/thread_info.hpp"
 
 #include <timemory/backends/papi.hpp>
@@ -175,16 +177,21 @@ callchain::size() const
 void
 callchain::sample(int signo)
 {
-    if(signo != get_sampling_overflow_signal()) return;
+    static thread_local const auto& _tinfo = thread_info::get();
+    auto                            _tid   = _tinfo->index_data->sequent_value;
+
+    // this is the last component of the sampler so the handler is timed until the
+    // end of this function
+    auto _stop_overhead = [_tid, signo]() { sampling_overhead::stop(_tid, signo); };
+
+    if(signo != get_sampling_overflow_signal()) return _stop_overhead();
 
     // on RedHat, the unw_step within get_unw_stack involves a mutex lock
     OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
 
-    static thread_local const auto& _tinfo      = thread_info::get();
-    auto                            _tid        = _tinfo->index_data->sequent_value;
-    auto&                           _perf_event = perf::get_instance(_tid);
+    auto& _perf_event = perf::get_instance(_tid);
 
-    if(!_perf_event) return;
+    if(!_perf_event) return _stop_overhead();
 
     _perf_event->stop();
 
@@ -196,6 +203,15 @@ callchain::sample(int signo)
             auto _data      = record{};
             _data.timestamp = itr.get_time();
             _data.data.emplace_back(_ip);
+            if(_perf_event->is_sampling(perf::sample::addr))
+            {
+                _data.memory.address = itr.get_addr();
+                if(_perf_event->is_sampling(perf::sample::weight))
+                    _data.memory.weight = itr.get_weight();
+                if(_perf_event->is_sampling(perf::sample::data_src))
+                    _data.memory.data_src = itr.get_data_src();
+                memory_sampling::resolve_nodes(_data.memory);
+            }
             bool _skip_ip = true;
             for(auto ditr : itr.get_callchain())
             {
@@ -208,10 +224,16 @@ callchain::sample(int signo)
                 if(_data.data.size() == _data.data.capacity()) break;
             }
             if(!_data.data.empty()) m_data.emplace_back(_data);
+            if(_perf_event->is_sampling(perf::sample::branch_stack))
+            {
+                auto _branches = itr.get_branch_stack();
+                branch_sampling::add_sample(_tid, _branches, _branches.size());
+            }
         }
     }
 
     _perf_event->start();
+    _stop_overhead();
 }
 }  // namespace component
 }  // namespace omnitrace
@@ -27,6 +27,7 @@
 #include "core/containers/static_vector.hpp"
 #include "core/defines.hpp"
 #include "core/timemory.hpp"
+#include "library/memory_sampling.hpp"
 #include "library/thread_data.hpp"
 
 #include <timemory/components/base/declaration.hpp>
@@ -53,6 +54,7 @@ struct callchain : comp::empty_base
     struct record
     {
         uint64_t                                         timestamp = 0;
+        memory_sampling::access                          memory    = {};
         container::static_vector<uintptr_t, stack_depth> data      = {};
 
         bool operator<(const record& rhs) const;
@@ -27,6 +27,8 @@
 #include "core/state.hpp"
 #include "core/timemory.hpp"
 #include "library/causal/data.hpp"
+#include "library/event_log.hpp"
+#include "library/flat_profile.hpp"
 #include "library/runtime.hpp"
 #include "library/tracing.hpp"
 #include "library/tracing/annotation.hpp"
@@ -37,6 +39,8 @@
 #include <timemory/mpl/types.hpp>
 #include <timemory/utility/types.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <string_view>
 
 namespace tim
@@ -72,6 +76,56 @@ using causal_throughput_categories_t =
     type_list<category::host, category::kokkos, category::ompt, category::rocm_hip,
               category::rocm_hsa, category::rocm_rccl, category::rocm_roctx>;
 
+// name of a region and the hash it was registered with. A handle with a zero hash is
+// registered when the region is started
+struct region_handle
+{
+    tim::hash_value_t hash = 0;
+    std::string_view  name = {};
+};
+
+inline region_handle
+register_region(std::string_view _name)
+{
+    auto _hash = tim::add_hash_id(_name);
+    return region_handle{ _hash, tim::get_hash_identifier_fast(_hash) };
+}
+
+// the gotcha data of a wrapper is static so the registered handle is cached per
+// wrapper. The cache is per thread because the hash identifiers are registered per
+// thread so no locking is needed
+inline region_handle
+get_region_handle(const tim::component::gotcha_data& _data)
+{
+    struct entry
+    {
+        const void*   key   = nullptr;
+        region_handle value = {};
+    };
+
+    constexpr size_t cache_size = 512;
+    constexpr size_t max_probes = 8;
+
+    static thread_local auto _cache = std::unique_ptr<entry[]>{};
+    if(!_cache) _cache = std::make_unique<entry[]>(cache_size);
+
+    const void* _key = &_data;
+    auto        _idx = (reinterpret_cast<uintptr_t>(_key) >> 4);
+    for(size_t i = 0; i < max_probes; ++i)
+    {
+        auto& _v = _cache[(_idx + i) & (cache_size - 1)];
+        if(_v.key == _key) return _v.value;
+        if(_v.key == nullptr)
+        {
+            _v.value = register_region(_data.tool_id);
+            _v.key   = _key;
+            return _v.value;
+        }
+    }
+
+    return region_handle{ 0, _data.tool_id };
+}
+
 // define this outside of category region functions so that the
 // static thread_local is global instead of per-template instantiation
 inline ThreadState
@@ -100,6 +154,12 @@ struct category_region : comp::base<category_region<CategoryT>, void>
     template <typename... OptsT, typename... Args>
     static void stop(std::string_view name, Args&&...);
 
+    template <typename... OptsT, typename... Args>
+    static void start(region_handle, Args&&...);
+
+    template <typename... OptsT, typename... Args>
+    static void stop(region_handle, Args&&...);
+
     template <typename... OptsT, typename... Args>
     static void mark(std::string_view name, Args&&...);
 
@@ -123,6 +183,22 @@ template <typename CategoryT>
 template <typename... OptsT, typename... Args>
 void
 category_region<CategoryT>::start(std::string_view name, Args&&... args)
+{
+    start<OptsT...>(region_handle{ 0, name }, std::forward<Args>(args)...);
+}
+
+template <typename CategoryT>
+template <typename... OptsT, typename... Args>
+void
+category_region<CategoryT>::stop(std::string_view name, Args&&... args)
+{
+    stop<OptsT...>(region_handle{ 0, name }, std::forward<Args>(args)...);
+}
+
+template <typename CategoryT>
+template <typename... OptsT, typename... Args>
+void
+category_region<CategoryT>::start(region_handle _region, Args&&... args)
 {
     // skip if category is disabled
     if(tracing::category_push_disabled<CategoryT>()) return;
@@ -131,7 +207,7 @@ category_region<CategoryT>::start(std::string_view name, Args&&... args)
     if(get_thread_state() == ThreadState::Disabled) return;
     if(get_state() >= State::Finalized) return;
 
-    if(name.empty()) return;
+    if(_region.name.empty()) return;
 
     OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
 
@@ -155,15 +231,17 @@ category_region<CategoryT>::start(std::string_view name, Args&&... args)
         tracing::debug_push,
         "[%s][PID=%i][state=%s][thread_state=%s] omnitrace_push_region(%s)\n",
         category_name, process::get_id(), std::to_string(get_state()).c_str(),
-        std::to_string(get_thread_state()).c_str(), name.data());
+        std::to_string(get_thread_state()).c_str(), _region.name.data());
 
     if constexpr(is_one_of<CategoryT, tracing_count_categories_t>::value)
     {
         ++tracing::push_count();
     }
 
-    auto _hash = tim::add_hash_id(name);
-    name       = tim::get_hash_identifier_fast(_hash);
+    if(_region.hash == 0) _region = register_region(_region.name);
+
+    auto _hash = _region.hash;
+    auto name  = _region.name;
 
     if constexpr(_ct_use_causal)
     {
@@ -177,7 +255,10 @@ category_region<CategoryT>::start(std::string_view name, Args&&... args)
     {
         if(get_use_timemory())
         {
-            tracing::push_timemory(CategoryT{}, name, std::forward<Args>(args)...);
+            if(flat_profile::is_enabled())
+                flat_profile::push(_hash);
+            else
+                tracing::push_timemory(CategoryT{}, name, std::forward<Args>(args)...);
         }
     }
 
@@ -185,7 +266,15 @@ category_region<CategoryT>::start(std::string_view name, Args&&... args)
     {
         if(get_use_perfetto())
         {
-            tracing::push_perfetto(CategoryT{}, name.data(), std::forward<Args>(args)...);
+            if(std::is_same<CategoryT, category::host>::value && event_log::is_enabled())
+            {
+                event_log::push(_hash);
+            }
+            else
+            {
+                tracing::push_perfetto(CategoryT{}, name.data(),
+                                       std::forward<Args>(args)...);
+            }
         }
     }
 }
@@ -193,11 +282,13 @@ category_region<CategoryT>::start(std::string_view name, Args&&... args)
 template <typename CategoryT>
 template <typename... OptsT, typename... Args>
 void
-category_region<CategoryT>::stop(std::string_view name, Args&&... args)
+category_region<CategoryT>::stop(region_handle _region, Args&&... args)
 {
     // skip if category is disabled
     if(tracing::category_pop_disabled<CategoryT>()) return;
 
+    auto name = _region.name;
+
     if(get_thread_state() == ThreadState::Disabled) return;
 
     OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
@@ -229,8 +320,16 @@ category_region<CategoryT>::stop(std::string_view name, Args&&... args)
         {
             if(get_use_perfetto())
             {
-                tracing::pop_perfetto(CategoryT{}, name.data(),
-                                      std::forward<Args>(args)...);
+                if(std::is_same<CategoryT, category::host>::value &&
+                   event_log::is_enabled())
+                {
+                    event_log::pop();
+                }
+                else
+                {
+                    tracing::pop_perfetto(CategoryT{}, name.data(),
+                                          std::forward<Args>(args)...);
+                }
             }
         }
 
@@ -238,7 +337,10 @@ category_region<CategoryT>::stop(std::string_view name, Args&&... args)
         {
             if(get_use_timemory())
             {
-                tracing::pop_timemory(CategoryT{}, name, std::forward<Args>(args)...);
+                if(flat_profile::is_enabled())
+                    flat_profile::pop();
+                else
+                    tracing::pop_timemory(CategoryT{}, name, std::forward<Args>(args)...);
             }
         }
 
@@ -304,7 +406,7 @@ void
 category_region<CategoryT>::audit(const gotcha_data_t& _data, audit::incoming,
                                   Args&&... _args)
 {
-    start<OptsT...>(_data.tool_id.c_str(), [&](::perfetto::EventContext ctx) {
+    start<OptsT...>(get_region_handle(_data), [&](::perfetto::EventContext ctx) {
         if(config::get_perfetto_annotations())
         {
             int64_t _n = 0;
@@ -320,7 +422,7 @@ void
 category_region<CategoryT>::audit(const gotcha_data_t& _data, audit::outgoing,
                                   Args&&... _args)
 {
-    stop<OptsT...>(_data.tool_id.c_str(), [&](::perfetto::EventContext ctx) {
+    stop<OptsT...>(get_region_handle(_data), [&](::perfetto::EventContext ctx) {
         if(config::get_perfetto_annotations())
             tracing::add_perfetto_annotation(ctx, "return", JOIN(", ", _args...));
     });
@@ -27,9 +27,11 @@
 #include "core/perfetto.hpp"
 #include "core/perfetto_fwd.hpp"
 #include "core/state.hpp"
+#include "core/timemory.hpp"
 #include "library/components/fork_gotcha.hpp"
 #include "library/runtime.hpp"
 #include "library/sampling.hpp"
+#include "library/tracing.hpp"
 
 #include <timemory/backends/process.hpp>
 #include <timemory/backends/threading.hpp>
@@ -51,6 +53,8 @@ namespace
 bool prefork_lock         = false;
 bool postfork_parent_lock = false;
 bool postfork_child_lock  = false;
+// set in a child process which continued profiling after fork()
+bool child_profiling = false;
 
 // this does a quick exit (no cleanup) on child processes
 // because perfetto has a tendency to access memory it
@@ -106,6 +110,71 @@ postfork_parent()
     prefork_lock         = false;
 }
 
+// writes the output of a child process which continued profiling after fork().
+// The full finalization is not safe in the child: it joins threads which only
+// exist in the parent and perfetto cannot flush without its service threads
+void
+child_finalize()
+{
+    static bool _once = false;
+    if(_once || get_state() != State::Active) return;
+    _once = true;
+
+    set_thread_state(ThreadState::Completed);
+    set_state(State::Finalized);
+
+    OMNITRACE_VERBOSE_F(0, "finalizing child process %i...\n", process::get_id());
+
+    if(config::get_use_sampling())
+    {
+        sampling::block_samples();
+        sampling::shutdown();
+        sampling::post_process();
+    }
+
+    tracing::copy_timemory_hash_ids();
+
+    auto _manager = tim::manager::instance();
+    if(_manager) tim::timemory_finalize(_manager.get());
+}
+
+// returns normally so that the remaining exit handlers run and the child exits with
+// the status it passed to exit(). The state is finalized so the exit handlers of the
+// parent which were inherited by the child do not finalize again
+void
+child_profiling_exit(int, void*)
+{
+    child_finalize();
+}
+
+void
+postfork_child_profiling()
+{
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    // the output of the child is distinguished from the parent by its PID
+    settings::use_output_suffix()      = true;
+    settings::default_process_suffix() = process::get_id();
+
+    // the background threads of the parent do not exist in the child
+    config::get_use_perfetto()         = false;
+    config::get_use_process_sampling() = false;
+
+    omnitrace::categories::enable_categories(config::get_enabled_categories());
+
+    if(config::get_use_sampling())
+    {
+        auto _signals = sampling::postfork_child();
+        OMNITRACE_VERBOSE_F(1, "sampling re-armed in child process %i for %zu signals\n",
+                            process::get_id(), _signals.size());
+    }
+
+    // exit() runs this handler. _exit() is wrapped by fork_gotcha and _Exit() by
+    // exit_gotcha since they do not run the exit handlers
+    child_profiling = true;
+    on_exit(&child_profiling_exit, nullptr);
+}
+
 void
 postfork_child()
 {
@@ -115,6 +184,17 @@ postfork_child()
         << "Error! child process " << process::get_id()
         << " believes it is the root process " << get_root_process_id() << "\n";
 
+    if(config::get_fork_child_profiling() && get_state() == State::Active &&
+       !config::get_use_causal())
+    {
+        postfork_child_profiling();
+
+        // prevent re-entry until prefork has been called
+        postfork_child_lock = true;
+        prefork_lock        = false;
+        return;
+    }
+
     settings::enabled() = false;
     settings::verbose() = -127;
     settings::debug()   = false;
@@ -139,6 +219,7 @@ fork_gotcha::configure()
 {
     fork_gotcha_t::get_initializer() = []() {
         TIMEMORY_C_GOTCHA(fork_gotcha_t, 0, fork);
+        TIMEMORY_C_GOTCHA(fork_gotcha_t, 1, _exit);
     };
 
     // registering the pthread_atfork and gotcha means that we might execute twice
@@ -146,6 +227,14 @@ fork_gotcha::configure()
     pthread_atfork(&prefork_setup, &postfork_parent, &postfork_child);
 }
 
+bool
+fork_gotcha::finalize_child()
+{
+    if(!child_profiling) return false;
+    child_finalize();
+    return true;
+}
+
 pid_t
 fork_gotcha::operator()(const gotcha_data_t&, pid_t (*_real_fork)()) const
 {
@@ -174,5 +263,12 @@ fork_gotcha::operator()(const gotcha_data_t&, pid_t (*_real_fork)()) const
 
     return _pid;
 }
+
+void
+fork_gotcha::operator()(const gotcha_data_t&, void (*_real_exit)(int), int _ec) const
+{
+    finalize_child();
+    (*_real_exit)(_ec);
+}
 }  // namespace component
 }  // namespace omnitrace
@@ -30,10 +30,10 @@ namespace omnitrace
 {
 namespace component
 {
-// this is used to wrap fork()
+// this is used to wrap fork() and _exit()
 struct fork_gotcha : comp::base<fork_gotcha, void>
 {
-    static constexpr size_t gotcha_capacity = 1;
+    static constexpr size_t gotcha_capacity = 2;
 
     using gotcha_data_t = comp::gotcha_data;
 
@@ -45,9 +45,17 @@ struct fork_gotcha : comp::base<fork_gotcha, void>
     // generate the gotcha wrappers
     static void configure();
 
+    // writes the output of a child process which continued profiling after fork().
+    // Returns false if the process is not such a child
+    static bool finalize_child();
+
     // this will get called right before fork
     pid_t operator()(const gotcha_data_t&, pid_t (*)()) const;
 
+    // _exit() does not run the exit handlers so the output of a child process which
+    // continued profiling after fork() is written here
+    void operator()(const gotcha_data_t&, void (*)(int), int) const;
+
     // silence SFINAE disabled for omnitrace::fork_gotcha warnings
     static inline void start() {}
     static inline void stop() {}
@@ -28,6 +28,8 @@
 #include "core/mproc.hpp"
 #include "library/components/category_region.hpp"
 #include "library/components/comm_data.hpp"
+#include "library/components/mpi_wait_state.hpp"
+#include "library/throttle.hpp"
 
 #include <timemory/backends/mpi.hpp>
 #include <timemory/backends/process.hpp>
@@ -35,6 +37,7 @@
 #include <timemory/signals/signal_mask.hpp>
 #include <timemory/utility/locking.hpp>
 
+#include <array>
 #include <cstdint>
 #include <limits>
 #include <thread>
@@ -46,8 +49,8 @@ namespace component
 {
 namespace
 {
-using mpip_bundle_t =
-    tim::component_tuple<category_region<category::mpi>, comp::comm_data>;
+using mpip_bundle_t = tim::component_tuple<category_region<category::mpi>,
+                                           comp::comm_data, mpi_wait_state>;
 
 struct comm_rank_data
 {
@@ -116,6 +119,7 @@ omnitrace_mpi_fini(MPI_Comm, int, void*, void*)
     auto _blocked = get_sampling_signals();
     if(!_blocked.empty())
         tim::signals::block_signals(_blocked, tim::signals::sigmask_scope::process);
+    mpi_wait_state::post_process();
     if(mpip_index != std::numeric_limits<uint64_t>::max())
         comp::deactivate_mpip<mpip_bundle_t, project::omnitrace>(mpip_index);
     if(is_root_process()) omnitrace_finalize_hidden();
@@ -145,6 +149,62 @@ omnitrace_mpi_set_attr()
 using strset_t       = std::set<std::string>;
 auto permit_bindings = strset_t{};
 auto reject_bindings = strset_t{};
+
+// identifies the wrapper by the address of its gotcha data instead of the name
+template <size_t Idx>
+bool
+is_wrapper(const comp::gotcha_data& _data)
+{
+    static const auto* _v = mpi_gotcha_t::at(Idx);
+    return (&_data == _v);
+}
+
+// applications often query the rank and size of the same communicator repeatedly so
+// the records (which require a lock) are only updated when the result changes
+bool
+is_new_comm_value(const comp::gotcha_data& _data, uintptr_t _comm, int _rank, int _size)
+{
+    struct last_value
+    {
+        const void* wrapper = nullptr;
+        uintptr_t   comm    = mpi_gotcha::null_comm();
+        int         rank    = -1;
+        int         size    = -1;
+    };
+
+    static thread_local auto _last = std::array<last_value, 2>{};
+
+    auto& _v = _last.at(is_wrapper<mpi_gotcha::comm_size_idx>(_data) ? 1 : 0);
+    if(_v.wrapper == &_data && _v.comm == _comm && _v.rank == _rank && _v.size == _size)
+        return false;
+
+    _v = last_value{ &_data, _comm, _rank, _size };
+    return true;
+}
+
+// the throttle uses the hash of the registered region instead of hashing the name
+tim::hash_value_t
+get_throttle_hash(region_handle _region)
+{
+    return (_region.hash != 0) ? _region.hash : tim::get_hash_id(_region.name);
+}
+
+// equivalent to omnitrace_{push,pop}_trace_hidden with a pre-registered region
+void
+push_region(const comp::gotcha_data& _data)
+{
+    auto _region = get_region_handle(_data);
+    if(throttle::is_enabled() && throttle::push(get_throttle_hash(_region))) return;
+    category_region<category::host>::start(_region);
+}
+
+void
+pop_region(const comp::gotcha_data& _data)
+{
+    auto _region = get_region_handle(_data);
+    if(throttle::is_enabled() && throttle::pop(get_throttle_hash(_region))) return;
+    category_region<category::host>::stop(_region);
+}
 }  // namespace
 
 void
@@ -161,16 +221,18 @@ mpi_gotcha::configure()
     }
 
     mpi_gotcha_t::get_initializer() = []() {
-        mpi_gotcha_t::template configure<0, int, int*, char***>("MPI_Init");
-        mpi_gotcha_t::template configure<1, int, int*, char***, int, int*>(
-            "MPI_Init_thread");
-        mpi_gotcha_t::template configure<2, int>("MPI_Finalize");
+        mpi_gotcha_t::template configure<init_idx, int, int*, char***>("MPI_Init");
+        mpi_gotcha_t::template configure<init_thread_idx, int, int*, char***, int,
+                                         int*>("MPI_Init_thread");
+        mpi_gotcha_t::template configure<finalize_idx, int>("MPI_Finalize");
         reject_bindings.emplace("MPI_Init");
         reject_bindings.emplace("MPI_Init_thread");
         reject_bindings.emplace("MPI_Finalize");
 #if defined(OMNITRACE_USE_MPI_HEADERS) && OMNITRACE_USE_MPI_HEADERS > 0
-        mpi_gotcha_t::template configure<3, int, comm_t, int*>("MPI_Comm_rank");
-        mpi_gotcha_t::template configure<4, int, comm_t, int*>("MPI_Comm_size");
+        mpi_gotcha_t::template configure<comm_rank_idx, int, comm_t, int*>(
+            "MPI_Comm_rank");
+        mpi_gotcha_t::template configure<comm_size_idx, int, comm_t, int*>(
+            "MPI_Comm_size");
         reject_bindings.emplace("MPI_Comm_rank");
         reject_bindings.emplace("MPI_Comm_size");
 #endif
@@ -225,8 +287,8 @@ void
 mpi_gotcha::disable_comm_intercept()
 {
 #if defined(OMNITRACE_USE_MPI_HEADERS) && OMNITRACE_USE_MPI_HEADERS > 0
-    mpi_gotcha_t::revert<3>();
-    mpi_gotcha_t::revert<4>();
+    mpi_gotcha_t::revert<comm_rank_idx>();
+    mpi_gotcha_t::revert<comm_size_idx>();
 #endif
 }
 
@@ -235,7 +297,7 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::incoming, int*, char***)
 {
     OMNITRACE_BASIC_DEBUG_F("%s(int*, char***)\n", _data.tool_id.c_str());
 
-    omnitrace_push_trace_hidden(_data.tool_id.c_str());
+    push_region(_data);
 #if !defined(TIMEMORY_USE_MPI) && defined(TIMEMORY_USE_MPI_HEADERS)
     tim::mpi::is_initialized_callback() = []() { return true; };
     tim::mpi::is_finalized()            = false;
@@ -247,7 +309,7 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::incoming, int*, char***, in
 {
     OMNITRACE_BASIC_DEBUG_F("%s(int*, char***, int, int*)\n", _data.tool_id.c_str());
 
-    omnitrace_push_trace_hidden(_data.tool_id.c_str());
+    push_region(_data);
 #if !defined(TIMEMORY_USE_MPI) && defined(TIMEMORY_USE_MPI_HEADERS)
     tim::mpi::is_initialized_callback() = []() { return true; };
     tim::mpi::is_finalized()            = false;
@@ -263,6 +325,7 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::incoming)
     if(!_blocked.empty())
         tim::signals::block_signals(_blocked, tim::signals::sigmask_scope::process);
 
+    mpi_wait_state::post_process();
     if(mpip_index != std::numeric_limits<uint64_t>::max())
         comp::deactivate_mpip<mpip_bundle_t, project::omnitrace>(mpip_index);
 
@@ -280,13 +343,13 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::incoming, comm_t _comm, int
 {
     OMNITRACE_BASIC_DEBUG_F("%s()\n", _data.tool_id.c_str());
 
-    omnitrace_push_trace_hidden(_data.tool_id.c_str());
-    if(_data.tool_id == "MPI_Comm_rank")
+    push_region(_data);
+    if(is_wrapper<comm_rank_idx>(_data))
     {
         m_comm_val = (uintptr_t) _comm;  // NOLINT
         m_rank_ptr = _val;
     }
-    else if(_data.tool_id == "MPI_Comm_size")
+    else if(is_wrapper<comm_size_idx>(_data))
     {
         m_comm_val = (uintptr_t) _comm;  // NOLINT
         m_size_ptr = _val;
@@ -305,7 +368,10 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::outgoing, int _retval)
 
     if(!settings::use_output_suffix()) settings::use_output_suffix() = true;
 
-    if(_retval == tim::mpi::success_v && _data.tool_id.find("MPI_Init") == 0)
+    auto _is_init = is_wrapper<init_idx>(_data) || is_wrapper<init_thread_idx>(_data);
+    auto _is_comm = is_wrapper<comm_rank_idx>(_data) || is_wrapper<comm_size_idx>(_data);
+
+    if(_retval == tim::mpi::success_v && _is_init)
     {
         omnitrace_mpi_set_attr();
         // omnitrace will set this environement variable to true in binary rewrite mode
@@ -339,45 +405,36 @@ mpi_gotcha::audit(const gotcha_data_t& _data, audit::outgoing, int _retval)
             }
         }
     }
-    else if(_retval == tim::mpi::success_v && _data.tool_id.find("MPI_Comm_") == 0)
+    else if(_retval == tim::mpi::success_v && _is_comm && m_comm_val != null_comm() &&
+            is_new_comm_value(_data, m_comm_val, (m_rank_ptr) ? *m_rank_ptr : m_rank,
+                              (m_size_ptr) ? *m_size_ptr : m_size))
     {
         auto_lock_t _lk{ type_mutex<mpi_gotcha>() };
-        if(m_comm_val != null_comm())
-        {
-            auto& _comm_entry = mpi_comm_records[m_comm_val];
-            _comm_entry.comm  = m_comm_val;
 
-            auto _get_rank = [&]() {
-                return (m_rank_ptr) ? std::max<int>(*m_rank_ptr, m_rank) : m_rank;
-            };
+        auto& _comm_entry = mpi_comm_records[m_comm_val];
+        _comm_entry.comm  = m_comm_val;
 
-            auto _get_size = [&]() {
-                return (m_size_ptr) ? std::max<int>(*m_size_ptr, m_size)
-                                    : std::max<int>(m_size, _get_rank() + 1);
-            };
+        auto _get_rank = [&]() {
+            return (m_rank_ptr) ? std::max<int>(*m_rank_ptr, m_rank) : m_rank;
+        };
 
-            if(_data.tool_id == "MPI_Comm_rank" || _data.tool_id == "MPI_Comm_size")
-            {
-                _comm_entry.rank = m_rank = std::max<int>(_comm_entry.rank, _get_rank());
-                _comm_entry.size = m_size = std::max<int>(_comm_entry.size, _get_size());
-            }
-            else
-            {
-                OMNITRACE_BASIC_VERBOSE(
-                    0, "%s() returned %i :: unexpected function wrapper\n",
-                    _data.tool_id.c_str(), (int) _retval);
-            }
+        auto _get_size = [&]() {
+            return (m_size_ptr) ? std::max<int>(*m_size_ptr, m_size)
+                                : std::max<int>(m_size, _get_rank() + 1);
+        };
 
-            if(_comm_entry.updated())
-            {
-                static thread_local int _num_updates = 0;
-                static int              _disable_after =
-                    tim::get_env<int>("OMNITRACE_MPI_MAX_COMM_UPDATES", 4);
-                if(_num_updates++ < _disable_after) update();
-            }
+        _comm_entry.rank = m_rank = std::max<int>(_comm_entry.rank, _get_rank());
+        _comm_entry.size = m_size = std::max<int>(_comm_entry.size, _get_size());
+
+        if(_comm_entry.updated())
+        {
+            static thread_local int _num_updates = 0;
+            static int              _disable_after =
+                tim::get_env<int>("OMNITRACE_MPI_MAX_COMM_UPDATES", 4);
+            if(_num_updates++ < _disable_after) update();
         }
     }
-    omnitrace_pop_trace_hidden(_data.tool_id.c_str());
+    pop_region(_data);
 }
 }  // namespace component
 }  // namespace omnitrace
@@ -38,6 +38,13 @@ struct mpi_gotcha : comp::base<mpi_gotcha, void>
     using comm_t        = tim::mpi::comm_t;
     using gotcha_data_t = comp::gotcha_data;
 
+    // indices of the wrappers in mpi_gotcha_t
+    static constexpr size_t init_idx        = 0;
+    static constexpr size_t init_thread_idx = 1;
+    static constexpr size_t finalize_idx    = 2;
+    static constexpr size_t comm_rank_idx   = 3;
+    static constexpr size_t comm_size_idx   = 4;
+
     OMNITRACE_DEFAULT_OBJECT(mpi_gotcha)
 
     // string id for component
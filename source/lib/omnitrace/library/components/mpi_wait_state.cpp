@@ -0,0 +1,842 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "library/components/mpi_wait_state.hpp"
+#include "common/join.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/output.hpp"
+#include "core/state.hpp"
+#include "core/timestamp.hpp"
+#include "library/thread_data.hpp"
+
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+#include <timemory/utility/demangle.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace omnitrace
+{
+namespace component
+{
+namespace
+{
+using event_t      = mpi_wait_state::event;
+using event_vec_t  = std::vector<event_t>;
+using event_data_t = thread_data<event_vec_t, mpi_wait_state>;
+
+enum wait_state : uint8_t
+{
+    late_sender = 0,
+    late_receiver,
+    collective_imbalance,
+};
+
+const char*
+get_wait_state_name(uint8_t _v)
+{
+    switch(_v)
+    {
+        case late_sender: return "late-sender";
+        case late_receiver: return "late-receiver";
+        case collective_imbalance: return "collective-imbalance";
+        default: break;
+    }
+    return "unknown";
+}
+
+struct wait_entry
+{
+    std::string state    = {};
+    std::string callsite = {};
+    int32_t     peer     = -1;
+    uint64_t    count    = 0;
+    uint64_t    wait     = 0;  // time spent waiting on the peer(s)
+    uint64_t    duration = 0;  // total time spent in the calls
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("state", state), cereal::make_nvp("callsite", callsite),
+           cereal::make_nvp("peer", peer), cereal::make_nvp("count", count),
+           cereal::make_nvp("wait_ns", wait), cereal::make_nvp("duration_ns", duration));
+    }
+};
+
+locking::atomic_mutex&
+get_callsite_mutex()
+{
+    static auto _v = locking::atomic_mutex{};
+    return _v;
+}
+
+auto&
+get_callsite_names()
+{
+    static auto* _v = new std::unordered_map<tim::hash_value_t, std::string>{};
+    return *_v;
+}
+
+event_vec_t*
+get_thread_events()
+{
+    static thread_local auto* _v = event_data_t::instance(construct_on_thread{}).get();
+    return _v;
+}
+
+#if defined(OMNITRACE_USE_MPI)
+struct comm_info
+{
+    uint64_t         id          = 0;
+    uint64_t         children    = 0;  // communicators created from this communicator
+    std::vector<int> world_ranks = {};
+};
+
+template <typename Tp>
+uint64_t
+get_hash(const Tp* _data, size_t _n)
+{
+    return std::hash<std::string_view>{}(
+        std::string_view{ reinterpret_cast<const char*>(_data), _n * sizeof(Tp) });
+}
+
+locking::atomic_mutex&
+get_comm_mutex()
+{
+    static auto _v = locking::atomic_mutex{};
+    return _v;
+}
+
+// incremented whenever the info of a communicator is deleted so that the per-thread
+// cache in get_comm_info does not return the info of a freed communicator whose
+// handle was reused
+std::atomic<uint64_t>&
+get_comm_generation()
+{
+    static auto _v = std::atomic<uint64_t>{ 0 };
+    return _v;
+}
+
+int
+delete_comm_info(MPI_Comm, int, void* _attr, void*)
+{
+    get_comm_generation().fetch_add(1, std::memory_order_release);
+    delete static_cast<comm_info*>(_attr);
+    return MPI_SUCCESS;
+}
+
+// the info is not copied to duplicates of the communicator and is deleted by
+// MPI_Comm_free
+int
+get_comm_keyval()
+{
+    static int _v = []() {
+        int _keyval = MPI_KEYVAL_INVALID;
+        PMPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, &delete_comm_info, &_keyval,
+                                nullptr);
+        return _keyval;
+    }();
+    return _v;
+}
+
+// the communicator handles differ between ranks and are reused after MPI_Comm_free so
+// the info is cached as an attribute of the communicator. Communicators which were
+// not created by one of the wrapped calls are identified by the ranks of their members
+// in MPI_COMM_WORLD. Requires the lock of get_comm_mutex()
+comm_info&
+get_comm_info_impl(MPI_Comm _comm)
+{
+    void* _attr  = nullptr;
+    int   _found = 0;
+    PMPI_Comm_get_attr(_comm, get_comm_keyval(), &_attr, &_found);
+    if(_found != 0 && _attr) return *static_cast<comm_info*>(_attr);
+
+    int _size = 0;
+    PMPI_Comm_size(_comm, &_size);
+
+    MPI_Group _world_group = MPI_GROUP_NULL;
+    MPI_Group _comm_group  = MPI_GROUP_NULL;
+    PMPI_Comm_group(MPI_COMM_WORLD, &_world_group);
+    PMPI_Comm_group(_comm, &_comm_group);
+
+    auto  _ranks = std::vector<int>(_size, 0);
+    auto* _info  = new comm_info{};
+    std::iota(_ranks.begin(), _ranks.end(), 0);
+    _info->world_ranks.resize(_size, MPI_UNDEFINED);
+    PMPI_Group_translate_ranks(_comm_group, _size, _ranks.data(), _world_group,
+                               _info->world_ranks.data());
+    PMPI_Group_free(&_comm_group);
+    PMPI_Group_free(&_world_group);
+
+    _info->id = get_hash(_info->world_ranks.data(), _info->world_ranks.size());
+
+    PMPI_Comm_set_attr(_comm, get_comm_keyval(), _info);
+    return *_info;
+}
+
+// the last communicator used by the thread is cached and the attribute lookup is only
+// serialized when the info has to be created
+const comm_info&
+get_comm_info(MPI_Comm _comm)
+{
+    struct comm_cache
+    {
+        MPI_Comm         comm       = MPI_COMM_NULL;
+        uint64_t         generation = 0;
+        const comm_info* info       = nullptr;
+    };
+
+    static thread_local auto _cache = comm_cache{};
+
+    auto _generation = get_comm_generation().load(std::memory_order_acquire);
+    if(_cache.info && _cache.comm == _comm && _cache.generation == _generation)
+        return *_cache.info;
+
+    void* _attr  = nullptr;
+    int   _found = 0;
+    PMPI_Comm_get_attr(_comm, get_comm_keyval(), &_attr, &_found);
+    if(_found == 0 || !_attr)
+    {
+        auto _lk = locking::atomic_lock{ get_comm_mutex() };
+        _attr    = &get_comm_info_impl(_comm);
+    }
+
+    _cache = comm_cache{ _comm, _generation, static_cast<const comm_info*>(_attr) };
+    return *_cache.info;
+}
+
+// every member of the parent creates the communicators of the parent in the same
+// order so the position of the new communicator in that order distinguishes it from
+// other communicators with the same members, e.g. duplicates
+void
+add_comm_info(MPI_Comm _parent, MPI_Comm _comm)
+{
+    auto  _lk          = locking::atomic_lock{ get_comm_mutex() };
+    auto& _parent_info = get_comm_info_impl(_parent);
+    auto  _seq         = _parent_info.children++;
+    if(_comm == MPI_COMM_NULL) return;
+
+    auto& _info = get_comm_info_impl(_comm);
+    auto  _key  = std::array<uint64_t, 3>{ _parent_info.id, _seq, _info.id };
+    _info.id    = get_hash(_key.data(), _key.size());
+}
+
+int32_t
+get_world_rank(const comm_info& _info, int _rank)
+{
+    if(_rank < 0 || _rank >= static_cast<int>(_info.world_ranks.size())) return -1;
+    return _info.world_ranks.at(_rank);
+}
+
+// returns the name of the frame when it is outside of omnitrace and the MPI library
+std::optional<std::string>
+get_frame_name(void* _pc)
+{
+    Dl_info _info = {};
+    if(dladdr(_pc, &_info) == 0 || !_info.dli_fname)
+        return TIMEMORY_JOIN("", "0x", std::hex, reinterpret_cast<uintptr_t>(_pc));
+
+    auto _fname = std::string_view{ _info.dli_fname };
+    for(const auto* itr : { "libomnitrace", "libgotcha", "libmpi", "libpmpi", "libmpich",
+                            "libopen-pal", "libopen-rte", "libucp", "libucs", "libuct",
+                            "libfabric" })
+    {
+        if(_fname.find(itr) != std::string_view::npos) return std::nullopt;
+    }
+
+    if(_info.dli_sname) return tim::demangle(_info.dli_sname);
+
+    auto _base = _fname.substr(_fname.find_last_of('/') + 1);
+    return TIMEMORY_JOIN("", _base, "+0x", std::hex,
+                         reinterpret_cast<uintptr_t>(_pc) -
+                             reinterpret_cast<uintptr_t>(_info.dli_fbase));
+}
+
+// calls shorter than this cannot contain a wait worth attributing to a call site so
+// they are only identified by the MPI function and the backtrace is skipped
+constexpr uint64_t callsite_min_duration = 10 * units::usec;
+
+tim::hash_value_t
+get_function_callsite(const comp::gotcha_data& _data)
+{
+    static thread_local auto _callsites =
+        std::unordered_map<const void*, tim::hash_value_t>{};
+
+    auto itr = _callsites.find(&_data);
+    if(itr != _callsites.end()) return itr->second;
+
+    auto _hash = std::hash<std::string>{}(_data.tool_id);
+    {
+        auto _lk = locking::atomic_lock{ get_callsite_mutex() };
+        get_callsite_names().emplace(_hash, _data.tool_id);
+    }
+    return _callsites.emplace(&_data, _hash).first->second;
+}
+
+// identifies the call site as the MPI function plus the first frame of the caller
+tim::hash_value_t
+get_callsite(const comp::gotcha_data& _data)
+{
+    constexpr int max_depth = 16;
+
+    using frame_cache_t    = std::unordered_map<uintptr_t, std::optional<std::string>>;
+    using callsite_key_t   = std::pair<const void*, uintptr_t>;
+    using callsite_cache_t = std::map<callsite_key_t, tim::hash_value_t>;
+
+    static thread_local auto _frames    = frame_cache_t{};
+    static thread_local auto _callsites = callsite_cache_t{};
+
+    void* _stack[max_depth] = {};
+    auto  _depth            = ::backtrace(_stack, max_depth);
+    for(int i = 1; i < _depth; ++i)
+    {
+        auto _pc  = reinterpret_cast<uintptr_t>(_stack[i]);
+        auto fitr = _frames.find(_pc);
+        if(fitr == _frames.end())
+            fitr = _frames.emplace(_pc, get_frame_name(_stack[i])).first;
+        if(!fitr->second) continue;
+
+        auto _key = std::make_pair(static_cast<const void*>(&_data), _pc);
+        auto citr = _callsites.find(_key);
+        if(citr != _callsites.end()) return citr->second;
+
+        auto _name = JOIN(" @ ", _data.tool_id, *fitr->second);
+        auto _hash = std::hash<std::string>{}(_name);
+        {
+            auto _lk = locking::atomic_lock{ get_callsite_mutex() };
+            get_callsite_names().emplace(_hash, std::move(_name));
+        }
+        return _callsites.emplace(_key, _hash).first->second;
+    }
+
+    return get_function_callsite(_data);
+}
+
+// the records are exchanged as a contiguous datatype so that the counts and the
+// displacements are in records instead of bytes
+template <typename Tp>
+MPI_Datatype
+get_record_type()
+{
+    static auto _v = []() {
+        MPI_Datatype _type = MPI_DATATYPE_NULL;
+        PMPI_Type_contiguous(sizeof(Tp), MPI_BYTE, &_type);
+        PMPI_Type_commit(&_type);
+        return _type;
+    }();
+    return _v;
+}
+
+template <typename Tp>
+std::vector<std::vector<Tp>>
+exchange(const std::vector<std::vector<Tp>>& _data)
+{
+    auto _size     = static_cast<int>(_data.size());
+    auto _scounts  = std::vector<int>(_size, 0);
+    auto _rcounts  = std::vector<int>(_size, 0);
+    auto _sdispls  = std::vector<int>(_size, 0);
+    auto _rdispls  = std::vector<int>(_size, 0);
+    auto _sendbuf  = std::vector<Tp>{};
+    auto _recvbuf  = std::vector<Tp>{};
+    auto _type     = get_record_type<Tp>();
+    int  _nrecords = 0;
+
+    for(int i = 0; i < _size; ++i)
+    {
+        _scounts.at(i) = _data.at(i).size();
+        _sendbuf.insert(_sendbuf.end(), _data.at(i).begin(), _data.at(i).end());
+    }
+
+    PMPI_Alltoall(_scounts.data(), 1, MPI_INT, _rcounts.data(), 1, MPI_INT,
+                  MPI_COMM_WORLD);
+
+    for(int i = 0; i < _size; ++i)
+    {
+        if(i > 0) _sdispls.at(i) = _sdispls.at(i - 1) + _scounts.at(i - 1);
+        if(i > 0) _rdispls.at(i) = _rdispls.at(i - 1) + _rcounts.at(i - 1);
+        _nrecords += _rcounts.at(i);
+    }
+
+    _recvbuf.resize(_nrecords);
+    PMPI_Alltoallv(_sendbuf.data(), _scounts.data(), _sdispls.data(), _type,
+                   _recvbuf.data(), _rcounts.data(), _rdispls.data(), _type,
+                   MPI_COMM_WORLD);
+
+    auto _ret = std::vector<std::vector<Tp>>(_size);
+    for(int i = 0; i < _size; ++i)
+    {
+        auto _beg = _recvbuf.begin() + _rdispls.at(i);
+        _ret.at(i).assign(_beg, _beg + _rcounts.at(i));
+    }
+    return _ret;
+}
+#endif
+
+// time spent in [_beg, _end] before the peer was ready
+uint64_t
+get_wait_time(uint64_t _beg, uint64_t _end, uint64_t _ready)
+{
+    return (_ready > _beg) ? (std::min(_ready, _end) - _beg) : 0;
+}
+
+void
+write_report(std::vector<wait_entry>& _report)
+{
+    std::sort(_report.begin(), _report.end(),
+              [](const auto& _lhs, const auto& _rhs) { return _lhs.wait > _rhs.wait; });
+
+    auto _sec = [](uint64_t _v) { return static_cast<double>(_v) / units::sec; };
+
+    auto _totals = std::map<std::string, uint64_t>{};
+    for(const auto& itr : _report)
+        _totals[itr.state] += itr.wait;
+
+    for(const auto& itr : _totals)
+        OMNITRACE_VERBOSE(1, "mpi wait states :: %s :: %.6f sec\n", itr.first.c_str(),
+                          _sec(itr.second));
+
+    if(_report.empty()) return;
+
+    output::write_text_and_json(
+        "mpi-wait-states",
+        [&](std::ostream& ofs) {
+            ofs << std::setw(20) << "STATE"
+                << "  " << std::setw(6) << "PEER"
+                << "  " << std::setw(10) << "COUNT"
+                << "  " << std::setw(14) << "WAIT (sec)"
+                << "  " << std::setw(14) << "TOTAL (sec)"
+                << "  "
+                << "CALL-SITE\n";
+            ofs << std::fixed << std::setprecision(6);
+            for(const auto& itr : _report)
+            {
+                ofs << std::setw(20) << itr.state << "  " << std::setw(6)
+                    << ((itr.peer >= 0) ? std::to_string(itr.peer) : std::string{ "-" })
+                    << "  " << std::setw(10) << itr.count << "  " << std::setw(14)
+                    << _sec(itr.wait) << "  " << std::setw(14) << _sec(itr.duration)
+                    << "  " << itr.callsite << "\n";
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("mpi_wait_states", _report));
+        });
+}
+}  // namespace
+
+bool
+mpi_wait_state::is_enabled()
+{
+    return config::get_use_mpip() && config::get_mpi_wait_states();
+}
+
+#if defined(OMNITRACE_USE_MPI)
+void
+mpi_wait_state::begin(const gotcha_data_t&, event_kind _kind, int _peer, int _tag,
+                      MPI_Comm _comm)
+{
+    if(!is_enabled() || get_state() != State::Active) return;
+    if(get_thread_state() != ThreadState::Enabled) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    const auto& _info = get_comm_info(_comm);
+
+    m_comm       = _comm;
+    m_event.kind = _kind;
+    m_event.tag  = _tag;
+    m_event.comm = _info.id;
+    m_event.peer = (_peer == MPI_ANY_SOURCE) ? _peer : get_world_rank(_info, _peer);
+    m_event.beg  = timestamp::now();
+}
+
+// MPI_Send, MPI_Ssend, MPI_Rsend, MPI_Bsend
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, const void*, int,
+                      MPI_Datatype, int dst, int tag, MPI_Comm comm)
+{
+    begin(_data, send_kind, dst, tag, comm);
+}
+
+// MPI_Recv
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, void*, int,
+                      MPI_Datatype, int src, int tag, MPI_Comm comm, MPI_Status* status)
+{
+    m_status = status;
+    begin(_data, recv_kind, src, tag, comm);
+}
+
+// MPI_Barrier
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, MPI_Comm comm)
+{
+    begin(_data, collective_kind, -1, 0, comm);
+}
+
+// MPI_Bcast
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, void*, int,
+                      MPI_Datatype, int root, MPI_Comm comm)
+{
+    begin(_data, collective_kind, root, 0, comm);
+}
+
+// MPI_Allreduce, MPI_Scan, MPI_Exscan
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, const void*, void*,
+                      int, MPI_Datatype, MPI_Op, MPI_Comm comm)
+{
+    begin(_data, collective_kind, -1, 0, comm);
+}
+
+// MPI_Reduce
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, const void*, void*,
+                      int, MPI_Datatype, MPI_Op, int root, MPI_Comm comm)
+{
+    begin(_data, collective_kind, root, 0, comm);
+}
+
+// MPI_Gather, MPI_Scatter
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, const void*, int,
+                      MPI_Datatype, void*, int, MPI_Datatype, int root, MPI_Comm comm)
+{
+    begin(_data, collective_kind, root, 0, comm);
+}
+
+// MPI_Allgather, MPI_Alltoall
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, const void*, int,
+                      MPI_Datatype, void*, int, MPI_Datatype, MPI_Comm comm)
+{
+    begin(_data, collective_kind, -1, 0, comm);
+}
+
+// MPI_Comm_dup
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, MPI_Comm comm,
+                      MPI_Comm* newcomm)
+{
+    if(_data.tool_id == "MPI_Comm_dup") begin_comm(comm, newcomm);
+}
+
+// MPI_Comm_create
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, MPI_Comm comm,
+                      MPI_Group, MPI_Comm* newcomm)
+{
+    if(_data.tool_id == "MPI_Comm_create") begin_comm(comm, newcomm);
+}
+
+// MPI_Comm_split
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::incoming, MPI_Comm comm, int,
+                      int, MPI_Comm* newcomm)
+{
+    if(_data.tool_id == "MPI_Comm_split") begin_comm(comm, newcomm);
+}
+
+// the communicators created by every member of the parent are tracked regardless of
+// the state of the thread so that the order of creation is the same on every rank
+void
+mpi_wait_state::begin_comm(MPI_Comm _comm, MPI_Comm* _newcomm)
+{
+    if(!is_enabled()) return;
+
+    m_comm    = _comm;
+    m_newcomm = _newcomm;
+}
+
+void
+mpi_wait_state::audit(const gotcha_data_t& _data, audit::outgoing, int _retval)
+{
+    if(m_newcomm)
+    {
+        OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+        add_comm_info(m_comm, (_retval == MPI_SUCCESS) ? *m_newcomm : MPI_COMM_NULL);
+        m_newcomm = nullptr;
+        return;
+    }
+
+    if(m_event.kind == none_kind) return;
+
+    m_event.end = timestamp::now();
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    // wildcard receives are resolved to the actual source and tag
+    if(m_event.kind == recv_kind &&
+       (m_event.peer == MPI_ANY_SOURCE || m_event.tag == MPI_ANY_TAG))
+    {
+        if(m_status && m_status != MPI_STATUS_IGNORE)
+        {
+            m_event.peer = get_world_rank(get_comm_info(m_comm), m_status->MPI_SOURCE);
+            m_event.tag  = m_status->MPI_TAG;
+        }
+        else
+        {
+            m_event.peer = -1;
+        }
+    }
+
+    // point-to-point calls with MPI_PROC_NULL or an unresolved wildcard are dropped
+    if(_retval == MPI_SUCCESS && (m_event.kind == collective_kind || m_event.peer >= 0))
+    {
+        // the wait is bounded by the duration of the call
+        m_event.callsite = (m_event.end - m_event.beg >= callsite_min_duration)
+                               ? get_callsite(_data)
+                               : get_function_callsite(_data);
+        get_thread_events()->emplace_back(m_event);
+    }
+
+    m_event = event{};
+}
+#endif
+
+void
+mpi_wait_state::post_process()
+{
+#if defined(OMNITRACE_USE_MPI)
+    static bool _once = false;
+    if(_once || !is_enabled()) return;
+    _once = true;
+
+    int _initialized = 0;
+    int _finalized   = 0;
+    PMPI_Initialized(&_initialized);
+    PMPI_Finalized(&_finalized);
+    if(_initialized == 0 || _finalized != 0) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    int _rank = 0;
+    int _size = 1;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &_rank);
+    PMPI_Comm_size(MPI_COMM_WORLD, &_size);
+
+    // merge the events of every thread in the order the calls were entered
+    auto _events = event_vec_t{};
+    if(auto* _data = event_data_t::get())
+    {
+        for(auto& itr : *_data)
+            if(itr) _events.insert(_events.end(), itr->begin(), itr->end());
+    }
+    // the timestamps are compared with the other ranks so the drift of the counter
+    // since initialization is removed
+    for(auto& itr : _events)
+    {
+        itr.beg = timestamp::fit(itr.beg);
+        itr.end = timestamp::fit(itr.end);
+    }
+    std::stable_sort(_events.begin(), _events.end(),
+                     [](const auto& _lhs, const auto& _rhs) {
+                         return _lhs.beg < _rhs.beg;
+                     });
+
+    struct match_record
+    {
+        uint64_t comm = 0;
+        uint64_t beg  = 0;
+        uint64_t end  = 0;
+        int32_t  tag  = 0;
+        uint32_t seq  = 0;
+    };
+
+    struct collective_record
+    {
+        uint64_t comm = 0;
+        uint64_t seq  = 0;
+        uint64_t beg  = 0;
+    };
+
+    // messages between two ranks with the same tag and communicator are
+    // non-overtaking so the n-th send matches the n-th receive of the channel
+    using channel_t = std::tuple<uint8_t, int32_t, uint64_t, int32_t>;
+
+    auto _sends       = std::vector<std::vector<match_record>>(_size);
+    auto _recvs       = std::vector<std::vector<match_record>>(_size);
+    auto _send_events = std::vector<std::vector<const event_t*>>(_size);
+    auto _recv_events = std::vector<std::vector<const event_t*>>(_size);
+    auto _collectives = std::vector<collective_record>{};
+    auto _coll_events = std::vector<const event_t*>{};
+    auto _channel_seq = std::map<channel_t, uint32_t>{};
+    auto _coll_seq    = std::map<uint64_t, uint64_t>{};
+
+    for(const auto& itr : _events)
+    {
+        if(itr.kind == collective_kind)
+        {
+            _collectives.emplace_back(
+                collective_record{ itr.comm, _coll_seq[itr.comm]++, itr.beg });
+            _coll_events.emplace_back(&itr);
+        }
+        else if(itr.peer >= 0 && itr.peer < _size)
+        {
+            auto  _key = channel_t{ itr.kind, itr.peer, itr.comm, itr.tag };
+            auto  _seq = _channel_seq[_key]++;
+            auto  _rec = match_record{ itr.comm, itr.beg, itr.end, itr.tag, _seq };
+            auto& _records = (itr.kind == send_kind) ? _sends : _recvs;
+            auto& _ptrs    = (itr.kind == send_kind) ? _send_events : _recv_events;
+            _records.at(itr.peer).emplace_back(_rec);
+            _ptrs.at(itr.peer).emplace_back(&itr);
+        }
+    }
+
+    // receive the sends which the peers posted to this rank and vice versa
+    auto _peer_sends = exchange(_sends);
+    auto _peer_recvs = exchange(_recvs);
+
+    using wait_key_t = std::tuple<uint8_t, tim::hash_value_t, int32_t>;
+    auto _waits      = std::map<wait_key_t, std::tuple<uint64_t, uint64_t, uint64_t>>{};
+    auto _add_wait   = [&_waits](uint8_t _state, const event_t* _event, int32_t _peer,
+                               uint64_t _wait) {
+        auto& _v = _waits[wait_key_t{ _state, _event->callsite, _peer }];
+        std::get<0>(_v) += 1;
+        std::get<1>(_v) += _wait;
+        std::get<2>(_v) += (_event->end - _event->beg);
+    };
+
+    using match_key_t = std::tuple<uint64_t, int32_t, uint32_t>;
+    auto _match       = [](const std::vector<match_record>& _local,
+                     const std::vector<match_record>& _remote, auto&& _func) {
+        auto _index = std::map<match_key_t, const match_record*>{};
+        for(const auto& itr : _remote)
+            _index.emplace(match_key_t{ itr.comm, itr.tag, itr.seq }, &itr);
+        for(size_t i = 0; i < _local.size(); ++i)
+        {
+            const auto& _v = _local.at(i);
+            auto        itr = _index.find(match_key_t{ _v.comm, _v.tag, _v.seq });
+            if(itr != _index.end()) _func(i, _v, *itr->second);
+        }
+    };
+
+    for(int p = 0; p < _size; ++p)
+    {
+        // this rank received before the peer sent
+        _match(_recvs.at(p), _peer_sends.at(p),
+               [&](size_t i, const match_record& _recv, const match_record& _send) {
+                   _add_wait(late_sender, _recv_events.at(p).at(i), p,
+                             get_wait_time(_recv.beg, _recv.end, _send.beg));
+               });
+
+        // this rank sent before the peer posted the receive
+        _match(_sends.at(p), _peer_recvs.at(p),
+               [&](size_t i, const match_record& _send, const match_record& _recv) {
+                   _add_wait(late_receiver, _send_events.at(p).at(i), p,
+                             get_wait_time(_send.beg, _send.end, _recv.beg));
+               });
+    }
+
+    // the last rank to enter a collective determines when the others can proceed
+    {
+        int  _ncount = _collectives.size();
+        auto _counts = std::vector<int>(_size, 0);
+        auto _displs = std::vector<int>(_size, 0);
+        auto _type   = get_record_type<collective_record>();
+        PMPI_Gather(&_ncount, 1, MPI_INT, _counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        auto _total = 0;
+        for(int i = 0; i < _size; ++i)
+        {
+            _displs.at(i) = _total;
+            _total += _counts.at(i);
+        }
+
+        auto _all = std::vector<collective_record>(_total);
+        PMPI_Gatherv(_collectives.data(), _ncount, _type, _all.data(), _counts.data(),
+                     _displs.data(), _type, 0, MPI_COMM_WORLD);
+
+        auto _last = std::vector<collective_record>{};
+        if(_rank == 0)
+        {
+            auto _latest = std::map<std::pair<uint64_t, uint64_t>, uint64_t>{};
+            for(const auto& itr : _all)
+            {
+                auto& _v = _latest[{ itr.comm, itr.seq }];
+                _v       = std::max(_v, itr.beg);
+            }
+            for(const auto& itr : _latest)
+                _last.emplace_back(
+                    collective_record{ itr.first.first, itr.first.second, itr.second });
+        }
+
+        int _nlast = _last.size();
+        PMPI_Bcast(&_nlast, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        _last.resize(_nlast);
+        PMPI_Bcast(_last.data(), _nlast, _type, 0, MPI_COMM_WORLD);
+
+        auto _latest = std::map<std::pair<uint64_t, uint64_t>, uint64_t>{};
+        for(const auto& itr : _last)
+            _latest.emplace(std::make_pair(itr.comm, itr.seq), itr.beg);
+
+        for(size_t i = 0; i < _collectives.size(); ++i)
+        {
+            const auto& _v  = _collectives.at(i);
+            auto        itr = _latest.find({ _v.comm, _v.seq });
+            if(itr == _latest.end()) continue;
+            const auto* _event = _coll_events.at(i);
+            _add_wait(collective_imbalance, _event, -1,
+                      get_wait_time(_event->beg, _event->end, itr->second));
+        }
+    }
+
+    auto _report = std::vector<wait_entry>{};
+    {
+        auto  _lk    = locking::atomic_lock{ get_callsite_mutex() };
+        auto& _names = get_callsite_names();
+        for(const auto& itr : _waits)
+        {
+            auto _name = _names.find(std::get<1>(itr.first));
+            _report.emplace_back(wait_entry{
+                get_wait_state_name(std::get<0>(itr.first)),
+                (_name != _names.end()) ? _name->second : std::string{ "unknown" },
+                std::get<2>(itr.first), std::get<0>(itr.second), std::get<1>(itr.second),
+                std::get<2>(itr.second) });
+        }
+    }
+
+    write_report(_report);
+#endif
+}
+}  // namespace component
+}  // namespace omnitrace
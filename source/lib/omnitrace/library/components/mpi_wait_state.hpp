@@ -0,0 +1,140 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "core/common.hpp"
+#include "core/defines.hpp"
+#include "core/timemory.hpp"
+
+#include <timemory/components/gotcha/backends.hpp>
+#include <timemory/mpl/types.hpp>
+
+#if defined(OMNITRACE_USE_MPI)
+#    include <mpi.h>
+#endif
+
+#include <cstdint>
+#include <string>
+
+namespace omnitrace
+{
+namespace component
+{
+// records the entry and exit of blocking point-to-point and collective MPI calls so
+// that the time spent waiting on other ranks can be classified post-mortem as
+// late-sender, late-receiver, or collective imbalance
+struct mpi_wait_state : comp::base<mpi_wait_state, void>
+{
+    using gotcha_data_t = comp::gotcha_data;
+
+    enum event_kind : uint8_t
+    {
+        none_kind = 0,
+        send_kind,
+        recv_kind,
+        collective_kind,
+    };
+
+    struct event
+    {
+        uint8_t           kind     = none_kind;
+        int32_t           peer     = -1;  // rank of the peer in MPI_COMM_WORLD
+        int32_t           tag      = 0;
+        uint64_t          comm     = 0;  // identifies the communicator on every rank
+        tim::hash_value_t callsite = 0;
+        uint64_t          beg      = 0;
+        uint64_t          end      = 0;
+    };
+
+    OMNITRACE_DEFAULT_OBJECT(mpi_wait_state)
+
+    static std::string label() { return "mpi_wait_state"; }
+
+    static bool is_enabled();
+
+    // exchanges the event timestamps between the ranks, classifies the wait time,
+    // and writes the report. Must be called by every rank before MPI_Finalize
+    static void post_process();
+
+    void start() {}
+    void stop() {}
+
+#if defined(OMNITRACE_USE_MPI)
+    // MPI_Send, MPI_Ssend, MPI_Rsend, MPI_Bsend
+    void audit(const gotcha_data_t&, audit::incoming, const void*, int, MPI_Datatype,
+               int dst, int tag, MPI_Comm);
+
+    // MPI_Recv
+    void audit(const gotcha_data_t&, audit::incoming, void*, int, MPI_Datatype, int src,
+               int tag, MPI_Comm, MPI_Status*);
+
+    // MPI_Barrier
+    void audit(const gotcha_data_t&, audit::incoming, MPI_Comm);
+
+    // MPI_Bcast
+    void audit(const gotcha_data_t&, audit::incoming, void*, int, MPI_Datatype, int root,
+               MPI_Comm);
+
+    // MPI_Allreduce, MPI_Scan, MPI_Exscan
+    void audit(const gotcha_data_t&, audit::incoming, const void*, void*, int,
+               MPI_Datatype, MPI_Op, MPI_Comm);
+
+    // MPI_Reduce
+    void audit(const gotcha_data_t&, audit::incoming, const void*, void*, int,
+               MPI_Datatype, MPI_Op, int root, MPI_Comm);
+
+    // MPI_Gather, MPI_Scatter
+    void audit(const gotcha_data_t&, audit::incoming, const void*, int, MPI_Datatype,
+               void*, int, MPI_Datatype, int root, MPI_Comm);
+
+    // MPI_Allgather, MPI_Alltoall
+    void audit(const gotcha_data_t&, audit::incoming, const void*, int, MPI_Datatype,
+               void*, int, MPI_Datatype, MPI_Comm);
+
+    // MPI_Comm_dup
+    void audit(const gotcha_data_t&, audit::incoming, MPI_Comm, MPI_Comm*);
+
+    // MPI_Comm_create
+    void audit(const gotcha_data_t&, audit::incoming, MPI_Comm, MPI_Group, MPI_Comm*);
+
+    // MPI_Comm_split
+    void audit(const gotcha_data_t&, audit::incoming, MPI_Comm, int color, int key,
+               MPI_Comm*);
+
+    void audit(const gotcha_data_t&, audit::outgoing, int);
+
+private:
+    void begin(const gotcha_data_t&, event_kind, int, int, MPI_Comm);
+    void begin_comm(MPI_Comm, MPI_Comm*);
+
+    MPI_Comm    m_comm    = MPI_COMM_NULL;
+    MPI_Comm*   m_newcomm = nullptr;
+    MPI_Status* m_status  = nullptr;
+#endif
+
+private:
+    event m_event = {};
+};
+}  // namespace component
+}  // namespace omnitrace
@@ -23,23 +23,110 @@
 #include "library/components/pthread_mutex_gotcha.hpp"
 #include "core/config.hpp"
 #include "core/debug.hpp"
+#include "core/output.hpp"
 #include "core/utility.hpp"
 #include "library/components/category_region.hpp"
 #include "library/runtime.hpp"
+#include "library/thread_data.hpp"
 #include "library/thread_info.hpp"
+#include "library/tracing.hpp"
 
 #include <timemory/backends/threading.hpp>
+#include <timemory/mpl/policy.hpp>
+#include <timemory/operations/types/file_output_message.hpp>
+#include <timemory/tpls/cereal/archives.hpp>
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+#include <timemory/utility/filepath.hpp>
+#include <timemory/utility/join.hpp>
 #include <timemory/utility/signals.hpp>
 #include <timemory/utility/types.hpp>
 
+#include <algorithm>
 #include <cstdint>
+#include <iomanip>
+#include <map>
 #include <pthread.h>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace omnitrace
 {
 namespace component
 {
+namespace
+{
+struct lock_contention
+{
+    uintptr_t   address = 0;
+    const char* name    = nullptr;
+    uint64_t    count   = 0;  // number of contended acquisitions
+    uint64_t    total   = 0;  // total wait time (nsec)
+    uint64_t    max     = 0;  // max wait time (nsec)
+    int64_t     holder  = 0;  // holder TID during the max wait
+    int64_t     waiter  = 0;  // waiter TID during the max wait
+
+    lock_contention& operator+=(const lock_contention& _rhs)
+    {
+        if(!name) name = _rhs.name;
+        count += _rhs.count;
+        total += _rhs.total;
+        if(_rhs.max > max)
+        {
+            max    = _rhs.max;
+            holder = _rhs.holder;
+            waiter = _rhs.waiter;
+        }
+        return *this;
+    }
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("address", address),
+           cereal::make_nvp("name", std::string{ (name) ? name : "" }),
+           cereal::make_nvp("count", count), cereal::make_nvp("total_ns", total),
+           cereal::make_nvp("max_ns", max), cereal::make_nvp("max_holder_tid", holder),
+           cereal::make_nvp("max_waiter_tid", waiter));
+    }
+};
+
+using lock_contention_map_t  = std::unordered_map<uintptr_t, lock_contention>;
+using lock_contention_data_t = thread_data<lock_contention_map_t, pthread_mutex_gotcha>;
+
+// the thread ID (as seen by the kernel) of the current holder of the lock. This is
+// read without synchronization from the glibc internals so it is only a hint.
+template <typename Tp>
+int64_t
+get_lock_holder(Tp*)
+{
+    return 0;
+}
+
+#if defined(__GLIBC__)
+int64_t
+get_lock_holder(pthread_mutex_t* _v)
+{
+    return __atomic_load_n(&_v->__data.__owner, __ATOMIC_RELAXED);
+}
+
+int64_t
+get_lock_holder(pthread_rwlock_t* _v)
+{
+    return __atomic_load_n(&_v->__data.__cur_writer, __ATOMIC_RELAXED);
+}
+#endif
+
+bool
+is_contention_lock(std::string_view _id)
+{
+    return (_id == "pthread_mutex_lock" || _id == "pthread_rwlock_rdlock" ||
+            _id == "pthread_rwlock_wrlock" || _id == "pthread_spin_lock");
+}
+}  // namespace
+
 pthread_mutex_gotcha::hash_array_t&
 pthread_mutex_gotcha::get_hashes()
 {
@@ -66,6 +153,12 @@ pthread_mutex_gotcha::get_hashes()
             for(size_t i = 9; i < 12; ++i)
                 _skip.emplace(i);
         }
+        if(config::get_trace_thread_locks_contention())
+        {
+            // only the blocking lock functions are wrapped in contention mode
+            for(size_t i : { 1, 2, 5, 6, 7, 10, 11 })
+                _skip.emplace(i);
+        }
         if(!config::get_trace_thread_barriers()) _skip.emplace(8);
         if(!config::get_trace_thread_join()) _skip.emplace(12);
         for(size_t i = 0; i < gotcha_capacity; ++i)
@@ -96,16 +189,25 @@ pthread_mutex_gotcha::configure()
     pthread_mutex_gotcha_t::get_initializer() = []() {
         if(!tim::settings::enabled() || get_use_causal()) return;
 
+        // in contention mode, the unlock and trylock functions are not wrapped
+        // since they never block
+        auto _contention = config::get_trace_thread_locks_contention();
+
         if(config::get_trace_thread_locks())
         {
             pthread_mutex_gotcha_t::configure(
                 comp::gotcha_config<0, int, pthread_mutex_t*>{ "pthread_mutex_lock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<1, int, pthread_mutex_t*>{ "pthread_mutex_unlock" });
+            if(!_contention)
+            {
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<1, int, pthread_mutex_t*>{
+                        "pthread_mutex_unlock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<2, int, pthread_mutex_t*>{ "pthread_mutex_trylock" });
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<2, int, pthread_mutex_t*>{
+                        "pthread_mutex_trylock" });
+            }
         }
 
         if(config::get_trace_thread_rwlocks())
@@ -118,17 +220,20 @@ pthread_mutex_gotcha::configure()
                 comp::gotcha_config<4, int, pthread_rwlock_t*>{
                     "pthread_rwlock_wrlock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<5, int, pthread_rwlock_t*>{
-                    "pthread_rwlock_tryrdlock" });
+            if(!_contention)
+            {
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<5, int, pthread_rwlock_t*>{
+                        "pthread_rwlock_tryrdlock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<6, int, pthread_rwlock_t*>{
-                    "pthread_rwlock_trywrlock" });
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<6, int, pthread_rwlock_t*>{
+                        "pthread_rwlock_trywrlock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<7, int, pthread_rwlock_t*>{
-                    "pthread_rwlock_unlock" });
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<7, int, pthread_rwlock_t*>{
+                        "pthread_rwlock_unlock" });
+            }
         }
 
         if(config::get_trace_thread_barriers())
@@ -143,13 +248,16 @@ pthread_mutex_gotcha::configure()
             pthread_mutex_gotcha_t::configure(
                 comp::gotcha_config<9, int, pthread_spinlock_t*>{ "pthread_spin_lock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<10, int, pthread_spinlock_t*>{
-                    "pthread_spin_trylock" });
+            if(!_contention)
+            {
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<10, int, pthread_spinlock_t*>{
+                        "pthread_spin_trylock" });
 
-            pthread_mutex_gotcha_t::configure(
-                comp::gotcha_config<11, int, pthread_spinlock_t*>{
-                    "pthread_spin_unlock" });
+                pthread_mutex_gotcha_t::configure(
+                    comp::gotcha_config<11, int, pthread_spinlock_t*>{
+                        "pthread_spin_unlock" });
+            }
         }
 
         if(config::get_trace_thread_join())
@@ -166,9 +274,80 @@ pthread_mutex_gotcha::shutdown()
     pthread_mutex_gotcha_t::disable();
 }
 
+void
+pthread_mutex_gotcha::post_process()
+{
+    if(!config::get_trace_thread_locks_contention()) return;
+
+    auto* _data = lock_contention_data_t::get();
+    if(!_data) return;
+
+    auto _merged = std::map<uintptr_t, lock_contention>{};
+    for(const auto& itr : *_data)
+    {
+        if(!itr) continue;
+        for(const auto& litr : *itr)
+            _merged[litr.first] += litr.second;
+    }
+
+    auto _contention = std::vector<lock_contention>{};
+    _contention.reserve(_merged.size());
+    uint64_t _total = 0;
+    for(auto& itr : _merged)
+    {
+        itr.second.address = itr.first;
+        _total += itr.second.total;
+        _contention.emplace_back(itr.second);
+    }
+
+    std::sort(_contention.begin(), _contention.end(),
+              [](const auto& _lhs, const auto& _rhs) { return _lhs.total > _rhs.total; });
+
+    OMNITRACE_VERBOSE(1, "lock contention :: %zu contended locks, %.6f sec total wait\n",
+                      _contention.size(), static_cast<double>(_total) / units::sec);
+
+    if(_contention.empty()) return;
+
+    output::write_text_and_json(
+        "lock-contention",
+        [&](std::ostream& ofs) {
+            ofs << std::setw(18) << "ADDRESS"
+                << "  " << std::setw(24) << "FUNCTION"
+                << "  " << std::setw(10) << "COUNT"
+                << "  " << std::setw(16) << "TOTAL (nsec)"
+                << "  " << std::setw(16) << "MEAN (nsec)"
+                << "  " << std::setw(16) << "MAX (nsec)"
+                << "  " << std::setw(10) << "HOLDER"
+                << "  " << std::setw(10) << "WAITER"
+                << "\n";
+            for(const auto& itr : _contention)
+            {
+                auto _addr = TIMEMORY_JOIN("", "0x", std::hex, itr.address);
+                ofs << std::setw(18) << _addr << "  " << std::setw(24)
+                    << ((itr.name) ? itr.name : "") << "  " << std::setw(10)
+                    << itr.count << "  " << std::setw(16) << itr.total << "  "
+                    << std::setw(16) << (itr.total / std::max<uint64_t>(itr.count, 1))
+                    << "  " << std::setw(16) << itr.max << "  " << std::setw(10)
+                    << itr.holder << "  " << std::setw(10) << itr.waiter << "\n";
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("lock_contention", _contention));
+        });
+}
+
 pthread_mutex_gotcha::pthread_mutex_gotcha(const gotcha_data_t& _data)
 : m_data{ &_data }
-{}
+{
+    if(config::get_trace_thread_locks_contention() && is_contention_lock(_data.tool_id))
+    {
+        m_contention = true;
+        m_rwlock_try = (_data.tool_id == "pthread_rwlock_wrlock")
+                           ? &pthread_rwlock_trywrlock
+                           : &pthread_rwlock_tryrdlock;
+    }
+}
 
 template <typename... Args>
 auto
@@ -206,11 +385,70 @@ pthread_mutex_gotcha::operator()(uintptr_t&&, int (*_callee)(Args...),
     return _ret;
 }
 
+template <typename Tp>
+int
+pthread_mutex_gotcha::contended(int (*_callee)(Tp*), int (*_trylock)(Tp*),
+                                Tp* _lock) const
+{
+    // uncontended acquisitions (and errors unrelated to contention) return immediately
+    auto _ret = (*_trylock)(_lock);
+    if(OMNITRACE_LIKELY(_ret != EBUSY)) return _ret;
+    if(is_disabled()) return (*_callee)(_lock);
+
+    auto _holder = get_lock_holder(_lock);
+    auto _beg    = tracing::now();
+    _ret         = (*_callee)(_lock);
+    auto _end    = tracing::now();
+
+    struct local_dtor
+    {
+        explicit local_dtor(bool& _v)
+        : _protect{ _v }
+        {}
+        ~local_dtor() { _protect = false; }
+        bool& _protect;
+    } _dtor{ m_protect = true };
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    static const auto _threshold = static_cast<uint64_t>(
+        config::get_trace_thread_locks_contention_threshold() * units::usec);
+
+    auto  _wait   = _end - _beg;
+    auto  _waiter = threading::get_sys_tid();
+    auto  _addr   = reinterpret_cast<uintptr_t>(_lock);
+    auto& _data   = lock_contention_data_t::instance(construct_on_thread{});
+    auto& _entry  = (*_data)[_addr];
+
+    _entry += lock_contention{ _addr,   m_data->tool_id.c_str(), 1, _wait, _wait,
+                               _holder, _waiter };
+
+    if(get_use_perfetto() && _wait >= _threshold)
+    {
+        const char* _name = m_data->tool_id.c_str();
+        tracing::push_perfetto_ts(
+            category::pthread{}, _name, _beg, [&](::perfetto::EventContext ctx) {
+                if(config::get_perfetto_annotations())
+                {
+                    tracing::add_perfetto_annotation(ctx, "lock",
+                                                     static_cast<void*>(_lock));
+                    tracing::add_perfetto_annotation(ctx, "holder", _holder);
+                    tracing::add_perfetto_annotation(ctx, "waiter", _waiter);
+                    tracing::add_perfetto_annotation(ctx, "wait_ns", _wait);
+                }
+            });
+        tracing::pop_perfetto_ts(category::pthread{}, _name, _end);
+    }
+
+    return _ret;
+}
+
 int
 pthread_mutex_gotcha::operator()(int (*_callee)(pthread_mutex_t*),
                                  pthread_mutex_t* _mutex) const
 {
     if(get_state() != ::omnitrace::State::Active || m_protect) return (*_callee)(_mutex);
+    if(m_contention) return contended(_callee, &pthread_mutex_trylock, _mutex);
     return (*this)(reinterpret_cast<uintptr_t>(_mutex), _callee, _mutex);
 }
 
@@ -219,6 +457,7 @@ pthread_mutex_gotcha::operator()(int (*_callee)(pthread_spinlock_t*),
                                  pthread_spinlock_t* _lock) const
 {
     if(get_state() != ::omnitrace::State::Active || m_protect) return (*_callee)(_lock);
+    if(m_contention) return contended(_callee, &pthread_spin_trylock, _lock);
     return (*this)(reinterpret_cast<uintptr_t>(_lock), _callee, _lock);
 }
 
@@ -227,6 +466,7 @@ pthread_mutex_gotcha::operator()(int (*_callee)(pthread_rwlock_t*),
                                  pthread_rwlock_t* _lock) const
 {
     if(get_state() != ::omnitrace::State::Active || m_protect) return (*_callee)(_lock);
+    if(m_contention) return contended(_callee, m_rwlock_try, _lock);
     return (*this)(reinterpret_cast<uintptr_t>(_lock), _callee, _lock);
 }
 
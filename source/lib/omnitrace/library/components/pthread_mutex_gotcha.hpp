@@ -55,6 +55,9 @@ struct pthread_mutex_gotcha : comp::base<pthread_mutex_gotcha, void>
     static void configure();
     static void shutdown();
 
+    // report the per-lock contention statistics
+    static void post_process();
+
     int operator()(int (*)(pthread_mutex_t*), pthread_mutex_t*) const;
     int operator()(int (*)(pthread_spinlock_t*), pthread_spinlock_t*) const;
     int operator()(int (*)(pthread_rwlock_t*), pthread_rwlock_t*) const;
@@ -68,8 +71,14 @@ private:
     template <typename... Args>
     auto operator()(uintptr_t&&, int (*)(Args...), Args...) const;
 
-    mutable bool         m_protect = false;
-    const gotcha_data_t* m_data    = nullptr;
+    // attempts the trylock variant first and only records when the lock is contended
+    template <typename Tp>
+    int contended(int (*)(Tp*), int (*)(Tp*), Tp*) const;
+
+    mutable bool         m_protect    = false;
+    bool                 m_contention = false;
+    const gotcha_data_t* m_data       = nullptr;
+    int (*m_rwlock_try)(pthread_rwlock_t*) = nullptr;
 };
 
 using pthread_mutex_gotcha_t = comp::gotcha<pthread_mutex_gotcha::gotcha_capacity,
@@ -0,0 +1,285 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "library/event_log.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/perfetto.hpp"
+#include "core/state.hpp"
+#include "library/thread_data.hpp"
+#include "library/thread_info.hpp"
+#include "library/tracing.hpp"
+
+#include <timemory/hash/types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omnitrace
+{
+namespace event_log
+{
+namespace
+{
+enum record_kind : uint64_t
+{
+    begin_kind = 0,
+    end_kind   = 1,
+};
+
+// fixed-size record appended on every region entry and exit. Encoding into perfetto
+// protobuf is deferred until post-processing
+struct record
+{
+    uint64_t          timestamp : 63;
+    uint64_t          kind      : 1;
+    tim::hash_value_t region;
+};
+
+static_assert(sizeof(record) == 16, "event log records should be 16 bytes");
+
+using pos_type = typename std::fstream::pos_type;
+
+size_t buffer_size = 0;
+
+// per-thread log. Only the owning thread appends to the buffer so no synchronization
+// is required until the buffer is full and is either spilled to the (shared)
+// temporary file or retained in memory when temporary files are disabled
+struct thread_log
+{
+    thread_log();
+
+    void spill();
+
+    std::vector<record>                      buffer  = {};
+    std::vector<std::vector<record>>         chunks  = {};
+    std::vector<std::pair<pos_type, size_t>> spilled = {};
+};
+
+using thread_log_data_t = thread_data<thread_log, thread_log>;
+
+auto&
+get_spill_file()
+{
+    static auto _v = []() {
+        auto _tmp_v = config::get_tmp_file("event-log");
+        if(_tmp_v)
+        {
+            auto _success = _tmp_v->open();
+            OMNITRACE_CI_FAIL(!_success,
+                              "Error opening event log temporary file '%s'\n",
+                              _tmp_v->filename.c_str());
+        }
+        return _tmp_v;
+    }();
+    return _v;
+}
+
+locking::atomic_mutex&
+get_spill_mutex()
+{
+    static auto _v = locking::atomic_mutex{};
+    return _v;
+}
+
+thread_log::thread_log() { buffer.reserve(buffer_size); }
+
+void
+thread_log::spill()
+{
+    if(buffer.empty()) return;
+
+    {
+        // use homemade atomic_mutex/atomic_lock since contention will be low
+        // and using pthread_lock might trigger our wrappers
+        auto  _lk   = locking::atomic_lock{ get_spill_mutex() };
+        auto& _file = get_spill_file();
+        if(_file && _file->stream.good())
+        {
+            auto& _fs = _file->stream;
+            spilled.emplace_back(_fs.tellp(), buffer.size());
+            _fs.write(reinterpret_cast<const char*>(buffer.data()),
+                      buffer.size() * sizeof(record));
+            buffer.clear();
+            return;
+        }
+    }
+
+    chunks.emplace_back(std::move(buffer));
+    buffer = std::vector<record>{};
+    buffer.reserve(buffer_size);
+}
+
+thread_log*
+get_thread_log()
+{
+    static thread_local auto* _v =
+        thread_log_data_t::instance(construct_on_thread{}).get();
+    return _v;
+}
+
+OMNITRACE_INLINE void
+append(record_kind _kind, tim::hash_value_t _hash)
+{
+    auto* _log = get_thread_log();
+    if(OMNITRACE_UNLIKELY(_log->buffer.size() == buffer_size)) _log->spill();
+    _log->buffer.emplace_back(record{ tracing::now(), _kind, _hash });
+}
+
+// loads the records of a thread in the order they were appended
+std::vector<record>
+load_records(thread_log& _log)
+{
+    auto _data = std::vector<record>{};
+
+    if(!_log.spilled.empty())
+    {
+        auto  _lk   = locking::atomic_lock{ get_spill_mutex() };
+        auto& _file = get_spill_file();
+        OMNITRACE_REQUIRE(_file) << "Error! event log records were spilled but the "
+                                    "temporary file does not exist\n";
+
+        auto& _fs = _file->stream;
+        _fs.flush();
+        for(const auto& itr : _log.spilled)
+        {
+            auto _offset = _data.size();
+            _data.resize(_offset + itr.second);
+            _fs.seekg(itr.first);
+            _fs.read(reinterpret_cast<char*>(_data.data() + _offset),
+                     itr.second * sizeof(record));
+        }
+        _fs.seekp(0, std::ios::end);
+    }
+
+    // spilling to the temporary file and retaining in memory are mutually exclusive
+    for(auto& itr : _log.chunks)
+        _data.insert(_data.end(), itr.begin(), itr.end());
+    _data.insert(_data.end(), _log.buffer.begin(), _log.buffer.end());
+
+    _log.spilled.clear();
+    _log.chunks.clear();
+    _log.buffer.clear();
+    return _data;
+}
+
+const char*
+get_region_name(tim::hash_value_t _hash)
+{
+    // perfetto interns static strings by address so these must outlive the session
+    static auto _names = std::unordered_map<tim::hash_value_t, std::string>{};
+    auto        itr    = _names.find(_hash);
+    if(itr == _names.end())
+    {
+        auto _name = tim::get_hash_identifier(_hash);
+        if(_name.empty()) _name = JOIN("", "0x", std::hex, _hash);
+        itr = _names.emplace(_hash, std::move(_name)).first;
+    }
+    return itr->second.c_str();
+}
+}  // namespace
+
+void
+setup()
+{
+    is_enabled() =
+        (config::get_use_perfetto() && config::get_trace_backend() == "event-log");
+    buffer_size = std::max<size_t>(config::get_event_log_buffer_size(), 1);
+    if(is_enabled()) thread_log_data_t::instance(construct_on_thread{});
+}
+
+void
+push(tim::hash_value_t _hash)
+{
+    append(begin_kind, _hash);
+}
+
+void
+pop()
+{
+    append(end_kind, 0);
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    auto* _data = thread_log_data_t::get();
+    if(!_data) return;
+
+    for(size_t i = 0; i < _data->size(); ++i)
+    {
+        auto& itr = _data->at(i);
+        if(!itr) continue;
+
+        const auto& _thread_info = thread_info::get(i, SequentTID);
+        if(!_thread_info) continue;
+
+        auto _records = load_records(*itr);
+        if(_records.empty()) continue;
+
+        auto _track = tracing::get_perfetto_track(
+            category::host{},
+            [](auto _seq_id, auto _sys_id) {
+                return TIMEMORY_JOIN(" ", "Thread", _seq_id, "Host", "(S)", _sys_id);
+            },
+            _thread_info->index_data->sequent_value,
+            _thread_info->index_data->system_value);
+
+        auto _stack = std::vector<const char*>{};
+        for(const auto& ritr : _records)
+        {
+            if(ritr.kind == begin_kind)
+            {
+                const auto* _name = get_region_name(ritr.region);
+                _stack.emplace_back(_name);
+                tracing::push_perfetto_track(category::host{}, _name, _track,
+                                             ritr.timestamp);
+            }
+            else if(!_stack.empty())
+            {
+                tracing::pop_perfetto_track(category::host{}, _stack.back(), _track,
+                                            ritr.timestamp);
+                _stack.pop_back();
+            }
+        }
+
+        // regions which are still open are closed at the end of the thread
+        auto _end = _records.back().timestamp;
+        if(_thread_info->get_stop() > _end) _end = _thread_info->get_stop();
+        while(!_stack.empty())
+        {
+            tracing::pop_perfetto_track(category::host{}, _stack.back(), _track, _end);
+            _stack.pop_back();
+        }
+    }
+}
+}  // namespace event_log
+}  // namespace omnitrace
@@ -0,0 +1,60 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "core/defines.hpp"
+
+#include <timemory/hash/types.hpp>
+
+namespace omnitrace
+{
+namespace event_log
+{
+/// returns true when OMNITRACE_TRACE_BACKEND=event-log and the log is set up
+inline bool&
+is_enabled()
+{
+    static bool _v = false;
+    return _v;
+}
+
+/// configure the event log from the OMNITRACE_TRACE_BACKEND and
+/// OMNITRACE_EVENT_LOG_BUFFER_SIZE settings
+void
+setup();
+
+/// append a begin record for the host region on the calling thread
+void
+push(tim::hash_value_t) OMNITRACE_HOT;
+
+/// append an end record on the calling thread. The record closes the region of the
+/// last begin record which has not been closed
+void
+pop() OMNITRACE_HOT;
+
+/// convert the records of every thread into perfetto slices
+void
+post_process();
+}  // namespace event_log
+}  // namespace omnitrace
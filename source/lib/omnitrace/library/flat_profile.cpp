@@ -0,0 +1,355 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/flat_profile.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/output.hpp"
+#include "core/timemory.hpp"
+#include "library/thread_data.hpp"
+#include "library/tracing.hpp"
+
+#include <timemory/hash/types.hpp>
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omnitrace
+{
+namespace flat_profile
+{
+namespace
+{
+constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+bool record_edges = false;
+
+struct frame
+{
+    uint32_t index = invalid_index;
+    uint64_t start = 0;
+    uint64_t child = 0;  // inclusive time of the child regions
+};
+
+struct edge
+{
+    uint64_t count     = 0;
+    uint64_t inclusive = 0;
+};
+
+// per-thread flat profile. The region hash is mapped to a dense index via an
+// open-addressing table and the metrics are stored in parallel arrays indexed
+// by the dense index. The lock is only contended when the profile is merged at
+// finalization while the thread is still pushing or popping regions
+struct thread_profile
+{
+    uint32_t find_or_insert(tim::hash_value_t);
+    void     rehash(size_t);
+    void     close(uint64_t);
+
+    // open-addressing table mapping the region hash to the dense index.
+    // The size is always a power of two
+    std::vector<uint32_t> slots = std::vector<uint32_t>(1024, invalid_index);
+
+    std::vector<tim::hash_value_t>     hash      = {};
+    std::vector<uint64_t>              count     = {};
+    std::vector<uint64_t>              inclusive = {};
+    std::vector<uint64_t>              exclusive = {};
+    std::vector<uint32_t>              depth     = {};
+    std::vector<frame>                 stack     = {};
+    std::unordered_map<uint64_t, edge> edges     = {};
+    locking::atomic_mutex              mutex     = {};
+};
+
+using thread_profile_data_t = thread_data<thread_profile, thread_profile>;
+
+uint32_t
+thread_profile::find_or_insert(tim::hash_value_t _hash)
+{
+    auto _mask = slots.size() - 1;
+    for(auto i = (_hash & _mask);; i = (i + 1) & _mask)
+    {
+        auto _idx = slots[i];
+        if(OMNITRACE_LIKELY(_idx != invalid_index && hash[_idx] == _hash)) return _idx;
+        if(_idx == invalid_index)
+        {
+            _idx     = hash.size();
+            slots[i] = _idx;
+            hash.emplace_back(_hash);
+            count.emplace_back(0);
+            inclusive.emplace_back(0);
+            exclusive.emplace_back(0);
+            depth.emplace_back(0);
+            // keep the load factor below 0.5
+            if(2 * hash.size() > slots.size()) rehash(2 * slots.size());
+            return _idx;
+        }
+    }
+}
+
+void
+thread_profile::rehash(size_t _n)
+{
+    slots.assign(_n, invalid_index);
+    auto _mask = slots.size() - 1;
+    for(uint32_t j = 0; j < hash.size(); ++j)
+    {
+        auto i = (hash[j] & _mask);
+        while(slots[i] != invalid_index)
+            i = (i + 1) & _mask;
+        slots[i] = j;
+    }
+}
+
+// pops the last frame off the stack and accumulates the metrics of the region.
+// Inclusive time is only accumulated by the outermost instance of a recursive
+// region so that the time is not double-counted.
+void
+thread_profile::close(uint64_t _end)
+{
+    auto _frame = stack.back();
+    stack.pop_back();
+
+    auto _idx  = _frame.index;
+    auto _incl = (_end > _frame.start) ? (_end - _frame.start) : 0;
+
+    count[_idx] += 1;
+    exclusive[_idx] += _incl - std::min(_frame.child, _incl);
+    if(--depth[_idx] == 0) inclusive[_idx] += _incl;
+
+    if(!stack.empty())
+    {
+        stack.back().child += _incl;
+        if(record_edges)
+        {
+            auto& _edge = edges[(static_cast<uint64_t>(stack.back().index) << 32) | _idx];
+            _edge.count += 1;
+            _edge.inclusive += _incl;
+        }
+    }
+}
+
+thread_profile*
+get_thread_profile()
+{
+    static thread_local auto* _v =
+        thread_profile_data_t::instance(construct_on_thread{}).get();
+    return _v;
+}
+
+struct region_entry
+{
+    std::string name      = {};
+    uint64_t    count     = 0;
+    uint64_t    inclusive = 0;
+    uint64_t    exclusive = 0;
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("name", name), cereal::make_nvp("count", count),
+           cereal::make_nvp("inclusive_ns", inclusive),
+           cereal::make_nvp("exclusive_ns", exclusive));
+    }
+};
+
+struct edge_entry
+{
+    std::string caller    = {};
+    std::string callee    = {};
+    uint64_t    count     = 0;
+    uint64_t    inclusive = 0;
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("caller", caller), cereal::make_nvp("callee", callee),
+           cereal::make_nvp("count", count), cereal::make_nvp("inclusive_ns", inclusive));
+    }
+};
+
+std::string
+get_region_name(tim::hash_value_t _hash)
+{
+    auto _name = tim::get_hash_identifier(_hash);
+    return (_name.empty()) ? JOIN("", "0x", std::hex, _hash) : _name;
+}
+}  // namespace
+
+void
+setup()
+{
+    is_enabled() = (config::get_profile_backend() == "flat");
+    record_edges = is_enabled() && config::get_profile_flat_edges();
+    if(is_enabled()) thread_profile_data_t::instance(construct_on_thread{});
+}
+
+void
+push(tim::hash_value_t _hash)
+{
+    auto* _data = get_thread_profile();
+    auto  _lk   = locking::atomic_lock{ _data->mutex };
+    auto  _idx  = _data->find_or_insert(_hash);
+    _data->depth[_idx] += 1;
+    _data->stack.emplace_back(frame{ _idx, tracing::now(), 0 });
+}
+
+void
+pop()
+{
+    auto  _end  = tracing::now();
+    auto* _data = get_thread_profile();
+    auto  _lk   = locking::atomic_lock{ _data->mutex };
+
+    // the stack is empty when the open regions were closed at finalization
+    if(!_data->stack.empty()) _data->close(_end);
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    auto* _data = thread_profile_data_t::get();
+    if(!_data) return;
+
+    auto _regions = std::unordered_map<tim::hash_value_t, region_entry>{};
+    auto _edges   = std::map<std::pair<tim::hash_value_t, tim::hash_value_t>, edge>{};
+    auto _end     = tracing::now();
+    for(auto& itr : *_data)
+    {
+        if(!itr) continue;
+
+        auto _lk = locking::atomic_lock{ itr->mutex };
+
+        // regions which are still open are closed at the time of finalization
+        while(!itr->stack.empty())
+            itr->close(_end);
+
+        for(size_t i = 0; i < itr->hash.size(); ++i)
+        {
+            auto& _entry = _regions[itr->hash[i]];
+            _entry.count += itr->count[i];
+            _entry.inclusive += itr->inclusive[i];
+            _entry.exclusive += itr->exclusive[i];
+        }
+
+        for(const auto& eitr : itr->edges)
+        {
+            auto  _caller = itr->hash[eitr.first >> 32];
+            auto  _callee = itr->hash[eitr.first & 0xffffffff];
+            auto& _edge   = _edges[{ _caller, _callee }];
+            _edge.count += eitr.second.count;
+            _edge.inclusive += eitr.second.inclusive;
+        }
+    }
+
+    auto _profile = std::vector<region_entry>{};
+    _profile.reserve(_regions.size());
+    for(auto& itr : _regions)
+    {
+        itr.second.name = get_region_name(itr.first);
+        _profile.emplace_back(std::move(itr.second));
+    }
+
+    std::sort(_profile.begin(), _profile.end(), [](const auto& _lhs, const auto& _rhs) {
+        return _lhs.exclusive > _rhs.exclusive;
+    });
+
+    auto _call_graph = std::vector<edge_entry>{};
+    _call_graph.reserve(_edges.size());
+    for(const auto& itr : _edges)
+    {
+        _call_graph.emplace_back(edge_entry{ get_region_name(itr.first.first),
+                                             get_region_name(itr.first.second),
+                                             itr.second.count, itr.second.inclusive });
+    }
+
+    std::sort(_call_graph.begin(), _call_graph.end(),
+              [](const auto& _lhs, const auto& _rhs) {
+                  return _lhs.inclusive > _rhs.inclusive;
+              });
+
+    OMNITRACE_VERBOSE(1, "flat profile :: %zu regions, %zu edges\n", _profile.size(),
+                      _call_graph.size());
+
+    if(_profile.empty()) return;
+
+    output::write_text_and_json(
+        "flat-profile",
+        [&](std::ostream& ofs) {
+            auto _sec = [](uint64_t _v) { return static_cast<double>(_v) / units::sec; };
+
+            ofs << std::setw(12) << "COUNT"
+                << "  " << std::setw(16) << "INCLUSIVE (sec)"
+                << "  " << std::setw(16) << "EXCLUSIVE (sec)"
+                << "  " << std::setw(16) << "MEAN (sec)"
+                << "  "
+                << "NAME\n";
+            ofs << std::fixed << std::setprecision(6);
+            for(const auto& itr : _profile)
+            {
+                ofs << std::setw(12) << itr.count << "  " << std::setw(16)
+                    << _sec(itr.inclusive) << "  " << std::setw(16)
+                    << _sec(itr.exclusive) << "  " << std::setw(16)
+                    << (_sec(itr.inclusive) / std::max<uint64_t>(itr.count, 1)) << "  "
+                    << itr.name << "\n";
+            }
+
+            if(!_call_graph.empty())
+            {
+                ofs << "\n"
+                    << std::setw(12) << "COUNT"
+                    << "  " << std::setw(16) << "INCLUSIVE (sec)"
+                    << "  "
+                    << "CALLER -> CALLEE\n";
+                for(const auto& itr : _call_graph)
+                {
+                    ofs << std::setw(12) << itr.count << "  " << std::setw(16)
+                        << _sec(itr.inclusive) << "  " << itr.caller << " -> "
+                        << itr.callee << "\n";
+                }
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar.setNextName("flat_profile");
+            ar.startNode();
+            ar(cereal::make_nvp("regions", _profile));
+            if(record_edges) ar(cereal::make_nvp("edges", _call_graph));
+            ar.finishNode();
+        });
+}
+}  // namespace flat_profile
+}  // namespace omnitrace
@@ -0,0 +1,422 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/heap_profiler.hpp"
+#include "binary/analysis.hpp"
+#include "core/common.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/output.hpp"
+#include "core/state.hpp"
+#include "core/timestamp.hpp"
+#include "library/components/allocation_gotcha.hpp"
+
+#include <timemory/backends/threading.hpp>
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+#include <timemory/utility/backtrace.hpp>
+#include <timemory/utility/demangle.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace omnitrace
+{
+namespace heap_profiler
+{
+namespace
+{
+constexpr size_t    stack_depth   = 16;
+constexpr size_t    ignore_depth  = 3;
+constexpr size_t    live_bits     = 16;
+constexpr size_t    live_capacity = (1 << live_bits);
+constexpr size_t    live_probes   = 32;
+constexpr uintptr_t tombstone     = 1;
+
+struct allocation
+{
+    size_t                             size    = 0;
+    double                             weight  = 0;  // allocations represented
+    uint64_t                           latency = 0;
+    std::array<uintptr_t, stack_depth> stack   = {};
+};
+
+// entry of the lock-free table of the sampled allocations which have not been
+// released. The table is only searched when it is not empty
+struct live_entry
+{
+    std::atomic<uintptr_t> address = { 0 };
+    size_t                 index   = 0;
+};
+
+struct site_entry
+{
+    std::string name     = {};
+    uint64_t    samples  = 0;
+    double      count    = 0;  // estimated allocations
+    double      bytes    = 0;  // estimated bytes allocated
+    double      live     = 0;  // estimated bytes which were not released
+    uint64_t    latency  = 0;
+    double      duration = 0;  // seconds
+
+    double get_rate(double _v) const { return (duration > 0) ? (_v / duration) : 0.0; }
+
+    double get_mean_latency() const
+    {
+        return (samples > 0) ? latency / static_cast<double>(samples) : 0.0;
+    }
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("name", name), cereal::make_nvp("samples", samples),
+           cereal::make_nvp("allocations", count), cereal::make_nvp("bytes", bytes),
+           cereal::make_nvp("allocations_per_sec", get_rate(count)),
+           cereal::make_nvp("bytes_per_sec", get_rate(bytes)),
+           cereal::make_nvp("live_bytes", live),
+           cereal::make_nvp("mean_latency_nsec", get_mean_latency()));
+    }
+};
+
+auto&
+get_allocation_mutex()
+{
+    static auto _v = locking::atomic_mutex{};
+    return _v;
+}
+
+auto&
+get_allocations()
+{
+    static auto* _v = new std::vector<allocation>{};
+    return *_v;
+}
+
+auto&
+get_live_count()
+{
+    static auto _v = std::atomic<int64_t>{ 0 };
+    return _v;
+}
+
+auto&
+get_live_table()
+{
+    static auto* _v = new std::array<live_entry, live_capacity>{};
+    return *_v;
+}
+
+// sampled allocations which did not fit in the live table so their release is not
+// tracked and they are never counted as live
+auto&
+get_untracked()
+{
+    static auto _v = std::atomic<uint64_t>{ 0 };
+    return _v;
+}
+
+uint64_t&
+get_start_time()
+{
+    static uint64_t _v = 0;
+    return _v;
+}
+
+size_t
+get_live_slot(uintptr_t _addr)
+{
+    return ((_addr >> 4) * 0x9E3779B97F4A7C15ULL) >> (64 - live_bits);
+}
+
+// xorshift64* generator per thread, the draws only happen for sampled allocations
+double
+get_uniform()
+{
+    static thread_local uint64_t _state =
+        timestamp::now() ^ (static_cast<uint64_t>(threading::get_id() + 1) << 32);
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    auto _v = ((_state * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+    return (_v > 0.0) ? _v : 0x1.0p-53;
+}
+
+double
+get_interval()
+{
+    static auto _v =
+        static_cast<double>(std::max<size_t>(config::get_heap_profile_interval(), 1));
+    return _v;
+}
+
+// the allocation site is the first frame outside of omnitrace and the C/C++ runtime
+// libraries, e.g. the caller of operator new instead of operator new
+std::string
+get_allocation_site(const allocation& _v)
+{
+    static auto _cache = std::unordered_map<uintptr_t, std::string>{};
+
+    for(auto itr : _v.stack)
+    {
+        if(itr == 0) break;
+        auto citr = _cache.find(itr);
+        if(citr == _cache.end())
+        {
+            auto _entry = binary::lookup_ipaddr_entry<true>(itr);
+            auto _name  = std::string{};
+            if(_entry)
+            {
+                auto _location = std::string_view{ _entry->location };
+                if(_location.find("libc.so") == std::string_view::npos &&
+                   _location.find("libc-") == std::string_view::npos &&
+                   _location.find("libstdc++") == std::string_view::npos)
+                    _name = tim::demangle(_entry->name);
+            }
+            citr = _cache.emplace(itr, _name).first;
+        }
+        if(!citr->second.empty()) return citr->second;
+    }
+    return std::string{ "unknown" };
+}
+
+void
+write_report(const std::string& _label, const std::vector<site_entry>& _sites)
+{
+    output::write_text_and_json(
+        _label,
+        [&](std::ostream& ofs) {
+            ofs << std::setw(10) << "SAMPLES"
+                << "  " << std::setw(14) << "ALLOCATIONS"
+                << "  " << std::setw(14) << "BYTES"
+                << "  " << std::setw(14) << "BYTES/SEC"
+                << "  " << std::setw(14) << "LIVE BYTES"
+                << "  " << std::setw(14) << "LATENCY (ns)"
+                << "  "
+                << "ALLOCATION SITE\n";
+            ofs << std::fixed << std::setprecision(0);
+            for(const auto& itr : _sites)
+            {
+                ofs << std::setw(10) << itr.samples << "  " << std::setw(14) << itr.count
+                    << "  " << std::setw(14) << itr.bytes << "  " << std::setw(14)
+                    << itr.get_rate(itr.bytes) << "  " << std::setw(14) << itr.live
+                    << "  " << std::setw(14) << itr.get_mean_latency() << "  "
+                    << itr.name << "\n";
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("interval", config::get_heap_profile_interval()),
+               cereal::make_nvp("allocation_sites", _sites));
+        });
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return config::get_use_heap_profile();
+}
+
+void
+setup()
+{
+    if(!is_enabled()) return;
+
+    // construct these before the allocation functions are wrapped
+    get_live_table();
+    get_allocations().reserve(4096);
+    get_start_time() = timestamp::now();
+
+    component::allocation_gotcha::setup();
+}
+
+void
+shutdown()
+{
+    component::allocation_gotcha::shutdown();
+}
+
+bool
+resample(int64_t& _remaining)
+{
+    static bool _enabled = is_enabled();
+    if(!_enabled)
+    {
+        _remaining = std::numeric_limits<int64_t>::max();
+        return false;
+    }
+
+    // the first exhaustion of the counter on a thread is the initialization
+    static thread_local bool _initialized = false;
+    auto                     _sampled     = _initialized;
+    _initialized                          = true;
+
+    _remaining = static_cast<int64_t>(-std::log(get_uniform()) * get_interval());
+    return _sampled;
+}
+
+void
+record(void* _ptr, size_t _size, uint64_t _latency)
+{
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    // an allocation of N bytes is sampled with probability 1 - exp(-N / interval)
+    auto _prob = 1.0 - std::exp(-static_cast<double>(std::max<size_t>(_size, 1)) /
+                                get_interval());
+    auto _v    = allocation{};
+    _v.size    = _size;
+    _v.weight  = 1.0 / _prob;
+    _v.latency = _latency;
+
+    auto _backtrace = tim::get_unw_stack<stack_depth, ignore_depth, false>();
+    for(size_t i = 0; i < _backtrace.size(); ++i)
+    {
+        if(_backtrace.at(i)) _v.stack.at(i) = _backtrace.at(i)->address();
+    }
+
+    size_t _index = 0;
+    {
+        auto _lk = locking::atomic_lock{ get_allocation_mutex() };
+        _index   = get_allocations().size();
+        get_allocations().emplace_back(_v);
+    }
+
+    auto  _addr  = reinterpret_cast<uintptr_t>(_ptr);
+    auto& _table = get_live_table();
+    auto  _slot  = get_live_slot(_addr);
+    for(size_t i = 0; i < live_probes; ++i)
+    {
+        auto& itr  = _table.at((_slot + i) % live_capacity);
+        auto  _cur = itr.address.load(std::memory_order_relaxed);
+        if((_cur == 0 || _cur == tombstone) &&
+           itr.address.compare_exchange_strong(_cur, _addr))
+        {
+            itr.index = _index;
+            get_live_count().fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    // the allocation is still reported but its release cannot be tracked
+    get_untracked().fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+release(void* _ptr)
+{
+    if(_ptr == nullptr || get_live_count().load(std::memory_order_relaxed) == 0) return;
+
+    auto  _addr  = reinterpret_cast<uintptr_t>(_ptr);
+    auto& _table = get_live_table();
+    auto  _slot  = get_live_slot(_addr);
+    for(size_t i = 0; i < live_probes; ++i)
+    {
+        auto& itr  = _table.at((_slot + i) % live_capacity);
+        auto  _cur = itr.address.load(std::memory_order_relaxed);
+        if(_cur == 0) return;
+        if(_cur == _addr && itr.address.compare_exchange_strong(_cur, tombstone))
+        {
+            get_live_count().fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    auto _allocations = std::vector<allocation>{};
+    {
+        auto _lk     = locking::atomic_lock{ get_allocation_mutex() };
+        _allocations = get_allocations();
+    }
+
+    auto _is_live = std::vector<bool>(_allocations.size(), false);
+    for(const auto& itr : get_live_table())
+    {
+        auto _addr = itr.address.load(std::memory_order_relaxed);
+        if(_addr > tombstone && itr.index < _is_live.size())
+            _is_live.at(itr.index) = true;
+    }
+
+    auto _duration =
+        static_cast<double>(timestamp::now() - get_start_time()) / units::sec;
+    auto _sites = std::map<std::string, site_entry>{};
+    auto _total = site_entry{ "total" };
+
+    for(size_t i = 0; i < _allocations.size(); ++i)
+    {
+        const auto& itr    = _allocations.at(i);
+        auto        _bytes = itr.weight * itr.size;
+
+        auto _update = [&](site_entry& _v) {
+            _v.samples += 1;
+            _v.count += itr.weight;
+            _v.bytes += _bytes;
+            _v.live += (_is_live.at(i)) ? _bytes : 0.0;
+            _v.latency += itr.latency;
+            _v.duration = _duration;
+        };
+
+        _update(_total);
+
+        auto _site = get_allocation_site(itr);
+        auto sitr  = _sites.emplace(_site, site_entry{ _site }).first;
+        _update(sitr->second);
+    }
+
+    OMNITRACE_VERBOSE(1,
+                      "heap profile :: %zu sampled allocations :: %.3f MB allocated :: "
+                      "%.3f MB live at exit :: %zu sampled allocations untracked\n",
+                      static_cast<size_t>(_total.samples), _total.bytes / units::megabyte,
+                      _total.live / units::megabyte,
+                      static_cast<size_t>(get_untracked().load()));
+
+    if(_total.samples == 0) return;
+
+    auto _sorted = std::vector<site_entry>{};
+    _sorted.reserve(_sites.size());
+    for(const auto& itr : _sites)
+        _sorted.emplace_back(itr.second);
+    std::sort(_sorted.begin(), _sorted.end(),
+              [](const auto& _lhs, const auto& _rhs) { return _lhs.bytes > _rhs.bytes; });
+
+    write_report("heap-profile", _sorted);
+}
+}  // namespace heap_profiler
+}  // namespace omnitrace
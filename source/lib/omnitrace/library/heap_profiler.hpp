@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common/defines.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace omnitrace
+{
+namespace heap_profiler
+{
+/// returns true when OMNITRACE_HEAP_PROFILE is enabled
+bool
+is_enabled();
+
+/// starts wrapping the allocation functions
+void
+setup();
+
+void
+shutdown();
+
+/// draws the number of bytes until the next sampled allocation on the calling thread.
+/// Returns false when the allocation which exhausted the interval should not be
+/// sampled, e.g. the first allocation on a thread or when the profiler is disabled
+bool
+resample(int64_t& _remaining);
+
+/// the byte interval between samples is exponentially distributed so the allocations
+/// are sampled with a probability proportional to their size. Every malloc and free
+/// still passes through the allocation gotcha wrappers (and their component bundle);
+/// this decides, with a decrement of a thread-local counter, whether the call-stack
+/// of the allocation is recorded
+OMNITRACE_INLINE bool
+sample(size_t _size)
+{
+    static thread_local int64_t _remaining = 0;
+    _remaining -= static_cast<int64_t>(_size);
+    return OMNITRACE_UNLIKELY(_remaining < 0) && resample(_remaining);
+}
+
+/// records the call-stack of a sampled allocation and tracks it until it is released
+void
+record(void* ptr, size_t size, uint64_t latency);
+
+/// stops tracking the address if it belongs to a sampled allocation
+void
+release(void* ptr);
+
+/// writes the estimated allocations, bytes, and live heap per allocation site
+void
+post_process();
+}  // namespace heap_profiler
+}  // namespace omnitrace
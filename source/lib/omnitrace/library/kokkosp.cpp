@@ -39,9 +39,14 @@
 #include <timemory/utility/procfs/maps.hpp>
 #include <timemory/utility/types.hpp>
 
+#include <cstdint>
 #include <cstdlib>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace kokkosp  = ::tim::kokkosp;
 namespace category = ::tim::category;
@@ -127,6 +132,154 @@ strlength(Tp&& _v)
         return strnlen(_v, std::max<size_t>(_name_len_limit, 1));
 }
 
+// kind of callback. Used for the label suffix and as part of the label cache key
+enum class label_kind : uint8_t
+{
+    parallel_for = 0,
+    parallel_reduce,
+    parallel_scan,
+    fence,
+    allocate,
+    deallocate,
+};
+
+const char*
+get_label_suffix(label_kind _kind)
+{
+    switch(_kind)
+    {
+        case label_kind::parallel_for: return "for";
+        case label_kind::parallel_reduce: return "reduce";
+        case label_kind::parallel_scan: return "scan";
+        case label_kind::fence: return "fence";
+        case label_kind::allocate: return "allocate";
+        case label_kind::deallocate: return "deallocate";
+    }
+    return "unknown";
+}
+
+inline uint64_t
+combine_hash(uint64_t _lhs, uint64_t _rhs)
+{
+    return _lhs ^ (_rhs + 0x9e3779b97f4a7c15ULL + (_lhs << 6) + (_lhs >> 2));
+}
+
+// maps (name, device/space, kind) to the hash of the full label. The label is only
+// constructed the first time a combination is seen on a thread so that kernel
+// launches and allocations in the steady state do not do any string manipulation.
+auto&
+get_label_cache()
+{
+    static thread_local auto _v = std::unordered_map<uint64_t, tim::hash_value_t>{};
+    return _v;
+}
+
+tim::hash_value_t
+get_kernel_label(label_kind _kind, const char* _name, uint32_t _devid)
+{
+    constexpr auto invalid_devid = std::numeric_limits<uint32_t>::max();
+
+    // junk device number
+    if(_devid > std::numeric_limits<uint16_t>::max()) _devid = invalid_devid;
+
+    auto& _cache = get_label_cache();
+    auto  _key   = combine_hash(tim::get_hash_id(std::string_view{ _name }),
+                             (static_cast<uint64_t>(_devid) << 8) |
+                                 static_cast<uint64_t>(_kind));
+    auto  itr    = _cache.find(_key);
+    if(OMNITRACE_LIKELY(itr != _cache.end())) return itr->second;
+
+    auto _suffix = get_label_suffix(_kind);
+    auto _label  = (_devid == invalid_devid)
+                       ? JOIN(" ", _kp_prefix, _name, JOIN("", '[', _suffix, ']'))
+                       : JOIN(" ", _kp_prefix, _name,
+                              JOIN("", '[', _suffix, "][dev", _devid, ']'));
+    return _cache.emplace(_key, tim::add_hash_id(_label)).first->second;
+}
+
+tim::hash_value_t
+get_space_label(label_kind _kind, const char* _name, const char* _space)
+{
+    auto& _cache = get_label_cache();
+    auto  _key   = combine_hash(tim::get_hash_id(std::string_view{ _name }),
+                             combine_hash(tim::get_hash_id(std::string_view{ _space }),
+                                          static_cast<uint64_t>(_kind)));
+    auto  itr    = _cache.find(_key);
+    if(OMNITRACE_LIKELY(itr != _cache.end())) return itr->second;
+
+    auto _label = JOIN(" ", _kp_prefix, _name,
+                       JOIN("", '[', _space, "][", get_label_suffix(_kind), ']'));
+    return _cache.emplace(_key, tim::add_hash_id(_label)).first->second;
+}
+
+// dense table of the active kernel profilers on a thread. The kernel id handed back
+// to Kokkos is the index into the table and the indices of completed kernels are
+// recycled so the table only grows to the max number of concurrent kernels.
+struct profiler_table
+{
+    using profiler_type = kokkosp::profiler_t<kokkosp_region>;
+
+    static profiler_table& instance()
+    {
+        static thread_local auto _v = profiler_table{};
+        return _v;
+    }
+
+    uint64_t create(tim::hash_value_t _hash)
+    {
+        uint64_t _idx = m_data.size();
+        if(!m_free.empty())
+        {
+            _idx = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            m_data.emplace_back();
+        }
+        m_data.at(_idx).emplace(_hash);
+        return _idx;
+    }
+
+    profiler_type* get(uint64_t _idx)
+    {
+        if(_idx >= m_data.size() || !m_data[_idx]) return nullptr;
+        return &m_data[_idx].value();
+    }
+
+    void destroy(uint64_t _idx)
+    {
+        if(_idx >= m_data.size() || !m_data[_idx]) return;
+        m_data[_idx].reset();
+        m_free.emplace_back(_idx);
+    }
+
+private:
+    std::vector<std::optional<profiler_type>> m_data = {};
+    std::vector<uint64_t>                     m_free = {};
+};
+
+void
+begin_kernel(label_kind _kind, const char* _func, const char* _name, uint32_t _devid,
+             uint64_t* _kernid)
+{
+    auto& _table = profiler_table::instance();
+    *_kernid     = _table.create(get_kernel_label(_kind, _name, _devid));
+    kokkosp::logger_t{}.mark(1, _func, _name, *_kernid);
+    _table.get(*_kernid)->start();
+}
+
+void
+end_kernel(const char* _func, uint64_t _kernid)
+{
+    auto& _table = profiler_table::instance();
+    kokkosp::logger_t{}.mark(-1, _func, _kernid);
+    auto* _profiler = _table.get(_kernid);
+    if(!_profiler) return;
+    _profiler->stop();
+    _table.destroy(_kernid);
+}
+
 template <typename Arg, typename... Args>
 bool
 violates_name_rules(Arg&& _arg, Args&&... _args)
@@ -305,13 +458,7 @@ extern "C"
         if(violates_name_rules(name)) return set_invalid_id(kernid);
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        auto pname = (devid > std::numeric_limits<uint16_t>::max())  // junk device number
-                         ? JOIN(" ", _kp_prefix, name, "[for]")
-                         : JOIN(" ", _kp_prefix, name, JOIN("", "[for][dev", devid, ']'));
-        *kernid    = kokkosp::get_unique_id();
-        kokkosp::logger_t{}.mark(1, __FUNCTION__, name, *kernid);
-        kokkosp::create_profiler<kokkosp_region>(pname, *kernid);
-        kokkosp::start_profiler<kokkosp_region>(*kernid);
+        begin_kernel(label_kind::parallel_for, __FUNCTION__, name, devid, kernid);
     }
 
     void kokkosp_end_parallel_for(uint64_t kernid)
@@ -319,9 +466,7 @@ extern "C"
         if(is_invalid_id(kernid)) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(-1, __FUNCTION__, kernid);
-        kokkosp::stop_profiler<kokkosp_region>(kernid);
-        kokkosp::destroy_profiler<kokkosp_region>(kernid);
+        end_kernel(__FUNCTION__, kernid);
     }
 
     //----------------------------------------------------------------------------------//
@@ -331,14 +476,7 @@ extern "C"
         if(violates_name_rules(name)) return set_invalid_id(kernid);
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        auto pname =
-            (devid > std::numeric_limits<uint16_t>::max())  // junk device number
-                ? JOIN(" ", _kp_prefix, name, "[reduce]")
-                : JOIN(" ", _kp_prefix, name, JOIN("", "[reduce][dev", devid, ']'));
-        *kernid = kokkosp::get_unique_id();
-        kokkosp::logger_t{}.mark(1, __FUNCTION__, name, *kernid);
-        kokkosp::create_profiler<kokkosp_region>(pname, *kernid);
-        kokkosp::start_profiler<kokkosp_region>(*kernid);
+        begin_kernel(label_kind::parallel_reduce, __FUNCTION__, name, devid, kernid);
     }
 
     void kokkosp_end_parallel_reduce(uint64_t kernid)
@@ -346,9 +484,7 @@ extern "C"
         if(is_invalid_id(kernid)) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(-1, __FUNCTION__, kernid);
-        kokkosp::stop_profiler<kokkosp_region>(kernid);
-        kokkosp::destroy_profiler<kokkosp_region>(kernid);
+        end_kernel(__FUNCTION__, kernid);
     }
 
     //----------------------------------------------------------------------------------//
@@ -358,14 +494,7 @@ extern "C"
         if(violates_name_rules(name)) return set_invalid_id(kernid);
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        auto pname =
-            (devid > std::numeric_limits<uint16_t>::max())  // junk device number
-                ? JOIN(" ", _kp_prefix, name, "[scan]")
-                : JOIN(" ", _kp_prefix, name, JOIN("", "[scan][dev", devid, ']'));
-        *kernid = kokkosp::get_unique_id();
-        kokkosp::logger_t{}.mark(1, __FUNCTION__, name, *kernid);
-        kokkosp::create_profiler<kokkosp_region>(pname, *kernid);
-        kokkosp::start_profiler<kokkosp_region>(*kernid);
+        begin_kernel(label_kind::parallel_scan, __FUNCTION__, name, devid, kernid);
     }
 
     void kokkosp_end_parallel_scan(uint64_t kernid)
@@ -373,9 +502,7 @@ extern "C"
         if(is_invalid_id(kernid)) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(-1, __FUNCTION__, kernid);
-        kokkosp::stop_profiler<kokkosp_region>(kernid);
-        kokkosp::destroy_profiler<kokkosp_region>(kernid);
+        end_kernel(__FUNCTION__, kernid);
     }
 
     //----------------------------------------------------------------------------------//
@@ -385,14 +512,7 @@ extern "C"
         if(violates_name_rules(name)) return set_invalid_id(kernid);
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        auto pname =
-            (devid > std::numeric_limits<uint16_t>::max())  // junk device number
-                ? JOIN(" ", _kp_prefix, name, "[fence]")
-                : JOIN(" ", _kp_prefix, name, JOIN("", "[fence][dev", devid, ']'));
-        *kernid = kokkosp::get_unique_id();
-        kokkosp::logger_t{}.mark(1, __FUNCTION__, name, *kernid);
-        kokkosp::create_profiler<kokkosp_region>(pname, *kernid);
-        kokkosp::start_profiler<kokkosp_region>(*kernid);
+        begin_kernel(label_kind::fence, __FUNCTION__, name, devid, kernid);
     }
 
     void kokkosp_end_fence(uint64_t kernid)
@@ -400,9 +520,7 @@ extern "C"
         if(is_invalid_id(kernid)) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(-1, __FUNCTION__, kernid);
-        kokkosp::stop_profiler<kokkosp_region>(kernid);
-        kokkosp::destroy_profiler<kokkosp_region>(kernid);
+        end_kernel(__FUNCTION__, kernid);
     }
 
     //----------------------------------------------------------------------------------//
@@ -466,12 +584,10 @@ extern "C"
         if(omnitrace::config::get_use_causal()) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(0, __FUNCTION__, space.name, label,
-                                 JOIN("", '[', ptr, ']'), size);
-        auto pname =
-            JOIN(" ", _kp_prefix, label, JOIN("", '[', space.name, "][allocate]"));
-        kokkosp::profiler_alloc_t<>{ pname }.store(std::plus<int64_t>{}, size);
-        kokkosp::profiler_t<kokkosp_region>{ pname }.mark();
+        kokkosp::logger_t{}.mark(0, __FUNCTION__, space.name, label, ptr, size);
+        auto _hash = get_space_label(label_kind::allocate, label, space.name);
+        kokkosp::profiler_alloc_t<>{ _hash }.store(std::plus<int64_t>{}, size);
+        kokkosp::profiler_t<kokkosp_region>{ _hash }.mark();
     }
 
     void kokkosp_deallocate_data(const SpaceHandle space, const char* label,
@@ -481,12 +597,10 @@ extern "C"
         if(omnitrace::config::get_use_causal()) return;
 
         OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-        kokkosp::logger_t{}.mark(0, __FUNCTION__, space.name, label,
-                                 JOIN("", '[', ptr, ']'), size);
-        auto pname =
-            JOIN(" ", _kp_prefix, label, JOIN("", '[', space.name, "][deallocate]"));
-        kokkosp::profiler_alloc_t<>{ pname }.store(std::plus<int64_t>{}, size);
-        kokkosp::profiler_t<kokkosp_region>{ pname }.mark();
+        kokkosp::logger_t{}.mark(0, __FUNCTION__, space.name, label, ptr, size);
+        auto _hash = get_space_label(label_kind::deallocate, label, space.name);
+        kokkosp::profiler_alloc_t<>{ _hash }.store(std::plus<int64_t>{}, size);
+        kokkosp::profiler_t<kokkosp_region>{ _hash }.mark();
     }
 
     //----------------------------------------------------------------------------------//
@@ -0,0 +1,409 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/memory_sampling.hpp"
+#include "binary/analysis.hpp"
+#include "common/join.hpp"
+#include "core/common.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/output.hpp"
+#include "core/perf.hpp"
+#include "core/state.hpp"
+#include "library/components/allocation_gotcha.hpp"
+
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+#include <timemory/utility/demangle.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <execinfo.h>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace omnitrace
+{
+namespace memory_sampling
+{
+namespace
+{
+constexpr size_t allocation_depth = 12;
+
+struct allocation
+{
+    uintptr_t                               beg       = 0;
+    uintptr_t                               end       = 0;
+    uint64_t                                timestamp = 0;
+    std::array<uintptr_t, allocation_depth> stack     = {};
+};
+
+struct sample
+{
+    uint64_t timestamp = 0;
+    uint64_t ip        = 0;
+    access   data      = {};
+};
+
+struct locality_entry
+{
+    std::string                 name          = {};
+    uint64_t                    count         = 0;
+    uint64_t                    remote_access = 0;  // served from remote memory/cache
+    uint64_t                    remote_page   = 0;  // page on a node other than the CPU
+    uint64_t                    latency       = 0;
+    std::map<int32_t, uint64_t> nodes         = {};
+
+    double get_ratio(uint64_t _v) const
+    {
+        return (count > 0) ? (100.0 * _v) / static_cast<double>(count) : 0.0;
+    }
+
+    double get_mean_latency() const
+    {
+        return (count > 0) ? latency / static_cast<double>(count) : 0.0;
+    }
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        auto _nodes      = std::map<std::string, uint64_t>{};
+        for(const auto& itr : nodes)
+            _nodes.emplace(std::to_string(itr.first), itr.second);
+
+        ar(cereal::make_nvp("name", name), cereal::make_nvp("samples", count),
+           cereal::make_nvp("remote_access_percent", get_ratio(remote_access)),
+           cereal::make_nvp("remote_page_percent", get_ratio(remote_page)),
+           cereal::make_nvp("mean_latency_cycles", get_mean_latency()),
+           cereal::make_nvp("page_nodes", _nodes));
+    }
+};
+
+auto&
+get_allocation_mutex()
+{
+    static auto _v = locking::atomic_mutex{};
+    return _v;
+}
+
+auto&
+get_allocations()
+{
+    static auto* _v = new std::vector<allocation>{};
+    return *_v;
+}
+
+auto&
+get_samples()
+{
+    static auto _v = std::vector<sample>{};
+    return _v;
+}
+
+bool
+is_remote_access(uint64_t _data_src)
+{
+    constexpr uint64_t remote_levels = PERF_MEM_LVL_REM_RAM1 | PERF_MEM_LVL_REM_RAM2 |
+                                       PERF_MEM_LVL_REM_CCE1 | PERF_MEM_LVL_REM_CCE2;
+
+    if(((_data_src >> PERF_MEM_LVL_SHIFT) & remote_levels) != 0) return true;
+#if defined(PERF_MEM_REMOTE_SHIFT)
+    return ((_data_src >> PERF_MEM_REMOTE_SHIFT) & PERF_MEM_REMOTE_REMOTE) != 0;
+#else
+    return false;
+#endif
+}
+
+std::string
+get_function_name(uintptr_t _ip)
+{
+    static auto _cache = std::unordered_map<uintptr_t, std::string>{};
+
+    auto itr = _cache.find(_ip);
+    if(itr != _cache.end()) return itr->second;
+
+    auto _entry = binary::lookup_ipaddr_entry<true>(_ip);
+    auto _name  = (_entry) ? tim::demangle(_entry->name)
+                           : TIMEMORY_JOIN("", "0x", std::hex, _ip);
+    return _cache.emplace(_ip, _name).first->second;
+}
+
+// the allocation site is the first frame outside of omnitrace and the C/C++ runtime
+// libraries, e.g. the caller of operator new instead of operator new
+std::string
+get_allocation_site(const allocation& _v)
+{
+    for(auto itr : _v.stack)
+    {
+        if(itr == 0) break;
+        auto _entry = binary::lookup_ipaddr_entry<true>(itr);
+        if(!_entry) continue;
+        auto _location = std::string_view{ _entry->location };
+        if(_location.find("libc.so") != std::string_view::npos ||
+           _location.find("libc-") != std::string_view::npos ||
+           _location.find("libstdc++") != std::string_view::npos)
+            continue;
+        return tim::demangle(_entry->name);
+    }
+    return std::string{ "unknown" };
+}
+
+void
+write_report(const std::string& _label, const std::vector<locality_entry>& _functions,
+             const std::vector<locality_entry>& _sites)
+{
+    output::write_text_and_json(
+        _label,
+        [&](std::ostream& ofs) {
+            auto _write = [&ofs](const char* _title, const auto& _data) {
+                ofs << std::setw(10) << "SAMPLES"
+                    << "  " << std::setw(10) << "REMOTE (%)"
+                    << "  " << std::setw(10) << "R-PAGE (%)"
+                    << "  " << std::setw(14) << "LATENCY (cyc)"
+                    << "  " << std::setw(16) << "PAGE NODES"
+                    << "  " << _title << "\n";
+                ofs << std::fixed << std::setprecision(2);
+                for(const auto& itr : _data)
+                {
+                    auto _nodes = std::stringstream{};
+                    for(const auto& nitr : itr.nodes)
+                        _nodes << ((_nodes.tellp() > 0) ? "," : "") << nitr.first << ":"
+                               << nitr.second;
+                    ofs << std::setw(10) << itr.count << "  " << std::setw(10)
+                        << itr.get_ratio(itr.remote_access) << "  " << std::setw(10)
+                        << itr.get_ratio(itr.remote_page) << "  " << std::setw(14)
+                        << itr.get_mean_latency() << "  " << std::setw(16)
+                        << _nodes.str() << "  " << itr.name << "\n";
+                }
+                ofs << "\n";
+            };
+
+            _write("FUNCTION", _functions);
+            _write("ALLOCATION SITE", _sites);
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("functions", _functions),
+               cereal::make_nvp("allocation_sites", _sites));
+        });
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return config::get_use_sampling() && config::get_use_sampling_overflow() &&
+           config::get_use_sampling_memory();
+}
+
+void
+setup()
+{
+    if(!is_enabled()) return;
+    component::allocation_gotcha::setup();
+}
+
+void
+shutdown()
+{
+    component::allocation_gotcha::shutdown();
+}
+
+std::optional<std::string>
+configure(struct perf_event_attr& _pe)
+{
+    auto _event  = config::get_sampling_memory_event();
+    auto _period = static_cast<uint64_t>(config::get_sampling_overflow_freq());
+
+    // only modify the configuration if the precise memory event is supported
+    auto _memory_pe = _pe;
+    if(auto _err = perf::config_memory_sampling(_memory_pe, _event, _period); _err)
+        return _err;
+
+    _memory_pe.sample_type |=
+        PERF_SAMPLE_ADDR | PERF_SAMPLE_WEIGHT | PERF_SAMPLE_DATA_SRC;
+    // the samples are matched with the allocations via the realtime clock
+    _memory_pe.use_clockid = 1;
+    _memory_pe.clockid     = CLOCK_REALTIME;
+    _pe                    = _memory_pe;
+
+    return std::optional<std::string>{};
+}
+
+void
+resolve_nodes(access& _v)
+{
+    // move_pages without target nodes reports the node of each page
+    void* _page   = reinterpret_cast<void*>(_v.address);
+    int   _status = -1;
+    if(syscall(SYS_move_pages, 0, 1, &_page, nullptr, &_status, 0) == 0 && _status >= 0)
+        _v.node = _status;
+
+    unsigned _cpu  = 0;
+    unsigned _node = 0;
+    if(syscall(SYS_getcpu, &_cpu, &_node, nullptr) == 0)
+        _v.cpu_node = static_cast<int32_t>(_node);
+}
+
+void
+record_allocation(uintptr_t _addr, size_t _size)
+{
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    auto  _v     = allocation{};
+    void* _stack[allocation_depth] = {};
+    auto  _depth = ::backtrace(_stack, allocation_depth);
+
+    _v.beg       = _addr;
+    _v.end       = _addr + _size;
+    _v.timestamp = tim::get_clock_real_now<uint64_t, std::nano>();
+    for(int i = 0; i < _depth; ++i)
+        _v.stack.at(i) = reinterpret_cast<uintptr_t>(_stack[i]);
+
+    auto _lk = locking::atomic_lock{ get_allocation_mutex() };
+    get_allocations().emplace_back(_v);
+}
+
+void
+add_sample(uint64_t _timestamp, uint64_t _ip, const access& _v)
+{
+    get_samples().emplace_back(sample{ _timestamp, _ip, _v });
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    auto _allocations = std::vector<allocation>{};
+    {
+        auto _lk     = locking::atomic_lock{ get_allocation_mutex() };
+        _allocations = get_allocations();
+    }
+
+    std::sort(_allocations.begin(), _allocations.end(),
+              [](const auto& _lhs, const auto& _rhs) { return _lhs.beg < _rhs.beg; });
+
+    // the largest end address of the allocations up to each index bounds the search
+    auto      _max_end = std::vector<uintptr_t>{};
+    uintptr_t _end     = 0;
+    for(const auto& itr : _allocations)
+        _max_end.emplace_back(_end = std::max(_end, itr.end));
+
+    // the address belongs to the most recent allocation which contained it at the time
+    // of the sample
+    auto _find_allocation = [&](const sample& _v) -> const allocation* {
+        auto _addr = _v.data.address;
+        auto itr   = std::upper_bound(
+            _allocations.begin(), _allocations.end(), _addr,
+            [](uintptr_t _lhs, const allocation& _rhs) { return _lhs < _rhs.beg; });
+        const allocation* _found = nullptr;
+        for(auto i = std::distance(_allocations.begin(), itr) - 1;
+            i >= 0 && _max_end.at(i) > _addr; --i)
+        {
+            const auto& _alloc = _allocations.at(i);
+            if(_addr < _alloc.end && _alloc.timestamp <= _v.timestamp &&
+               (!_found || _alloc.timestamp > _found->timestamp))
+                _found = &_alloc;
+        }
+        return _found;
+    };
+
+    auto _functions = std::map<std::string, locality_entry>{};
+    auto _sites     = std::map<std::string, locality_entry>{};
+    auto _site_name = std::unordered_map<const allocation*, std::string>{};
+    auto _total     = locality_entry{ "total" };
+
+    for(const auto& itr : get_samples())
+    {
+        auto _remote_access = is_remote_access(itr.data.data_src);
+        auto _remote_page   = (itr.data.node >= 0 && itr.data.cpu_node >= 0 &&
+                             itr.data.node != itr.data.cpu_node);
+
+        auto _update = [&itr, _remote_access, _remote_page](locality_entry& _v) {
+            _v.count += 1;
+            _v.remote_access += (_remote_access) ? 1 : 0;
+            _v.remote_page += (_remote_page) ? 1 : 0;
+            _v.latency += itr.data.weight;
+            _v.nodes[itr.data.node] += 1;
+        };
+
+        _update(_total);
+
+        auto _func = get_function_name(itr.ip);
+        auto fitr  = _functions.emplace(_func, locality_entry{ _func }).first;
+        _update(fitr->second);
+
+        const auto* _alloc = _find_allocation(itr);
+        auto        _site  = std::string{ "unattributed" };
+        if(_alloc)
+        {
+            auto nitr = _site_name.find(_alloc);
+            if(nitr == _site_name.end())
+                nitr = _site_name.emplace(_alloc, get_allocation_site(*_alloc)).first;
+            _site = nitr->second;
+        }
+        auto sitr = _sites.emplace(_site, locality_entry{ _site }).first;
+        _update(sitr->second);
+    }
+
+    OMNITRACE_VERBOSE(1,
+                      "memory sampling :: %zu samples :: %.2f%% remote accesses :: "
+                      "%.2f%% on remote pages :: %zu allocations\n",
+                      static_cast<size_t>(_total.count),
+                      _total.get_ratio(_total.remote_access),
+                      _total.get_ratio(_total.remote_page), _allocations.size());
+
+    if(_total.count == 0) return;
+
+    // order by the number of remote accesses since those are the costly ones
+    auto _sorted = [](const auto& _data) {
+        auto _v = std::vector<locality_entry>{};
+        _v.reserve(_data.size());
+        for(const auto& itr : _data)
+            _v.emplace_back(itr.second);
+        std::sort(_v.begin(), _v.end(), [](const auto& _lhs, const auto& _rhs) {
+            auto _lhs_remote = _lhs.remote_access + _lhs.remote_page;
+            auto _rhs_remote = _rhs.remote_access + _rhs.remote_page;
+            if(_lhs_remote != _rhs_remote) return _lhs_remote > _rhs_remote;
+            return _lhs.count > _rhs.count;
+        });
+        return _v;
+    };
+
+    write_report("memory-locality", _sorted(_functions), _sorted(_sites));
+}
+}  // namespace memory_sampling
+}  // namespace omnitrace
@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+struct perf_event_attr;
+
+namespace omnitrace
+{
+namespace memory_sampling
+{
+/// data of a memory access sampled by the precise memory event
+struct access
+{
+    uint64_t address  = 0;
+    uint64_t weight   = 0;   // latency of the access in cycles
+    uint64_t data_src = 0;   // perf_mem_data_src encoding of where the data was found
+    int32_t  node     = -1;  // NUMA node of the page containing the address
+    int32_t  cpu_node = -1;  // NUMA node of the CPU which performed the access
+};
+
+/// returns true when OMNITRACE_SAMPLING_MEMORY and overflow sampling are enabled
+bool
+is_enabled();
+
+/// starts attributing the allocations of OMNITRACE_SAMPLING_MEMORY_ALLOCATION_SIZE
+/// bytes or more to their call sites
+void
+setup();
+
+void
+shutdown();
+
+/// replaces the overflow sampling event with the precise memory event. Returns an
+/// error message when the hardware does not support it
+std::optional<std::string>
+configure(struct perf_event_attr&);
+
+/// resolves the NUMA nodes of the page and of the CPU. Async-signal-safe
+void
+resolve_nodes(access&);
+
+/// records an allocation which the sampled addresses within [addr, addr + size) are
+/// attributed to
+void
+record_allocation(uintptr_t addr, size_t size);
+
+/// adds a sampled access at the instruction address and (perf) timestamp
+void
+add_sample(uint64_t timestamp, uint64_t ip, const access&);
+
+/// writes the locality of the sampled accesses per function and per allocation site
+void
+post_process();
+}  // namespace memory_sampling
+}  // namespace omnitrace
@@ -0,0 +1,312 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/offcpu.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/state.hpp"
+#include "library/perf.hpp"
+#include "library/runtime.hpp"
+#include "library/thread_info.hpp"
+
+#include <timemory/backends/threading.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <linux/perf_event.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <thread>
+#include <vector>
+
+namespace omnitrace
+{
+namespace offcpu
+{
+namespace
+{
+// number of switch-out samples in the ring buffer before the reader thread is woken
+constexpr uint32_t wakeup_events = 4;
+// maximum time the reader thread waits on the events before checking for new threads
+constexpr int poll_timeout = 100;
+
+struct instance
+{
+    std::unique_ptr<perf::perf_event> event   = {};
+    std::optional<record>             pending = {};
+    std::vector<record>               data    = {};
+    size_t                            lost    = 0;
+};
+
+auto&
+get_instances()
+{
+    static auto* _v = new std::map<int64_t, instance>{};
+    return *_v;
+}
+
+auto&
+get_mutex()
+{
+    static auto _v = std::mutex{};
+    return _v;
+}
+
+auto&
+get_reader_thread()
+{
+    static auto _v = std::unique_ptr<std::thread>{};
+    return _v;
+}
+
+auto&
+get_reader_active()
+{
+    static auto _v = std::atomic<bool>{ false };
+    return _v;
+}
+
+// the switch-out sample holds the user callchain of the thread being switched out and
+// the following switch-in record ends the interval
+void
+read_records(instance& _v)
+{
+    if(!_v.event || !_v.event->is_open()) return;
+
+    for(auto itr : *_v.event)
+    {
+        if(itr.is_sample())
+        {
+            auto _record = record{};
+            _record.beg  = itr.get_time();
+            // the IP is within the scheduler, the callchain holds the user frames
+            for(auto ditr : itr.get_callchain())
+            {
+                if(ditr >= PERF_CONTEXT_MAX) continue;
+                _record.stack.emplace_back(ditr);
+                if(_record.stack.size() == _record.stack.capacity()) break;
+            }
+            _v.pending = std::move(_record);
+        }
+        else if(itr.is_switch() && _v.pending)
+        {
+            if(itr.is_switch_out())
+            {
+                _v.pending->preempted = itr.is_preempted();
+            }
+            else
+            {
+                _v.pending->end = itr.get_switch_time();
+                if(_v.pending->end > _v.pending->beg && !_v.pending->stack.empty())
+                    _v.data.emplace_back(*_v.pending);
+                _v.pending.reset();
+            }
+        }
+        else if(itr.is_lost())
+        {
+            _v.pending.reset();
+            ++_v.lost;
+        }
+    }
+}
+
+void
+read_all()
+{
+    auto _lk = std::unique_lock<std::mutex>{ get_mutex() };
+    for(auto& itr : get_instances())
+        read_records(itr.second);
+}
+
+void
+reader()
+{
+    thread_info::init(true);
+    threading::set_thread_name("omni.offcpu");
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    auto _fds = std::vector<struct pollfd>{};
+    while(get_reader_active().load())
+    {
+        _fds.clear();
+        {
+            auto _lk = std::unique_lock<std::mutex>{ get_mutex() };
+            for(auto& itr : get_instances())
+            {
+                if(itr.second.event && itr.second.event->is_open())
+                    _fds.emplace_back(pollfd{
+                        static_cast<int>(itr.second.event->get_fileno()), POLLIN, 0 });
+            }
+        }
+
+        // sleeps until one of the ring buffers has accumulated enough records
+        if(::poll(_fds.data(), _fds.size(), poll_timeout) > 0) read_all();
+    }
+
+    read_all();
+}
+
+void
+start_reader()
+{
+    if(get_reader_thread()) return;
+
+    OMNITRACE_SCOPED_SAMPLING_ON_CHILD_THREADS(false);
+    get_reader_active().store(true);
+    get_reader_thread() = std::make_unique<std::thread>(&reader);
+}
+
+std::optional<std::string>
+open_event(perf::perf_event& _event, pid_t _tid)
+{
+#if defined(PERF_RECORD_SWITCH) && defined(PERF_RECORD_MISC_SWITCH_OUT)
+    struct perf_event_attr _pe;
+    memset(&_pe, 0, sizeof(_pe));
+
+    // one sample for every switch-out of the thread
+    _pe.type          = PERF_TYPE_SOFTWARE;
+    _pe.config        = PERF_COUNT_SW_CONTEXT_SWITCHES;
+    _pe.sample_period = 1;
+    _pe.sample_type   = PERF_SAMPLE_TIME | PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN;
+    _pe.wakeup_events = wakeup_events;
+    // PERF_RECORD_SWITCH records with the timestamp of the switch-in
+    _pe.context_switch = 1;
+    _pe.sample_id_all  = 1;
+    // the context switch happens in the kernel so the kernel cannot be excluded from
+    // the event but the kernel frames are excluded from the callchain
+    _pe.exclude_kernel           = 0;
+    _pe.exclude_hv               = 1;
+    _pe.exclude_callchain_kernel = 1;
+    _pe.inherit                  = 0;
+    _pe.disabled                 = 1;
+    _pe.use_clockid              = 1;
+    _pe.clockid                  = CLOCK_REALTIME;
+
+    return _event.open(_pe, _tid);
+#else
+    (void) _event;
+    (void) _tid;
+    return std::optional<std::string>{
+        "context switch records (PERF_RECORD_SWITCH) require Linux 4.3 or newer"
+    };
+#endif
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return config::get_use_sampling() && config::get_use_sampling_offcpu();
+}
+
+void
+configure(bool _setup, int64_t _tid)
+{
+    if(!is_enabled()) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    if(_setup)
+    {
+        auto _event = std::make_unique<perf::perf_event>();
+        if(auto _err = open_event(*_event, threading::get_sys_tid()); _err)
+        {
+            static auto _once = std::once_flag{};
+            std::call_once(_once, [&_err]() {
+                OMNITRACE_WARNING_F(0, "off-CPU sampling is not available: %s\n",
+                                    _err->c_str());
+            });
+            return;
+        }
+
+        {
+            auto _lk = std::unique_lock<std::mutex>{ get_mutex() };
+            auto& _v = get_instances()[_tid];
+            read_records(_v);
+            _v.event = std::move(_event);
+            _v.pending.reset();
+            _v.event->start();
+        }
+
+        start_reader();
+    }
+    else
+    {
+        auto _lk  = std::unique_lock<std::mutex>{ get_mutex() };
+        auto  itr = get_instances().find(_tid);
+        if(itr == get_instances().end() || !itr->second.event) return;
+        itr->second.event->stop();
+        read_records(itr->second);
+        itr->second.event->close();
+    }
+}
+
+void
+shutdown()
+{
+    if(get_reader_thread())
+    {
+        get_reader_active().store(false);
+        get_reader_thread()->join();
+        get_reader_thread().reset();
+    }
+
+    auto _lk = std::unique_lock<std::mutex>{ get_mutex() };
+    for(auto& itr : get_instances())
+    {
+        if(!itr.second.event) continue;
+        itr.second.event->stop();
+        read_records(itr.second);
+        itr.second.event->close();
+        if(itr.second.lost > 0)
+            OMNITRACE_VERBOSE(1, "off-CPU sampling lost %zu records on thread %li\n",
+                              itr.second.lost, itr.first);
+    }
+}
+
+void
+postfork_child()
+{
+    // the reader thread does not exist in the child and the events belong to the
+    // threads of the parent so they are leaked
+    (void) get_reader_thread().release();
+    get_reader_active().store(false);
+    for(auto& itr : get_instances())
+        (void) itr.second.event.release();
+    get_instances().clear();
+}
+
+std::vector<record>
+get(int64_t _tid)
+{
+    auto _lk = std::unique_lock<std::mutex>{ get_mutex() };
+    auto itr = get_instances().find(_tid);
+    if(itr == get_instances().end()) return std::vector<record>{};
+    return std::move(itr->second.data);
+}
+}  // namespace offcpu
+}  // namespace omnitrace
@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/containers/static_vector.hpp"
+#include "core/defines.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace omnitrace
+{
+namespace offcpu
+{
+/// interval between a thread being switched out and switched back in
+struct record
+{
+    uint64_t                                                        beg       = 0;
+    uint64_t                                                        end       = 0;
+    bool                                                            preempted = false;
+    container::static_vector<uintptr_t, OMNITRACE_MAX_UNWIND_DEPTH> stack     = {};
+};
+
+/// returns true when OMNITRACE_SAMPLING_OFFCPU and sampling are enabled
+bool
+is_enabled();
+
+/// opens (or closes) the context-switch event of the calling thread. The records are
+/// read by a background thread so that blocked threads are never interrupted
+void
+configure(bool _setup, int64_t _tid);
+
+/// stops the background reader thread after reading the remaining records
+void
+shutdown();
+
+/// releases the events and the reader thread inherited from the parent process
+void
+postfork_child();
+
+/// returns the off-CPU intervals recorded for the thread
+std::vector<record>
+get(int64_t _tid);
+}  // namespace offcpu
+}  // namespace omnitrace
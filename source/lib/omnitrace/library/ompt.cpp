@@ -31,14 +31,26 @@
 #if defined(OMNITRACE_USE_OMPT) && OMNITRACE_USE_OMPT > 0
 
 #    include "core/components/fwd.hpp"
+#    include "core/state.hpp"
 #    include "library/components/category_region.hpp"
+#    include "library/flat_profile.hpp"
+#    include "library/tracing.hpp"
 
 #    include <timemory/components/ompt.hpp>
 #    include <timemory/components/ompt/extern.hpp>
+#    include <timemory/hash/types.hpp>
 #    include <timemory/mpl/type_traits.hpp>
 #    include <timemory/timemory.hpp>
+#    include <timemory/utility/demangle.hpp>
 
+#    include <cstdint>
+#    include <dlfcn.h>
 #    include <memory>
+#    include <mutex>
+#    include <sstream>
+#    include <string>
+#    include <unordered_map>
+#    include <vector>
 
 using api_t          = TIMEMORY_API;
 using ompt_handle_t  = tim::component::ompt_handle<api_t>;
@@ -62,12 +74,388 @@ std::unique_ptr<ompt_bundle_t> f_bundle = {};
 bool _init_toolset_off = (trait::runtime_enabled<ompt_toolset_t>::set(false),
                           trait::runtime_enabled<ompt_context_t>::set(false), true);
 tim::ompt::finalize_tool_func_t f_finalize = nullptr;
+
+// the native callbacks below bypass the timemory OMPT toolset (which constructs a
+// component bundle and formats a label per event) and record directly into the
+// perfetto trace and the (flat) profile using names interned once per code pointer
+namespace native
+{
+enum callback_class : uint8_t
+{
+    parallel_class = 0x1,
+    work_class     = 0x2,
+    sync_class     = 0x4,
+    task_class     = 0x8,
+};
+
+enum region_kind : uint64_t
+{
+    parallel_kind = 0,
+    implicit_task_kind,
+    task_kind,
+    work_kind,
+    sync_kind = work_kind + 32,
+};
+
+struct region_info
+{
+    uint8_t            category = 0;
+    std::string        name     = {};
+    tim::hash_value_t  hash     = 0;
+    const region_info* implicit = nullptr;  // implicit task of parallel region
+};
+
+bool     f_active       = false;
+uint8_t  f_classes      = 0;
+uint64_t f_codeptr_mask = (uint64_t{ 1 } << 56) - 1;
+
+uint8_t
+get_callback_classes()
+{
+    uint8_t _v = 0;
+    for(const auto& itr : config::get_ompt_callbacks())
+    {
+        if(itr == "parallel")
+            _v |= parallel_class;
+        else if(itr == "work")
+            _v |= work_class;
+        else if(itr == "sync")
+            _v |= sync_class;
+        else if(itr == "task")
+            _v |= task_class;
+        else if(itr != "timemory")
+        {
+            OMNITRACE_VERBOSE(0, "[ompt] unknown OMNITRACE_OMPT_CALLBACKS entry '%s'\n",
+                              itr.c_str());
+        }
+    }
+    return _v;
+}
+
+bool
+use_timemory_toolset()
+{
+    return config::get_ompt_callbacks().count("timemory") > 0;
+}
+
+std::string
+get_region_name(const char* _label, const void* _codeptr)
+{
+    if(!_codeptr) return std::string{ _label };
+
+    auto    _ss   = std::stringstream{};
+    Dl_info _info = {};
+    _ss << _label << " [";
+    if(dladdr(_codeptr, &_info) != 0 && _info.dli_sname)
+        _ss << tim::demangle(_info.dli_sname);
+    else
+        _ss << std::hex << "0x" << reinterpret_cast<uintptr_t>(_codeptr);
+    _ss << "]";
+    return _ss.str();
+}
+
+// returns a region which remains valid until the process exits. Lookups are served
+// from a thread-local cache so the global lock is only acquired the first time a
+// thread encounters a given (kind, code pointer) pair
+const region_info*
+get_region(uint8_t _category, uint64_t _kind, const char* _label, const void* _codeptr)
+{
+    using cache_t  = std::unordered_map<uint64_t, const region_info*>;
+    using global_t = std::unordered_map<uint64_t, std::unique_ptr<region_info>>;
+
+    auto _get_key = [_codeptr](uint64_t _kind_v) {
+        return (_kind_v << 56) | (reinterpret_cast<uintptr_t>(_codeptr) & f_codeptr_mask);
+    };
+
+    auto _key = _get_key(_kind);
+
+    static thread_local auto _cache = cache_t{};
+    auto                     itr    = _cache.find(_key);
+    if(itr != _cache.end()) return itr->second;
+
+    static auto* _mutex   = new std::mutex{};
+    static auto* _regions = new global_t{};
+
+    auto _intern = [_codeptr](std::unique_ptr<region_info>& _val, uint8_t _category_v,
+                              const char* _label_v) {
+        if(_val) return;
+        auto _name = get_region_name(_label_v, _codeptr);
+        auto _hash = tim::add_hash_id(_name);
+        _val = std::make_unique<region_info>(region_info{ _category_v, std::move(_name),
+                                                          _hash, nullptr });
+    };
+
+    auto  _lk  = std::unique_lock<std::mutex>{ *_mutex };
+    auto& _val = (*_regions)[_key];
+    if(!_val)
+    {
+        _intern(_val, _category, _label);
+        // intern the implicit task alongside the parallel region so that the
+        // parallel region is immutable once it is visible to other threads
+        if(_kind == parallel_kind)
+        {
+            auto& _task = (*_regions)[_get_key(implicit_task_kind)];
+            _intern(_task, _category, "ompt_implicit_task");
+            _val->implicit = _task.get();
+        }
+    }
+    return (_cache[_key] = _val.get());
+}
+
+void
+region_begin(const region_info* _region)
+{
+    if(!f_active || !_region) return;
+    if(get_state() != State::Active) return;
+    if(get_thread_state() != ThreadState::Enabled) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    if(get_use_timemory())
+    {
+        if(flat_profile::is_enabled())
+            flat_profile::push(_region->hash);
+        else
+            tracing::push_timemory(category::ompt{}, _region->name);
+    }
+
+    if(get_use_perfetto())
+    {
+        tracing::push_perfetto(category::ompt{}, _region->name.c_str());
+    }
+}
+
+void
+region_end(const region_info* _region)
+{
+    if(!f_active || !_region) return;
+    if(get_state() != State::Active) return;
+    if(get_thread_state() != ThreadState::Enabled) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    if(get_use_perfetto())
+    {
+        tracing::pop_perfetto(category::ompt{}, _region->name.c_str());
+    }
+
+    if(get_use_timemory())
+    {
+        if(flat_profile::is_enabled())
+            flat_profile::pop();
+        else
+            tracing::pop_timemory(category::ompt{}, _region->name);
+    }
+}
+
+// worksharing and synchronization regions are strictly nested on a thread but the
+// runtime may report a different (or null) code pointer at the end of the scope
+auto&
+get_scope_stack()
+{
+    static thread_local auto _v = []() {
+        auto _stack = std::vector<const region_info*>{};
+        _stack.reserve(32);
+        return _stack;
+    }();
+    return _v;
+}
+
+void
+scope_begin(const region_info* _region)
+{
+    get_scope_stack().emplace_back(_region);
+    region_begin(_region);
+}
+
+void
+scope_end()
+{
+    auto& _stack = get_scope_stack();
+    if(_stack.empty()) return;
+    auto* _region = _stack.back();
+    _stack.pop_back();
+    region_end(_region);
+}
+
+const char*
+get_label(ompt_work_t _v)
+{
+    switch(_v)
+    {
+        case ompt_work_loop: return "ompt_work_loop";
+        case ompt_work_sections: return "ompt_work_sections";
+        case ompt_work_single_executor: return "ompt_work_single_executor";
+        case ompt_work_single_other: return "ompt_work_single_other";
+        case ompt_work_workshare: return "ompt_work_workshare";
+        case ompt_work_distribute: return "ompt_work_distribute";
+        case ompt_work_taskloop: return "ompt_work_taskloop";
+        default: break;
+    }
+    return "ompt_work";
+}
+
+const char*
+get_label(ompt_sync_region_t _v)
+{
+    switch(_v)
+    {
+        case ompt_sync_region_barrier: return "ompt_sync_region_barrier";
+        case ompt_sync_region_barrier_implicit:
+            return "ompt_sync_region_barrier_implicit";
+        case ompt_sync_region_barrier_explicit:
+            return "ompt_sync_region_barrier_explicit";
+        case ompt_sync_region_barrier_implementation:
+            return "ompt_sync_region_barrier_implementation";
+        case ompt_sync_region_taskwait: return "ompt_sync_region_taskwait";
+        case ompt_sync_region_taskgroup: return "ompt_sync_region_taskgroup";
+        case ompt_sync_region_reduction: return "ompt_sync_region_reduction";
+        default: break;
+    }
+    return "ompt_sync_region";
+}
+
+const region_info*
+get_task_region(ompt_data_t* _data)
+{
+    if(!_data || !_data->ptr) return nullptr;
+    auto* _region = static_cast<const region_info*>(_data->ptr);
+    return (_region->category == task_class) ? _region : nullptr;
+}
+
+void
+parallel_begin(ompt_data_t*, const ompt_frame_t*, ompt_data_t* parallel_data,
+               unsigned int, int, const void* codeptr_ra)
+{
+    auto* _region =
+        get_region(parallel_class, parallel_kind, "ompt_parallel", codeptr_ra);
+    parallel_data->ptr = const_cast<region_info*>(_region);
+    region_begin(_region);
+}
+
+void
+parallel_end(ompt_data_t* parallel_data, ompt_data_t*, int, const void*)
+{
+    if(parallel_data) region_end(static_cast<const region_info*>(parallel_data->ptr));
+}
+
+void
+implicit_task(ompt_scope_endpoint_t endpoint, ompt_data_t* parallel_data,
+              ompt_data_t* task_data, unsigned int, unsigned int, int)
+{
+    if(endpoint == ompt_scope_begin)
+    {
+        // the initial implicit task has no associated parallel_begin
+        if(!parallel_data || !parallel_data->ptr) return;
+        auto* _region = static_cast<const region_info*>(parallel_data->ptr)->implicit;
+        task_data->ptr = const_cast<region_info*>(_region);
+        region_begin(_region);
+    }
+    else if(endpoint == ompt_scope_end && task_data && task_data->ptr)
+    {
+        region_end(static_cast<const region_info*>(task_data->ptr));
+        task_data->ptr = nullptr;
+    }
+}
+
+void
+work(ompt_work_t wstype, ompt_scope_endpoint_t endpoint, ompt_data_t*, ompt_data_t*,
+     uint64_t, const void* codeptr_ra)
+{
+    if(endpoint == ompt_scope_begin)
+        scope_begin(get_region(work_class, work_kind + wstype, get_label(wstype),
+                               codeptr_ra));
+    else if(endpoint == ompt_scope_end)
+        scope_end();
+}
+
+void
+sync_region(ompt_sync_region_t kind, ompt_scope_endpoint_t endpoint, ompt_data_t*,
+            ompt_data_t*, const void* codeptr_ra)
+{
+    if(endpoint == ompt_scope_begin)
+        scope_begin(
+            get_region(sync_class, sync_kind + kind, get_label(kind), codeptr_ra));
+    else if(endpoint == ompt_scope_end)
+        scope_end();
+}
+
+void
+task_create(ompt_data_t*, const ompt_frame_t*, ompt_data_t* new_task_data, int flags,
+            int, const void* codeptr_ra)
+{
+    if((flags & ompt_task_explicit) == 0 || !new_task_data) return;
+    auto* _region      = get_region(task_class, task_kind, "ompt_task", codeptr_ra);
+    new_task_data->ptr = const_cast<region_info*>(_region);
+}
+
+void
+task_schedule(ompt_data_t* prior_task_data, ompt_task_status_t prior_task_status,
+              ompt_data_t* next_task_data)
+{
+    // fulfill events do not switch tasks on this thread
+    if(prior_task_status == ompt_task_early_fulfill ||
+       prior_task_status == ompt_task_late_fulfill)
+        return;
+
+    region_end(get_task_region(prior_task_data));
+    region_begin(get_task_region(next_task_data));
+}
+
+void
+configure(ompt_function_lookup_t lookup, uint8_t _classes)
+{
+    auto _set_callback =
+        reinterpret_cast<ompt_set_callback_t>(lookup("ompt_set_callback"));
+    if(!_set_callback)
+    {
+        OMNITRACE_VERBOSE(0, "[ompt] ompt_set_callback could not be found\n");
+        return;
+    }
+
+    auto _register = [_set_callback](ompt_callbacks_t _id, auto _func,
+                                     const char* _name) {
+        auto _ret = _set_callback(_id, reinterpret_cast<ompt_callback_t>(_func));
+        if(_ret < ompt_set_sometimes)
+        {
+            OMNITRACE_VERBOSE(1, "[ompt] %s is not supported by the runtime (%i)\n",
+                              _name, static_cast<int>(_ret));
+        }
+    };
+
+    if((_classes & parallel_class) != 0)
+    {
+        _register(ompt_callback_parallel_begin, &parallel_begin, "parallel_begin");
+        _register(ompt_callback_parallel_end, &parallel_end, "parallel_end");
+        _register(ompt_callback_implicit_task, &implicit_task, "implicit_task");
+    }
+
+    if((_classes & work_class) != 0)
+        _register(ompt_callback_work, &work, "work");
+
+    if((_classes & sync_class) != 0)
+        _register(ompt_callback_sync_region, &sync_region, "sync_region");
+
+    if((_classes & task_class) != 0)
+    {
+        _register(ompt_callback_task_create, &task_create, "task_create");
+        _register(ompt_callback_task_schedule, &task_schedule, "task_schedule");
+    }
+
+    f_classes = _classes;
+}
+}  // namespace native
 }  // namespace
 
 void
 setup()
 {
     if(!tim::settings::enabled()) return;
+    if(native::f_classes != 0 || !native::use_timemory_toolset())
+    {
+        native::f_active = true;
+        return;
+    }
     trait::runtime_enabled<ompt_toolset_t>::set(true);
     trait::runtime_enabled<ompt_context_t>::set(true);
     comp::user_ompt_bundle::global_init();
@@ -84,6 +472,7 @@ shutdown()
     static bool _protect = false;
     if(_protect) return;
     _protect = true;
+    native::f_active = false;
     if(f_bundle)
     {
         if(tim::manager::instance()) tim::manager::instance()->cleanup("omnitrace-ompt");
@@ -128,8 +517,15 @@ tool_initialize(ompt_function_lookup_t lookup, int initial_device_num,
     {
         TIMEMORY_PRINTF(stderr, "OpenMP-tools configuring for initial device %i\n\n",
                         initial_device_num);
-        f_finalize = tim::ompt::configure<TIMEMORY_OMPT_API_TAG>(
-            lookup, initial_device_num, tool_data);
+        if(native::use_timemory_toolset())
+        {
+            f_finalize = tim::ompt::configure<TIMEMORY_OMPT_API_TAG>(
+                lookup, initial_device_num, tool_data);
+        }
+        else
+        {
+            native::configure(lookup, native::get_callback_classes());
+        }
     }
     return 1;  // success
 }
@@ -32,7 +32,10 @@
 #include <timemory/log/macros.hpp>
 #include <timemory/units.hpp>
 
+#include <algorithm>
 #include <asm/unistd.h>
+#include <atomic>
+#include <cerrno>
 #include <ctime>
 #include <fcntl.h>
 #include <linux/perf_event.h>
@@ -112,8 +115,10 @@ perf_event::perf_event(perf_event&& rhs) noexcept
     rhs.m_mapping = nullptr;
 
     // Copy over the sample type and read format
-    m_sample_type = rhs.m_sample_type;
-    m_read_format = rhs.m_read_format;
+    m_sample_type        = rhs.m_sample_type;
+    m_read_format        = rhs.m_read_format;
+    m_branch_sample_type = rhs.m_branch_sample_type;
+    m_sample_period      = rhs.m_sample_period;
 }
 
 /// Close the perf_event file descriptor and unmap the ring buffer
@@ -140,8 +145,10 @@ perf_event::operator=(perf_event&& rhs) noexcept
     rhs.m_mapping = nullptr;
 
     // Copy over the sample type and read format
-    m_sample_type = rhs.m_sample_type;
-    m_read_format = rhs.m_read_format;
+    m_sample_type        = rhs.m_sample_type;
+    m_read_format        = rhs.m_read_format;
+    m_branch_sample_type = rhs.m_branch_sample_type;
+    m_sample_period      = rhs.m_sample_period;
 
     return *this;
 }
@@ -151,9 +158,11 @@ std::optional<std::string>
 perf_event::open(struct perf_event_attr& _pe, pid_t _pid, int _cpu)
 {
     OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
-    m_sample_type = _pe.sample_type;
-    m_read_format = _pe.read_format;
-    m_batch_size  = _pe.wakeup_events;
+    m_sample_type        = _pe.sample_type;
+    m_read_format        = _pe.read_format;
+    m_branch_sample_type = _pe.branch_sample_type;
+    m_batch_size         = _pe.wakeup_events;
+    m_sample_period      = (_pe.freq == 0) ? _pe.sample_period : 0;
 
     // Set some mandatory fields
     _pe.size     = sizeof(struct perf_event_attr);
@@ -163,6 +172,13 @@ perf_event::open(struct perf_event_attr& _pe, pid_t _pid, int _cpu)
     m_fd = perf_event_open(&_pe, _pid, _cpu, -1, 0);
     if(m_fd == -1)
     {
+        auto _open_errno = errno;
+
+        // the event exists but the requested sampling is not supported by the PMU
+        OMNITRACE_RETURN_ERROR_MSG(_open_errno == EOPNOTSUPP,
+                                   "Failed to open perf event: "
+                                       << strerror(_open_errno));
+
         std::string path = "/proc/sys/kernel/perf_event_paranoid";
 
         auto file = std::ifstream{ path.c_str() };
@@ -278,6 +294,17 @@ perf_event::stop() const
     return (m_fd != -1);
 }
 
+/// Change the number of events in between each sample
+bool
+perf_event::set_sample_period(uint64_t _period)
+{
+    if(m_fd == -1 || m_sample_period == 0 || _period == 0) return false;
+    if(_period == m_sample_period) return true;
+    if(ioctl(m_fd, PERF_EVENT_IOC_PERIOD, &_period) == -1) return false;
+    m_sample_period = _period;
+    return true;
+}
+
 bool
 perf_event::is_open() const
 {
@@ -504,6 +531,71 @@ perf_event::record::get_cpu() const
     return *locate_field<sample::cpu, uint32_t*>();
 }
 
+uint64_t
+perf_event::record::get_addr() const
+{
+    OMNITRACE_ASSERT(is_sample() && m_source != nullptr &&
+                     m_source->is_sampling(sample::addr))
+        << "Record does not have an 'addr' field (" << is_sample() << "|" << m_source
+        << ")";
+    return *locate_field<sample::addr, uint64_t*>();
+}
+
+uint64_t
+perf_event::record::get_weight() const
+{
+    OMNITRACE_ASSERT(is_sample() && m_source != nullptr &&
+                     m_source->is_sampling(sample::weight))
+        << "Record does not have a 'weight' field (" << is_sample() << "|" << m_source
+        << ")";
+    return *locate_field<sample::weight, uint64_t*>();
+}
+
+uint64_t
+perf_event::record::get_data_src() const
+{
+    OMNITRACE_ASSERT(is_sample() && m_source != nullptr &&
+                     m_source->is_sampling(sample::data_src))
+        << "Record does not have a 'data_src' field (" << is_sample() << "|" << m_source
+        << ")";
+    return *locate_field<sample::data_src, uint64_t*>();
+}
+
+bool
+perf_event::record::is_switch_out() const
+{
+#if defined(PERF_RECORD_MISC_SWITCH_OUT)
+    return is_switch() && (m_header->misc & PERF_RECORD_MISC_SWITCH_OUT) != 0;
+#else
+    return false;
+#endif
+}
+
+bool
+perf_event::record::is_preempted() const
+{
+#if defined(PERF_RECORD_MISC_SWITCH_OUT_PREEMPT)
+    return is_switch_out() && (m_header->misc & PERF_RECORD_MISC_SWITCH_OUT_PREEMPT) != 0;
+#else
+    return false;
+#endif
+}
+
+uint64_t
+perf_event::record::get_switch_time() const
+{
+    OMNITRACE_ASSERT(is_switch() && m_source != nullptr &&
+                     m_source->is_sampling(sample::time))
+        << "Record does not have a 'time' field (" << is_switch() << "|" << m_source
+        << ")";
+
+    // the switch record only contains the sample_id fields: pid/tid, time, ...
+    uintptr_t p =
+        reinterpret_cast<uintptr_t>(m_header) + sizeof(struct perf_event_header);
+    if(m_source->is_sampling(sample::pid_tid)) p += sizeof(uint32_t) + sizeof(uint32_t);
+    return *reinterpret_cast<uint64_t*>(p);
+}
+
 container::c_array<uint64_t>
 perf_event::record::get_callchain() const
 {
@@ -519,6 +611,25 @@ perf_event::record::get_callchain() const
     return container::wrap_c_array(_base, _size);
 }
 
+container::c_array<struct perf_branch_entry>
+perf_event::record::get_branch_stack() const
+{
+    OMNITRACE_ASSERT(is_sample() && m_source != nullptr &&
+                     m_source->is_sampling(sample::branch_stack))
+        << "Record does not have a branch stack field (" << is_sample() << "|"
+        << m_source << ")";
+
+    uint8_t* _base = locate_field<sample::branch_stack, uint8_t*>();
+    uint64_t _size = *reinterpret_cast<uint64_t*>(_base);
+    _base += sizeof(uint64_t);
+#if defined(PERF_SAMPLE_BRANCH_HW_INDEX)
+    if(m_source->m_branch_sample_type & PERF_SAMPLE_BRANCH_HW_INDEX)
+        _base += sizeof(uint64_t);
+#endif
+    return container::wrap_c_array(reinterpret_cast<struct perf_branch_entry*>(_base),
+                                   _size);
+}
+
 template <sample SampleT, typename Tp>
 Tp
 perf_event::record::locate_field() const
@@ -617,7 +728,15 @@ perf_event::record::locate_field() const
     // branch_stack
     if constexpr(SampleT == sample::branch_stack) return reinterpret_cast<Tp>(p);
     if(m_source != nullptr && m_source->is_sampling(sample::branch_stack))
-        OMNITRACE_FATAL << "Branch stack sampling is not supported";
+    {
+        uint64_t nr = *reinterpret_cast<uint64_t*>(p);
+        p += sizeof(uint64_t);
+#if defined(PERF_SAMPLE_BRANCH_HW_INDEX)
+        if(m_source->m_branch_sample_type & PERF_SAMPLE_BRANCH_HW_INDEX)
+            p += sizeof(uint64_t);
+#endif
+        p += nr * sizeof(struct perf_branch_entry);
+    }
 
     // regs
     if constexpr(SampleT == sample::regs) return reinterpret_cast<Tp>(p);
@@ -629,6 +748,16 @@ perf_event::record::locate_field() const
     if(m_source != nullptr && m_source->is_sampling(sample::stack))
         OMNITRACE_FATAL << "Stack sampling is not supported";
 
+    // weight
+    if constexpr(SampleT == sample::weight) return reinterpret_cast<Tp>(p);
+    if(m_source != nullptr && m_source->is_sampling(sample::weight))
+        p += sizeof(uint64_t);
+
+    // data_src
+    if constexpr(SampleT == sample::data_src) return reinterpret_cast<Tp>(p);
+    if(m_source != nullptr && m_source->is_sampling(sample::data_src))
+        p += sizeof(uint64_t);
+
     // end
     if constexpr(SampleT == sample::last) return reinterpret_cast<Tp>(p);
 
@@ -640,6 +769,157 @@ perf_event::record::locate_field() const
         return Tp{};
 }
 
+perf_group::~perf_group() { close(); }
+
+std::optional<std::string>
+perf_group::open(const std::vector<std::string>& _events, size_t _max_events,
+                 pid_t _pid, int _cpu)
+{
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+    close();
+
+    _max_events    = std::min(_max_events, max_events);
+    auto _errors   = std::stringstream{};
+    auto _rejected = std::stringstream{};
+    for(const auto& itr : _events)
+    {
+        if(itr.empty()) continue;
+        if(m_fds.size() == _max_events)
+        {
+            _rejected << " " << itr;
+            continue;
+        }
+
+        struct perf_event_attr _pe;
+        memset(&_pe, 0, sizeof(_pe));
+        _pe.size = sizeof(_pe);
+
+        try
+        {
+            switch(get_event_type(itr))
+            {
+                case event_type::hardware:
+                    _pe.type           = PERF_TYPE_HARDWARE;
+                    _pe.config         = static_cast<int>(get_hw_config(itr));
+                    _pe.exclude_kernel = 1;
+                    break;
+                case event_type::software:
+                    _pe.type   = PERF_TYPE_SOFTWARE;
+                    _pe.config = static_cast<int>(get_sw_config(itr));
+                    // counting kernel activity requires perf_event_paranoid < 2
+                    _pe.exclude_kernel = 1;
+                    break;
+                default:
+                    _errors << " " << itr << " (unsupported event type)";
+                    continue;
+            }
+        } catch(std::exception& _e)
+        {
+            _errors << " " << itr << " (" << _e.what() << ")";
+            continue;
+        }
+
+        // only the leader starts disabled, the members follow the state of the leader
+        _pe.disabled    = (m_fds.empty()) ? 1 : 0;
+        _pe.exclude_hv  = 1;
+        _pe.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        auto _leader = (m_fds.empty()) ? -1 : static_cast<int>(m_fds.front());
+        auto _fd     = perf_event_open(&_pe, _pid, _cpu, _leader, 0);
+        if(_fd == -1)
+        {
+            _errors << " " << itr << " (" << strerror(errno) << ")";
+            continue;
+        }
+
+        m_fds.emplace_back(_fd);
+        m_labels.emplace_back(itr);
+    }
+
+    static auto _warned = std::atomic<bool>{ false };
+    if(!_rejected.str().empty() && !_warned.exchange(true))
+    {
+        OMNITRACE_WARNING_F(0,
+                            "perf event group is limited to %zu events. Rejected:%s\n",
+                            _max_events, _rejected.str().c_str());
+    }
+
+    OMNITRACE_RETURN_ERROR_MSG(m_fds.empty(),
+                               "Failed to open any perf events:" << _errors.str());
+
+    if(!_errors.str().empty())
+    {
+        OMNITRACE_VERBOSE(1, "perf event group skipped:%s\n", _errors.str().c_str());
+    }
+
+    return std::nullopt;
+}
+
+bool
+perf_group::start() const
+{
+    if(!m_fds.empty())
+    {
+        OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+        ioctl(m_fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        OMNITRACE_REQUIRE(ioctl(m_fds.front(), PERF_EVENT_IOC_ENABLE,
+                                PERF_IOC_FLAG_GROUP) != -1)
+            << "Failed to start perf event group: " << strerror(errno);
+    }
+    return !m_fds.empty();
+}
+
+bool
+perf_group::stop() const
+{
+    if(!m_fds.empty())
+    {
+        OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+        OMNITRACE_REQUIRE(ioctl(m_fds.front(), PERF_EVENT_IOC_DISABLE,
+                                PERF_IOC_FLAG_GROUP) != -1)
+            << "Failed to stop perf event group: " << strerror(errno);
+    }
+    return !m_fds.empty();
+}
+
+void
+perf_group::close()
+{
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+    stop();
+
+    // close the members before the leader
+    for(auto itr = m_fds.rbegin(); itr != m_fds.rend(); ++itr)
+        ::close(*itr);
+
+    m_fds.clear();
+    m_labels.clear();
+}
+
+size_t
+perf_group::read(long long* _values, size_t _capacity) const
+{
+    if(m_fds.empty() || _values == nullptr) return 0;
+
+    // layout for PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING:
+    //   { nr, time_enabled, time_running, value[nr] }
+    uint64_t _buf[3 + max_events] = {};
+    auto     _nbytes              = ::read(m_fds.front(), _buf, sizeof(_buf));
+    if(_nbytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) return 0;
+
+    auto _nvalues = static_cast<size_t>(_nbytes) / sizeof(uint64_t) - 3;
+    auto _n       = std::min<size_t>({ _buf[0], _nvalues, _capacity });
+    auto _scale   = (_buf[2] > 0 && _buf[2] < _buf[1])
+                      ? (static_cast<double>(_buf[1]) / static_cast<double>(_buf[2]))
+                      : 1.0;
+
+    for(size_t i = 0; i < _n; ++i)
+        _values[i] = static_cast<long long>(static_cast<double>(_buf[3 + i]) * _scale);
+
+    return _n;
+}
+
 namespace
 {
 inline auto&
@@ -33,10 +33,12 @@
 #include <cstdint>
 #include <functional>
 #include <linux/perf_event.h>
+#include <optional>
 #include <regex>
 #include <set>
 #include <string>
 #include <sys/types.h>
+#include <vector>
 
 namespace omnitrace
 {
@@ -87,6 +89,13 @@ struct perf_event
     /// Check if counting events and collecting samples
     bool is_open() const;
 
+    /// Get the number of events in between each sample (zero in frequency mode)
+    uint64_t get_sample_period() const { return m_sample_period; }
+
+    /// Change the number of events in between each sample while the event is open.
+    /// Async-signal-safe
+    bool set_sample_period(uint64_t);
+
     /// Close the perf_event file and unmap the ring buffer
     void close();
 
@@ -133,6 +142,18 @@ struct perf_event
         inline bool is_read() const { return get_type() == record_type::read; }
         inline bool is_sample() const { return get_type() == record_type::sample; }
         inline bool is_mmap2() const { return get_type() == record_type::mmap2; }
+        inline bool is_switch() const
+        {
+            return get_type() == record_type::switch_record;
+        }
+
+        /// whether a switch record is for the thread being switched out
+        bool is_switch_out() const;
+        /// whether the thread was switched out while it was still runnable
+        bool is_preempted() const;
+        /// time of a switch record (requires sample_id_all)
+        uint64_t get_switch_time() const;
+
 
         uint64_t                     get_ip() const;
         uint64_t                     get_pid() const;
@@ -140,8 +161,14 @@ struct perf_event
         uint64_t                     get_time() const;
         uint64_t                     get_period() const;
         uint32_t                     get_cpu() const;
+        uint64_t                     get_addr() const;
+        uint64_t                     get_weight() const;
+        uint64_t                     get_data_src() const;
         container::c_array<uint64_t> get_callchain() const;
 
+        /// taken branches, most recent first (requires PERF_SAMPLE_BRANCH_STACK)
+        container::c_array<struct perf_branch_entry> get_branch_stack() const;
+
     private:
         record(const perf_event* source, struct perf_event_header* header)
         : m_source(source)
@@ -203,6 +230,60 @@ private:
     uint64_t m_sample_type = 0;
     /// The read format from this perf event's configuration
     uint64_t m_read_format = 0;
+    /// The branch sample type from this perf event's configuration
+    uint64_t m_branch_sample_type = 0;
+    /// The current sample period of this perf event
+    uint64_t m_sample_period = 0;
+};
+
+/// A group of counting (non-sampling) events which share a leader so that all of the
+/// values are read together with a single read() on the leader file descriptor
+struct perf_group
+{
+    static constexpr size_t max_events = 16;
+
+    perf_group() = default;
+    ~perf_group();
+
+    perf_group(const perf_group&) = delete;
+    perf_group(perf_group&&)      = delete;
+    perf_group& operator=(const perf_group&) = delete;
+    perf_group& operator=(perf_group&&) = delete;
+
+    /// Open the hardware and software events (e.g. PERF_COUNT_HW_CPU_CYCLES) in a
+    /// single group. At most _max_events (clamped to max_events) are opened and the
+    /// remaining events are rejected with a warning. Events which cannot be opened are
+    /// skipped and an error is only returned when none of the events could be opened
+    std::optional<std::string> open(const std::vector<std::string>& events,
+                                    size_t _max_events = max_events, pid_t pid = 0,
+                                    int cpu = -1);
+
+    /// Reset and start counting all the events in the group
+    bool start() const;
+
+    /// Stop counting all the events in the group
+    bool stop() const;
+
+    /// Check if the group leader is open
+    bool is_open() const { return !m_fds.empty(); }
+
+    /// Close all the file descriptors in the group
+    void close();
+
+    /// Number of events successfully opened
+    size_t size() const { return m_fds.size(); }
+
+    /// Names of the events successfully opened, in read order
+    const std::vector<std::string>& get_labels() const { return m_labels; }
+
+    /// Read the values of all the events with one syscall, scaled for the fraction of
+    /// time the group was multiplexed out. Returns the number of values written.
+    /// Does not allocate so it is safe to call from a signal handler.
+    size_t read(long long* values, size_t capacity) const;
+
+private:
+    std::vector<long>        m_fds    = {};
+    std::vector<std::string> m_labels = {};
 };
 
 /// provides thread-local instance of perf_event
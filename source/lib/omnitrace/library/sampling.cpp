@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "library/sampling.hpp"
+#include "binary/analysis.hpp"
 #include "core/common.hpp"
 #include "core/components/fwd.hpp"
 #include "core/config.hpp"
@@ -29,13 +30,17 @@
 #include "core/perf.hpp"
 #include "core/state.hpp"
 #include "core/utility.hpp"
+#include "library/branch_sampling.hpp"
 #include "library/components/backtrace.hpp"
 #include "library/components/backtrace_metrics.hpp"
 #include "library/components/backtrace_timestamp.hpp"
 #include "library/components/callchain.hpp"
+#include "library/memory_sampling.hpp"
+#include "library/offcpu.hpp"
 #include "library/perf.hpp"
 #include "library/ptl.hpp"
 #include "library/runtime.hpp"
+#include "library/sampling_overhead.hpp"
 #include "library/thread_data.hpp"
 #include "library/thread_info.hpp"
 #include "library/tracing.hpp"
@@ -261,6 +266,14 @@ get_sampler_init(int64_t _tid = threading::get_id())
     return sampler_init_instances::instance(construct_on_thread{ _tid });
 }
 
+// set when the sampler was re-armed in a child process after fork()
+bool&
+get_postfork_child_sampling()
+{
+    static bool _v = false;
+    return _v;
+}
+
 unique_ptr_t<bool>&
 get_sampler_running(int64_t _tid)
 {
@@ -634,9 +647,31 @@ configure(bool _setup, int64_t _tid)
                 _pe.clockid     = CLOCK_REALTIME;
             }
 
+            if(memory_sampling::is_enabled())
+            {
+                if(auto _memory_error = memory_sampling::configure(_pe); _memory_error)
+                {
+                    OMNITRACE_WARNING_F(0,
+                                        "memory sampling is not available: %s. Overflow "
+                                        "sampling will use %s\n",
+                                        _memory_error->c_str(), _overflow_event.c_str());
+                }
+            }
+
+            if(branch_sampling::is_enabled() && branch_sampling::configure(_pe))
+                branch_sampling::setup(_tid);
+
             auto _perf_open_error =
                 _perf_sampler->open(_pe, _info->index_data->system_value);
 
+            if(_perf_open_error && (_pe.sample_type & PERF_SAMPLE_BRANCH_STACK) != 0)
+            {
+                // branch records are often unavailable in virtual machines
+                branch_sampling::disable(_pe, *_perf_open_error);
+                _perf_open_error =
+                    _perf_sampler->open(_pe, _info->index_data->system_value);
+            }
+
             OMNITRACE_REQUIRE(!_perf_open_error)
                 << "perf backend for overflow failed to activate: " << *_perf_open_error;
 
@@ -713,10 +748,13 @@ configure(bool _setup, int64_t _tid)
             }
         }
 
+        if(sampling_overhead::is_enabled()) sampling_overhead::setup(_tid);
+
         *_running = true;
         sampling::get_sampler_init(_tid)->sample();
         start_duration_thread();
         _sampler->start();
+        offcpu::configure(true, _tid);
     }
     else if(!_setup && _sampler && _is_running)
     {
@@ -741,6 +779,7 @@ configure(bool _setup, int64_t _tid)
         _sampler->reset();
         *_running = false;
         if(_perf_sampler) _perf_sampler->stop();
+        offcpu::configure(false, _tid);
 
         if(_tid == 0)
         {
@@ -764,6 +803,7 @@ configure(bool _setup, int64_t _tid)
                 if(itr) itr->flush();
 
             stop_duration_thread();
+            offcpu::shutdown();
         }
 
         if(trait::runtime_enabled<backtrace_metrics>::get())
@@ -798,8 +838,16 @@ post_process_timer_data(int64_t, const bundle_t*, const std::vector<bundle_t*>&)
 std::vector<overflow_sampling_data>
 post_process_overflow_data(int64_t, const bundle_t*, const std::vector<bundle_t*>&);
 
+std::vector<overflow_sampling_data>
+post_process_offcpu_data(int64_t);
+
+std::vector<timer_sampling_data>
+exclude_offcpu_time(std::vector<timer_sampling_data>,
+                    const std::vector<overflow_sampling_data>&);
+
 void
 post_process_perfetto(int64_t, const std::vector<timer_sampling_data>&,
+                      const std::vector<overflow_sampling_data>&,
                       const std::vector<overflow_sampling_data>&);
 
 void
@@ -827,7 +875,7 @@ setup()
 std::set<int>
 shutdown()
 {
-    if(is_child_process())
+    if(is_child_process() && !get_postfork_child_sampling())
     {
         for(auto& itr : *sampler_instances::get())
             itr.release();
@@ -839,6 +887,58 @@ shutdown()
     return _v;
 }
 
+std::set<int>
+postfork_child()
+{
+    if(!get_use_sampling()) return std::set<int>{};
+
+    OMNITRACE_SCOPED_SAMPLING_ON_CHILD_THREADS(false);
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    // the timers, perf events, and allocator threads of the parent do not exist in the
+    // child and destroying them would attempt to stop/join them so they are leaked
+    for(auto& itr : *sampler_instances::get())
+        itr.release();
+
+    for(int64_t i = 0; i < OMNITRACE_MAX_THREADS; ++i)
+    {
+        perf::get_instance(i).release();
+        if(get_sampler_running(i)) *get_sampler_running(i) = false;
+    }
+
+    using allocators_t = std::decay_t<decltype(get_sampler_allocators())>;
+    new allocators_t{ std::move(get_sampler_allocators()) };
+    get_sampler_allocators().clear();
+
+    // the offload file of the parent is shared with the child (and removed by the
+    // parent) so the child offloads to a new file
+    if(get_use_tmp_files())
+    {
+        auto  _lk   = locking::atomic_lock{ get_offload_mutex() };
+        auto& _file = get_offload_file();
+        using file_ptr_t = std::decay_t<decltype(_file)>;
+        new file_ptr_t{ std::move(_file) };
+        _file = config::get_tmp_file("sampling");
+        if(_file)
+        {
+            auto _success = _file->open();
+            OMNITRACE_CI_FAIL(!_success,
+                              "Error opening sampling offload temporary file '%s'\n",
+                              _file->filename.c_str());
+        }
+        offload_seq_data.clear();
+    }
+
+    offcpu::postfork_child();
+
+    get_postfork_child_sampling() = true;
+
+    auto _signals = configure(true);
+    unblock_samples();
+    unblock_signals(_signals);
+    return _signals;
+}
+
 void
 block_samples()
 {
@@ -894,6 +994,9 @@ post_process()
     size_t _total_threads    = 0;
     auto   _external_samples = std::atomic<size_t>{ 0 };
     auto   _internal_samples = std::atomic<size_t>{ 0 };
+    size_t _offcpu_intervals = 0;
+    double _offcpu_blocked   = 0.0;
+    double _offcpu_preempted = 0.0;
 
     OMNITRACE_VERBOSE(2 || get_debug_sampling(), "Stopping sampling components...\n");
 
@@ -970,20 +1073,62 @@ post_process()
             }
         }
 
+        // blocked threads may not have any on-CPU samples
+        auto _offcpu_data = post_process_offcpu_data(i);
+        for(const auto& itr : _offcpu_data)
+        {
+            auto _elapsed = static_cast<double>(itr.m_end - itr.m_beg) / units::sec;
+            if(itr.m_stack.back().name == "[off-cpu]")
+                _offcpu_blocked += _elapsed;
+            else
+                _offcpu_preempted += _elapsed;
+        }
+        _offcpu_intervals += _offcpu_data.size();
+
         _total_data += _data.size();
         _total_threads += (!_data.empty()) ? 1 : 0;
 
-        if(!_data.empty())
+        if(!_data.empty() || !_offcpu_data.empty())
         {
             OMNITRACE_VERBOSE(2 || get_debug_sampling(),
                               "Sampler data for thread %lu has %zu valid entries...\n", i,
                               _data.size());
 
+            if(memory_sampling::is_enabled())
+            {
+                for(const auto* itr : _data)
+                {
+                    const auto* _cc = itr->get<callchain>();
+                    if(!_cc) continue;
+                    for(const auto& ritr : _cc->get_data())
+                    {
+                        if(ritr.memory.address != 0 && !ritr.data.empty())
+                            memory_sampling::add_sample(ritr.timestamp,
+                                                        ritr.data.front(), ritr.memory);
+                    }
+                }
+            }
+
             auto _timer_data    = post_process_timer_data(i, _init, _data);
             auto _overflow_data = post_process_overflow_data(i, _init, _data);
 
-            if(get_use_perfetto()) post_process_perfetto(i, _timer_data, _overflow_data);
-            if(get_use_timemory()) post_process_timemory(i, _timer_data, _overflow_data);
+            if(get_use_perfetto())
+                post_process_perfetto(i, _timer_data, _overflow_data, _offcpu_data);
+
+            if(get_use_timemory() && !_offcpu_data.empty())
+            {
+                // the blocked time is attributed to the off-CPU call-stacks instead of
+                // the on-CPU samples which were taken before and after it
+                auto _merged_data = _overflow_data;
+                _merged_data.insert(_merged_data.end(), _offcpu_data.begin(),
+                                    _offcpu_data.end());
+                post_process_timemory(i, exclude_offcpu_time(_timer_data, _offcpu_data),
+                                      _merged_data);
+            }
+            else if(get_use_timemory())
+            {
+                post_process_timemory(i, _timer_data, _overflow_data);
+            }
         }
         else
         {
@@ -1018,6 +1163,16 @@ post_process()
                       "were taken while within instrumented routines\n",
                       _total_data, _total_threads, _internal_samples.load(),
                       (_internal_samples + _external_samples));
+
+    if(offcpu::is_enabled())
+    {
+        OMNITRACE_VERBOSE(1,
+                          "off-CPU sampling :: %zu intervals :: %.6f sec blocked :: %.6f "
+                          "sec preempted\n",
+                          _offcpu_intervals, _offcpu_blocked, _offcpu_preempted);
+    }
+
+    sampling_overhead::post_process();
 }
 
 namespace
@@ -1044,7 +1199,8 @@ post_process_timer_data(int64_t _tid, const bundle_t* _init,
         _ret.m_beg   = _last->get<backtrace_timestamp>()->get_timestamp();
         _ret.m_end   = _bt_time->get_timestamp();
         _ret.m_stack = backtrace::filter_and_patch(_bt_data->get());
-        if constexpr(tim::trait::is_available<hw_counters>::value)
+        if(tim::trait::is_available<hw_counters>::value ||
+           backtrace_metrics::use_perf_counters())
         {
             auto _hw_counters_enabled = [](const auto* _bt_v) {
                 return (_bt_v != nullptr) &&
@@ -1110,9 +1266,75 @@ post_process_overflow_data(int64_t                       _tid, const bundle_t*,
     return _results;
 }
 
+std::vector<overflow_sampling_data>
+post_process_offcpu_data(int64_t _tid)
+{
+    auto _results = std::vector<overflow_sampling_data>{};
+
+    for(const auto& itr : offcpu::get(_tid))
+    {
+        auto _stack = std::vector<tim::unwind::processed_entry>{};
+        _stack.reserve(itr.stack.size() + 1);
+        for(auto iitr : itr.stack)
+        {
+            auto _entry = binary::lookup_ipaddr_entry<true>(iitr);
+            if(_entry) _stack.emplace_back(*_entry);
+        }
+
+        // put the bottom of the call-stack on top
+        std::reverse(_stack.begin(), _stack.end());
+        _stack = backtrace::filter_and_patch(_stack);
+        if(_stack.empty()) continue;
+
+        // the leaf distinguishes the blocked time from the on-CPU time of the caller
+        auto _leaf = tim::unwind::processed_entry{};
+        _leaf.name = (itr.preempted) ? "[off-cpu: preempted]" : "[off-cpu]";
+        _stack.emplace_back(std::move(_leaf));
+
+        auto _ret    = overflow_sampling_data{};
+        _ret.m_tid   = _tid;
+        _ret.m_beg   = itr.beg;
+        _ret.m_end   = itr.end;
+        _ret.m_stack = std::move(_stack);
+        _results.emplace_back(std::move(_ret));
+    }
+
+    std::sort(_results.begin(), _results.end(),
+              [](const auto& _lhs, const auto& _rhs) { return _lhs.m_beg < _rhs.m_beg; });
+
+    return _results;
+}
+
+std::vector<timer_sampling_data>
+exclude_offcpu_time(std::vector<timer_sampling_data>          _timer_data,
+                    const std::vector<overflow_sampling_data>& _offcpu_data)
+{
+    // both are sorted by the start time and the off-CPU intervals do not overlap
+    auto _offcpu = _offcpu_data.begin();
+    for(auto& itr : _timer_data)
+    {
+        while(_offcpu != _offcpu_data.end() && _offcpu->m_end <= itr.m_beg)
+            ++_offcpu;
+
+        uint64_t _overlap = 0;
+        for(auto oitr = _offcpu; oitr != _offcpu_data.end() && oitr->m_beg < itr.m_end;
+            ++oitr)
+        {
+            _overlap +=
+                std::min(oitr->m_end, itr.m_end) - std::max(oitr->m_beg, itr.m_beg);
+        }
+
+        // the wall-clock value of the sample is the duration of the interval
+        itr.m_beg += std::min<uint64_t>(_overlap, itr.m_end - itr.m_beg);
+    }
+
+    return _timer_data;
+}
+
 void
 post_process_perfetto(int64_t _tid, const std::vector<timer_sampling_data>& _timer_data,
-                      const std::vector<overflow_sampling_data>& _overflow_data)
+                      const std::vector<overflow_sampling_data>& _overflow_data,
+                      const std::vector<overflow_sampling_data>& _offcpu_data)
 {
     auto _valid_metrics = backtrace_metrics::valid_array_t{};
 
@@ -1139,34 +1361,14 @@ post_process_perfetto(int64_t _tid, const std::vector<timer_sampling_data>& _tim
 
     if(!_thread_info) return;
 
-    auto _overflow_event =
-        get_setting_value<std::string>("OMNITRACE_SAMPLING_OVERFLOW_EVENT").value_or("");
-
-    if(!_overflow_event.empty() && !_overflow_data.empty())
-    {
-        auto _beg_ns = std::max(_overflow_data.front().m_beg, _thread_info->get_start());
-        auto _end_ns = std::min(_overflow_data.back().m_end, _thread_info->get_stop());
-
-        const auto _overflow_prefix = std::string_view{ "PERF_COUNT_" };
-        const auto _overflow_pos    = _overflow_event.find(_overflow_prefix);
-        if(_overflow_pos != std::string::npos)
-            _overflow_event =
-                _overflow_event.substr(_overflow_pos + _overflow_prefix.length());
-
-        const auto* _main_name =
-            static_strings.emplace(join(" ", _overflow_event, "samples [omnitrace]"))
-                .first->c_str();
-
-        auto _track = tracing::get_perfetto_track(
-            category::overflow_sampling{},
-            [](auto _seq_id, auto _sys_id) {
-                return TIMEMORY_JOIN(" ", "Thread", _seq_id, "Overflow", "(S)", _sys_id);
-            },
-            _thread_info->index_data->sequent_value,
-            _thread_info->index_data->system_value);
+    // writes the call-stack of each interval under a slice which spans all of them
+    auto _write_intervals = [&_thread_info](auto _category, const char* _main_name,
+                                            auto _track, const auto& _intervals) {
+        auto _beg_ns = std::max(_intervals.front().m_beg, _thread_info->get_start());
+        auto _end_ns = std::min(_intervals.back().m_end, _thread_info->get_stop());
 
-        tracing::push_perfetto_track(category::overflow_sampling{}, _main_name, _track,
-                                     _beg_ns, [&](::perfetto::EventContext ctx) {
+        tracing::push_perfetto_track(_category, _main_name, _track, _beg_ns,
+                                     [&](::perfetto::EventContext ctx) {
                                          if(config::get_perfetto_annotations())
                                          {
                                              tracing::add_perfetto_annotation(
@@ -1174,7 +1376,7 @@ post_process_perfetto(int64_t _tid, const std::vector<timer_sampling_data>& _tim
                                          }
                                      });
 
-        for(const auto& itr : _overflow_data)
+        for(const auto& itr : _intervals)
         {
             auto _beg = itr.m_beg;
             auto _end = itr.m_end;
@@ -1186,8 +1388,7 @@ post_process_perfetto(int64_t _tid, const std::vector<timer_sampling_data>& _tim
                 const auto* _name =
                     static_strings.emplace(demangle(iitr.name)).first->c_str();
                 tracing::push_perfetto_track(
-                    category::overflow_sampling{}, _name, _track, _beg,
-                    [&](::perfetto::EventContext ctx) {
+                    _category, _name, _track, _beg, [&](::perfetto::EventContext ctx) {
                         if(config::get_perfetto_annotations())
                         {
                             tracing::add_perfetto_annotation(ctx, "file", iitr.location);
@@ -1211,19 +1412,61 @@ post_process_perfetto(int64_t _tid, const std::vector<timer_sampling_data>& _tim
                             }
                         }
                     });
-                tracing::pop_perfetto_track(category::overflow_sampling{}, _name, _track,
-                                            _end);
+                tracing::pop_perfetto_track(_category, _name, _track, _end);
             }
         }
 
-        tracing::pop_perfetto_track(category::overflow_sampling{}, _main_name, _track,
-                                    _end_ns, [&](::perfetto::EventContext ctx) {
+        tracing::pop_perfetto_track(_category, _main_name, _track, _end_ns,
+                                    [&](::perfetto::EventContext ctx) {
                                         if(config::get_perfetto_annotations())
                                         {
                                             tracing::add_perfetto_annotation(
                                                 ctx, "end_ns", _end_ns);
                                         }
                                     });
+    };
+
+    auto _overflow_event =
+        get_setting_value<std::string>("OMNITRACE_SAMPLING_OVERFLOW_EVENT").value_or("");
+
+    if(!_overflow_event.empty() && !_overflow_data.empty())
+    {
+        const auto _overflow_prefix = std::string_view{ "PERF_COUNT_" };
+        const auto _overflow_pos    = _overflow_event.find(_overflow_prefix);
+        if(_overflow_pos != std::string::npos)
+            _overflow_event =
+                _overflow_event.substr(_overflow_pos + _overflow_prefix.length());
+
+        const auto* _main_name =
+            static_strings.emplace(join(" ", _overflow_event, "samples [omnitrace]"))
+                .first->c_str();
+
+        auto _track = tracing::get_perfetto_track(
+            category::overflow_sampling{},
+            [](auto _seq_id, auto _sys_id) {
+                return TIMEMORY_JOIN(" ", "Thread", _seq_id, "Overflow", "(S)", _sys_id);
+            },
+            _thread_info->index_data->sequent_value,
+            _thread_info->index_data->system_value);
+
+        _write_intervals(category::overflow_sampling{}, _main_name, _track,
+                         _overflow_data);
+    }
+
+    // the off-CPU intervals are wall-clock time of the thread so they are in the timer
+    // sampling category but on their own track
+    if(!_offcpu_data.empty())
+    {
+        auto _track = tracing::get_perfetto_track(
+            category::timer_sampling{},
+            [](auto _seq_id, auto _sys_id) {
+                return TIMEMORY_JOIN(" ", "Thread", _seq_id, "Off-CPU", "(S)", _sys_id);
+            },
+            _thread_info->index_data->sequent_value,
+            _thread_info->index_data->system_value);
+
+        _write_intervals(category::timer_sampling{}, "off-CPU [omnitrace]", _track,
+                         _offcpu_data);
     }
 
     if(!_timer_data.empty())
@@ -1465,9 +1708,12 @@ post_process_timemory(int64_t _tid, const std::vector<timer_sampling_data>& _tim
 
             if constexpr(tim::trait::is_available<hw_counters>::value)
             {
+                // the labels of the papi_array component come from the PAPI
+                // configuration so perf event group values are only reported in
+                // perfetto
                 auto* _hw_counter = iitr.get<hw_counters>();
 
-                if(_hw_counter && _metrics &&
+                if(_hw_counter && _metrics && !backtrace_metrics::use_perf_counters() &&
                    _metrics(type_list<backtrace_metrics::hw_counters>{}) &&
                    _metrics(category::thread_hardware_counter{}))
                 {
@@ -53,6 +53,10 @@ setup();
 std::set<int>
 shutdown();
 
+// re-arms the sampler for the calling thread in a child process after fork()
+std::set<int>
+postfork_child();
+
 void
 block_samples();
 
@@ -0,0 +1,371 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/sampling_overhead.hpp"
+#include "core/common.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/output.hpp"
+#include "core/state.hpp"
+#include "core/timemory.hpp"
+#include "core/timestamp.hpp"
+#include "library/perf.hpp"
+#include "library/thread_data.hpp"
+
+#include <timemory/tpls/cereal/cereal.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace omnitrace
+{
+namespace sampling_overhead
+{
+namespace
+{
+// the rates are only adjusted after this much time and this many handled samples so
+// that one slow unwind or a decimated window does not swing the rates
+constexpr uint64_t window_nsec    = 100000000;
+constexpr uint64_t window_samples = 8;
+// the rates are reduced by at most this factor relative to the configured rates
+constexpr double max_scale = 1024.0;
+
+// each controller is only updated by the sample handler of its thread so the updates
+// do not need to be atomic
+struct controller
+{
+    double   budget      = 0.0;  // fraction of the wall-time
+    double   scale       = 1.0;  // reduction of the configured rates
+    uint64_t stride      = 1;    // one out of every stride timer signals is sampled
+    uint64_t count       = 0;
+    bool     skip        = false;
+    uint64_t handler_beg = 0;
+    uint64_t window_beg  = 0;
+    uint64_t window_cost = 0;
+    uint64_t window_size = 0;
+
+    uint64_t first            = 0;
+    uint64_t last             = 0;
+    uint64_t cost             = 0;
+    uint64_t timer_signals    = 0;
+    uint64_t timer_samples    = 0;
+    uint64_t overflow_samples = 0;
+    uint64_t adjustments      = 0;
+    uint64_t max_stride       = 1;
+    uint64_t period           = 0;  // configured period of the overflow event
+    uint64_t last_period      = 0;
+    uint64_t max_period       = 0;
+
+    void adjust(int64_t _tid, uint64_t _elapsed);
+};
+
+using controller_instances = thread_data<controller, category::sampling>;
+
+controller*
+get_controller(int64_t _tid)
+{
+    auto* _controllers = controller_instances::get();
+    if(!_controllers || _tid < 0 || static_cast<size_t>(_tid) >= _controllers->size())
+        return nullptr;
+    // the controller is allocated before the sampling starts, never in the handler
+    return _controllers->at(_tid).get();
+}
+
+bool
+is_timer_signal(int _signo)
+{
+    return (_signo == get_sampling_realtime_signal() ||
+            _signo == get_sampling_cputime_signal());
+}
+
+void
+controller::adjust(int64_t _tid, uint64_t _elapsed)
+{
+    auto _ratio = static_cast<double>(window_cost) / (budget * _elapsed);
+
+    // the rates are only restored when well under the budget so that they do not
+    // oscillate around it
+    if(_ratio <= 1.0 && (_ratio >= 0.5 || scale <= 1.0)) return;
+
+    scale      = std::clamp(scale * std::clamp(_ratio, 0.5, 4.0), 1.0, max_scale);
+    stride     = static_cast<uint64_t>(std::llround(scale));
+    max_stride = std::max(max_stride, stride);
+    adjustments += 1;
+
+    auto& _perf_event = perf::get_instance(_tid);
+    if(period > 0 && _perf_event)
+    {
+        auto _period = static_cast<uint64_t>(std::llround(scale * period));
+        if(_perf_event->set_sample_period(_period))
+        {
+            last_period = _period;
+            max_period  = std::max(max_period, _period);
+        }
+    }
+}
+
+// the effective rates of a thread. The samples are weighted by the time in between
+// the samples which were kept so the decimation does not bias the results
+struct thread_entry
+{
+    int64_t  thread           = 0;
+    double   elapsed          = 0.0;
+    double   handler          = 0.0;
+    double   overhead         = 0.0;
+    uint64_t timer_signals    = 0;
+    uint64_t timer_samples    = 0;
+    double   realtime_freq    = 0.0;
+    double   cputime_freq     = 0.0;
+    uint64_t overflow_samples = 0;
+    uint64_t overflow_period  = 0;
+    uint64_t final_period     = 0;
+    uint64_t max_period       = 0;
+    uint64_t max_stride       = 1;
+    uint64_t adjustments      = 0;
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("thread", thread), cereal::make_nvp("elapsed", elapsed),
+           cereal::make_nvp("handler", handler), cereal::make_nvp("overhead", overhead),
+           cereal::make_nvp("timer_signals", timer_signals),
+           cereal::make_nvp("timer_samples", timer_samples),
+           cereal::make_nvp("realtime_freq", realtime_freq),
+           cereal::make_nvp("cputime_freq", cputime_freq),
+           cereal::make_nvp("overflow_samples", overflow_samples),
+           cereal::make_nvp("overflow_period", overflow_period),
+           cereal::make_nvp("final_overflow_period", final_period),
+           cereal::make_nvp("max_overflow_period", max_period),
+           cereal::make_nvp("max_timer_stride", max_stride),
+           cereal::make_nvp("adjustments", adjustments));
+    }
+};
+
+void
+write_report(const std::string& _label, double _budget,
+             const std::vector<thread_entry>& _data)
+{
+    output::write_text_and_json(
+        _label,
+        [&](std::ostream& ofs) {
+            ofs << "# overhead budget: " << _budget << "%\n";
+            ofs << std::setw(6) << "THREAD"
+                << "  " << std::setw(12) << "OVERHEAD (%)"
+                << "  " << std::setw(12) << "HANDLER (s)"
+                << "  " << std::setw(14) << "TIMER SAMPLES"
+                << "  " << std::setw(14) << "TIMER SIGNALS"
+                << "  " << std::setw(14) << "REALTIME (Hz)"
+                << "  " << std::setw(13) << "CPUTIME (Hz)"
+                << "  " << std::setw(10) << "OVERFLOWS"
+                << "  " << std::setw(14) << "PERIOD (FINAL)"
+                << "  " << std::setw(12) << "PERIOD (MAX)"
+                << "\n";
+            ofs << std::fixed << std::setprecision(3);
+            for(const auto& itr : _data)
+            {
+                ofs << std::setw(6) << itr.thread << "  " << std::setw(12)
+                    << itr.overhead << "  " << std::setw(12) << itr.handler << "  "
+                    << std::setw(14) << itr.timer_samples << "  " << std::setw(14)
+                    << itr.timer_signals << "  " << std::setw(14) << itr.realtime_freq
+                    << "  " << std::setw(13) << itr.cputime_freq << "  "
+                    << std::setw(10) << itr.overflow_samples << "  " << std::setw(14)
+                    << itr.final_period << "  " << std::setw(12) << itr.max_period
+                    << "\n";
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("budget", _budget), cereal::make_nvp("threads", _data));
+        });
+}
+}  // namespace
+
+bool
+is_enabled()
+{
+    return config::get_use_sampling() && config::get_sampling_overhead() > 0.0;
+}
+
+void
+setup(int64_t _tid)
+{
+    auto& _v = controller_instances::instance(construct_on_thread{ _tid });
+    if(!_v) return;
+
+    *_v        = controller{};
+    _v->budget = config::get_sampling_overhead() / 100.0;
+
+    const auto& _perf_event = perf::get_instance(_tid);
+    if(_perf_event && _perf_event->is_open())
+    {
+        _v->period      = _perf_event->get_sample_period();
+        _v->last_period = _v->period;
+        _v->max_period  = _v->period;
+    }
+
+    // make sure the queries in the handler do not allocate
+    (void) get_sampling_realtime_signal();
+    (void) get_sampling_cputime_signal();
+    (void) get_sampling_overflow_signal();
+}
+
+bool
+start(int64_t _tid, int _signo)
+{
+    auto* _v = get_controller(_tid);
+    if(!_v) return true;
+
+    _v->skip        = false;
+    _v->handler_beg = 0;
+
+    if(is_timer_signal(_signo))
+    {
+        _v->timer_signals += 1;
+        _v->skip = ((_v->count++ % _v->stride) != 0);
+        if(!_v->skip) _v->timer_samples += 1;
+    }
+    else if(_signo == get_sampling_overflow_signal())
+    {
+        _v->overflow_samples += 1;
+    }
+    else
+    {
+        return true;
+    }
+
+    _v->handler_beg = timestamp::now();
+    if(_v->first == 0) _v->first = _v->window_beg = _v->handler_beg;
+    if(!_v->skip) _v->window_size += 1;
+
+    return !_v->skip;
+}
+
+bool
+is_skipped(int64_t _tid)
+{
+    auto* _v = get_controller(_tid);
+    return (_v) ? _v->skip : false;
+}
+
+void
+stop(int64_t _tid, int)
+{
+    auto* _v = get_controller(_tid);
+    if(!_v || _v->handler_beg == 0) return;
+
+    auto _now  = timestamp::now();
+    auto _cost = (_now > _v->handler_beg) ? (_now - _v->handler_beg) : 0;
+
+    _v->skip        = false;
+    _v->handler_beg = 0;
+    _v->last        = _now;
+    _v->cost += _cost;
+    _v->window_cost += _cost;
+
+    auto _elapsed = _now - _v->window_beg;
+    if(_elapsed < window_nsec || _v->window_size < window_samples) return;
+
+    _v->adjust(_tid, _elapsed);
+    _v->window_beg  = _now;
+    _v->window_cost = 0;
+    _v->window_size = 0;
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    OMNITRACE_SCOPED_THREAD_STATE(ThreadState::Internal);
+
+    auto _budget      = config::get_sampling_overhead();
+    auto _data        = std::vector<thread_entry>{};
+    auto _max         = 0.0;
+    auto _signals     = uint64_t{ 0 };
+    auto _samples     = uint64_t{ 0 };
+    auto _adjustments = uint64_t{ 0 };
+
+    if(auto* _controllers = controller_instances::get(); _controllers)
+    {
+        for(size_t i = 0; i < _controllers->size(); ++i)
+        {
+            const auto& itr = _controllers->at(i);
+            if(!itr || itr->first == 0 || itr->last <= itr->first) continue;
+
+            auto _elapsed = itr->last - itr->first;
+
+            auto _kept = (itr->timer_signals > 0)
+                             ? (static_cast<double>(itr->timer_samples) /
+                                static_cast<double>(itr->timer_signals))
+                             : 0.0;
+
+            auto _v             = thread_entry{};
+            _v.thread           = static_cast<int64_t>(i);
+            _v.elapsed          = static_cast<double>(_elapsed) / units::sec;
+            _v.handler          = static_cast<double>(itr->cost) / units::sec;
+            _v.overhead         = 100.0 * _v.handler / _v.elapsed;
+            _v.timer_signals    = itr->timer_signals;
+            _v.timer_samples    = itr->timer_samples;
+            _v.overflow_samples = itr->overflow_samples;
+            _v.overflow_period  = itr->period;
+            _v.final_period     = itr->last_period;
+            _v.max_period       = itr->max_period;
+            _v.max_stride       = itr->max_stride;
+            _v.adjustments      = itr->adjustments;
+            if(get_use_sampling_realtime())
+                _v.realtime_freq = _kept * get_sampling_realtime_freq();
+            if(get_use_sampling_cputime())
+                _v.cputime_freq = _kept * get_sampling_cputime_freq();
+
+            _max = std::max(_max, _v.overhead);
+            _signals += _v.timer_signals;
+            _samples += _v.timer_samples;
+            _adjustments += _v.adjustments;
+            _data.emplace_back(_v);
+
+            OMNITRACE_VERBOSE(1,
+                              "sampling overhead :: thread %zu :: %.3f%% :: %zu of %zu "
+                              "timer samples :: overflow period %zu (max %zu)\n",
+                              i, _v.overhead, static_cast<size_t>(_v.timer_samples),
+                              static_cast<size_t>(_v.timer_signals),
+                              static_cast<size_t>(_v.final_period),
+                              static_cast<size_t>(_v.max_period));
+        }
+    }
+
+    OMNITRACE_VERBOSE(1,
+                      "sampling overhead :: %.2f%% budget :: %zu threads :: %.3f%% max "
+                      "overhead :: %zu of %zu timer samples kept :: %zu adjustments\n",
+                      _budget, _data.size(), _max, static_cast<size_t>(_samples),
+                      static_cast<size_t>(_signals), static_cast<size_t>(_adjustments));
+
+    if(_data.empty()) return;
+
+    write_report("sampling-overhead", _budget, _data);
+}
+}  // namespace sampling_overhead
+}  // namespace omnitrace
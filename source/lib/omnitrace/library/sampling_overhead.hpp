@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/defines.hpp"
+
+#include <cstdint>
+
+namespace omnitrace
+{
+namespace sampling_overhead
+{
+/// returns true when sampling is enabled and OMNITRACE_SAMPLING_OVERHEAD > 0
+bool
+is_enabled();
+
+/// allocates the controller of the thread and records the initial period of the
+/// overflow event. Must be called before the sampler of the thread is started
+void
+setup(int64_t _tid);
+
+/// called at the beginning of the sample handler. Returns false when the timer
+/// sample should be skipped to stay within the overhead budget. Does nothing for a
+/// thread which was not set up. Async-signal-safe
+bool
+start(int64_t _tid, int _signo);
+
+/// whether the sample currently being handled by the thread is skipped
+bool
+is_skipped(int64_t _tid);
+
+/// called at the end of the sample handler. Accumulates the time spent in the
+/// handler and adjusts the timer decimation and the overflow period. Async-signal-safe
+void
+stop(int64_t _tid, int _signo);
+
+/// reports the overhead and the effective sampling rates of each thread
+void
+post_process();
+}  // namespace sampling_overhead
+}  // namespace omnitrace
@@ -0,0 +1,272 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "library/throttle.hpp"
+#include "core/config.hpp"
+#include "core/debug.hpp"
+#include "core/locking.hpp"
+#include "core/output.hpp"
+#include "core/timemory.hpp"
+#include "library/thread_data.hpp"
+#include "library/tracing.hpp"
+
+#include <timemory/hash/types.hpp>
+#include <timemory/tpls/cereal/cereal.hpp>
+#include <timemory/units.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omnitrace
+{
+namespace throttle
+{
+namespace
+{
+size_t   throttle_count    = 0;
+uint64_t throttle_duration = 0;
+
+struct region_throttle
+{
+    uint64_t count      = 0;
+    uint64_t total      = 0;
+    uint64_t skipped    = 0;
+    uint32_t skip_depth = 0;
+    bool     throttled  = false;
+};
+
+// the lock is only contended when the regions are merged at finalization while the
+// thread is still pushing or popping regions
+struct thread_throttle
+{
+    using frame_type = std::pair<region_throttle*, uint64_t>;
+
+    std::unordered_map<tim::hash_value_t, region_throttle> regions = {};
+    std::vector<frame_type>                                stack   = {};
+    locking::atomic_mutex                                  mutex   = {};
+};
+
+using thread_throttle_data_t = thread_data<thread_throttle, thread_throttle>;
+
+thread_throttle*
+get_thread_throttle()
+{
+    static thread_local auto* _v =
+        thread_throttle_data_t::instance(construct_on_thread{}).get();
+    return _v;
+}
+
+struct throttled_region
+{
+    std::string name    = {};
+    uint64_t    count   = 0;
+    uint64_t    total   = 0;
+    uint64_t    skipped = 0;
+
+    template <typename ArchiveT>
+    void save(ArchiveT& ar, const unsigned) const
+    {
+        namespace cereal = tim::cereal;
+        ar(cereal::make_nvp("name", name), cereal::make_nvp("count", count),
+           cereal::make_nvp("total_ns", total),
+           cereal::make_nvp("mean_ns", total / std::max<uint64_t>(count, 1)),
+           cereal::make_nvp("skipped", skipped));
+    }
+};
+
+// escapes the regex special characters so that the name can be passed to the
+// --function-exclude option of omnitrace-instrument
+std::string
+regex_escape(const std::string& _v)
+{
+    constexpr std::string_view special = "\\^$.|?*+()[]{}";
+
+    auto _ret = std::string{};
+    _ret.reserve(_v.length());
+    for(auto itr : _v)
+    {
+        if(special.find(itr) != std::string_view::npos) _ret += '\\';
+        _ret += itr;
+    }
+    return _ret;
+}
+}  // namespace
+
+void
+setup()
+{
+    throttle_count    = config::get_throttle_regions_count();
+    throttle_duration = config::get_throttle_regions_mean_duration() * units::usec;
+    is_enabled()      = config::get_throttle_regions();
+}
+
+bool
+push(const char* _name)
+{
+    return push(tim::get_hash_id(std::string_view{ _name }));
+}
+
+bool
+push(tim::hash_value_t _hash)
+{
+    auto* _data  = get_thread_throttle();
+    auto  _lk    = locking::atomic_lock{ _data->mutex };
+    auto& _entry = _data->regions[_hash];
+
+    if(_entry.throttled)
+    {
+        ++_entry.skip_depth;
+        ++_entry.skipped;
+        return true;
+    }
+
+    _data->stack.emplace_back(&_entry, tracing::now());
+    return false;
+}
+
+bool
+pop(const char* _name)
+{
+    return pop(tim::get_hash_id(std::string_view{ _name }));
+}
+
+bool
+pop(tim::hash_value_t _hash)
+{
+    auto  _end   = tracing::now();
+    auto* _data  = get_thread_throttle();
+    auto  _lk    = locking::atomic_lock{ _data->mutex };
+    auto  itr    = _data->regions.find(_hash);
+    auto& _stack = _data->stack;
+
+    if(itr == _data->regions.end()) return false;
+
+    auto& _entry = itr->second;
+
+    // the entry was skipped because the region was throttled
+    if(_entry.skip_depth > 0)
+    {
+        --_entry.skip_depth;
+        return true;
+    }
+
+    // the matching entry is almost always the last one pushed
+    for(size_t i = _stack.size(); i > 0; --i)
+    {
+        if(_stack[i - 1].first != &_entry) continue;
+
+        _entry.count += 1;
+        _entry.total += (_end - _stack[i - 1].second);
+        _stack.erase(_stack.begin() + (i - 1));
+
+        if(_entry.count >= throttle_count &&
+           _entry.total < throttle_duration * _entry.count)
+            _entry.throttled = true;
+        break;
+    }
+
+    return false;
+}
+
+void
+post_process()
+{
+    if(!is_enabled()) return;
+
+    // the throttle stays enabled so that the pops of the regions which were skipped
+    // on the threads which are still running are also skipped
+    auto* _data = thread_throttle_data_t::get();
+    if(!_data) return;
+
+    auto _merged = std::unordered_map<tim::hash_value_t, throttled_region>{};
+    auto _hashes = std::vector<tim::hash_value_t>{};
+    for(const auto& itr : *_data)
+    {
+        if(!itr) continue;
+        auto _lk = locking::atomic_lock{ itr->mutex };
+        for(const auto& ritr : itr->regions)
+        {
+            if(!ritr.second.throttled) continue;
+            if(_merged.find(ritr.first) == _merged.end())
+                _hashes.emplace_back(ritr.first);
+            auto& _entry = _merged[ritr.first];
+            _entry.count += ritr.second.count;
+            _entry.total += ritr.second.total;
+            _entry.skipped += ritr.second.skipped;
+        }
+    }
+
+    auto _throttled = std::vector<throttled_region>{};
+    _throttled.reserve(_merged.size());
+    for(auto itr : _hashes)
+    {
+        auto& _entry = _merged.at(itr);
+        _entry.name  = tim::get_hash_identifier(itr);
+        if(_entry.name.empty()) continue;
+        _throttled.emplace_back(std::move(_entry));
+    }
+
+    std::sort(_throttled.begin(), _throttled.end(),
+              [](const auto& _lhs, const auto& _rhs) {
+                  return _lhs.skipped > _rhs.skipped;
+              });
+
+    OMNITRACE_VERBOSE(1, "throttle :: %zu functions were throttled\n", _throttled.size());
+
+    if(_throttled.empty()) return;
+
+    output::write_text_and_json(
+        "throttled",
+        [&](std::ostream& ofs) {
+            auto _exclude = std::stringstream{};
+            for(const auto& itr : _throttled)
+                _exclude << "|" << regex_escape(itr.name);
+
+            ofs << "# exclude these functions from the instrumentation with:\n"
+                << "#     omnitrace-instrument --function-exclude '^("
+                << _exclude.str().substr(1) << ")$' ...\n";
+            ofs << std::setw(12) << "COUNT"
+                << "  " << std::setw(12) << "MEAN (nsec)"
+                << "  " << std::setw(12) << "SKIPPED"
+                << "  "
+                << "FUNCTION\n";
+            for(const auto& itr : _throttled)
+            {
+                ofs << std::setw(12) << itr.count << "  " << std::setw(12)
+                    << (itr.total / std::max<uint64_t>(itr.count, 1)) << "  "
+                    << std::setw(12) << itr.skipped << "  " << itr.name << "\n";
+            }
+        },
+        [&](output::json_archive_t& ar) {
+            namespace cereal = tim::cereal;
+            ar(cereal::make_nvp("throttled", _throttled));
+        });
+}
+}  // namespace throttle
+}  // namespace omnitrace
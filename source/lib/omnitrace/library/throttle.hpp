@@ -0,0 +1,67 @@
+// MIT License
+//
+// Copyright (c) 2022 Advanced Micro Devices, Inc. All Rights Reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "core/defines.hpp"
+
+#include <timemory/hash/types.hpp>
+
+namespace omnitrace
+{
+namespace throttle
+{
+/// returns true when OMNITRACE_THROTTLE_REGIONS is enabled and the throttle is set up
+inline bool&
+is_enabled()
+{
+    static bool _v = false;
+    return _v;
+}
+
+/// configure the throttle thresholds from the settings
+void
+setup();
+
+/// records the entry of the instrumented function on the calling thread.
+/// Returns true if the function is throttled and should not be recorded
+bool
+push(const char*) OMNITRACE_HOT;
+
+/// same as push(const char*) with the hash of the name, e.g. from a registered region
+bool
+push(tim::hash_value_t) OMNITRACE_HOT;
+
+/// records the exit of the instrumented function on the calling thread.
+/// Returns true if the function is throttled and should not be recorded
+bool
+pop(const char*) OMNITRACE_HOT;
+
+/// same as pop(const char*) with the hash of the name, e.g. from a registered region
+bool
+pop(tim::hash_value_t) OMNITRACE_HOT;
+
+/// reports the throttled functions
+void
+post_process();
+}  // namespace throttle
+}  // namespace omnitrace
@@ -31,6 +31,7 @@
 #include "core/perfetto.hpp"
 #include "core/state.hpp"
 #include "core/timemory.hpp"
+#include "core/timestamp.hpp"
 #include "core/utility.hpp"
 #include "library/causal/sampling.hpp"
 #include "library/runtime.hpp"
@@ -190,7 +191,7 @@ template <typename Tp = uint64_t>
 OMNITRACE_INLINE auto
 now()
 {
-    return ::tim::get_clock_real_now<Tp, std::nano>();
+    return timestamp::now<Tp>();
 }
 
 inline auto&
@@ -24,6 +24,7 @@
 #include "core/categories.hpp"
 #include "core/config.hpp"
 #include "library/components/category_region.hpp"
+#include "library/throttle.hpp"
 #include "library/tracing.hpp"
 
 #if defined(__GNUC__) && (__GNUC__ == 7)
@@ -115,12 +116,14 @@ invoke_category_region_stop(omnitrace_category_t _category, const char* name,
 extern "C" void
 omnitrace_push_trace_hidden(const char* name)
 {
+    if(omnitrace::throttle::is_enabled() && omnitrace::throttle::push(name)) return;
     omnitrace::component::category_region<omnitrace::category::host>::start(name);
 }
 
 extern "C" void
 omnitrace_pop_trace_hidden(const char* name)
 {
+    if(omnitrace::throttle::is_enabled() && omnitrace::throttle::pop(name)) return;
     omnitrace::component::category_region<omnitrace::category::host>::stop(name);
 }
 
@@ -38,13 +38,16 @@ import json
 from pathlib import Path
 
 from . import gui
-from .parser import parse_files, find_causal_files, set_num_stddev
+from .parser import (
+    parse_files,
+    find_causal_files,
+    set_num_stddev,
+    convert_causal_records,
+)
 from . import __version__
 
 
 def causal(args):
-    app = dash.Dash(__name__, external_stylesheets=[dbc.themes.CYBORG])
-
     workload_path = args.path[:]
     input_files = []
 
@@ -53,6 +56,14 @@ def causal(args):
     # unique
     input_files = list(set(input_files))
 
+    if args.convert:
+        json_files = sorted([x for x in input_files if not x.endswith(".coz")])
+        num_records = convert_causal_records(json_files, args.convert)
+        print(f"Wrote {num_records} causal records to '{args.convert}'")
+        return
+
+    app = dash.Dash(__name__, external_stylesheets=[dbc.themes.CYBORG])
+
     set_num_stddev(args.stddev)
     num_speedups = len(args.speedups)
 
@@ -286,6 +297,14 @@ def main():
         default=[],
     )
 
+    my_parser.add_argument(
+        "--convert",
+        metavar="FILE",
+        type=str,
+        default=None,
+        help="Combine the records of the causal profiles into the aggregated JSON layout,\nwrite them to FILE, and exit",
+    )
+
     args = my_parser.parse_args()
 
     causal(args)
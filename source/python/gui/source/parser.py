@@ -573,6 +573,88 @@ def add_latency(df, experiment, value):
     return df
 
 
+class causal_records(object):
+    """Indexed reader for the append-only causal experiments file (*.jsonl).
+
+    Every run of a causal profile appends one line containing a single record. The
+    byte offset of each line is indexed when the file is opened so that individual
+    records can be loaded without parsing the entire history.
+    """
+
+    def __init__(self, filename):
+        self.filename = filename
+        self.offsets = []
+        with open(filename, "rb") as f:
+            offset = 0
+            for line in f:
+                if line.strip():
+                    self.offsets.append(offset)
+                offset += len(line)
+
+    def __len__(self):
+        return len(self.offsets)
+
+    def __getitem__(self, idx):
+        if isinstance(idx, slice):
+            return [self[i] for i in range(*idx.indices(len(self)))]
+        with open(self.filename, "rb") as f:
+            f.seek(self.offsets[idx])
+            return load_causal_record(f.readline())
+
+    def __iter__(self):
+        with open(self.filename, "rb") as f:
+            for offset in self.offsets:
+                f.seek(offset)
+                try:
+                    yield load_causal_record(f.readline())
+                except (ValueError, KeyError) as e:
+                    # a run which was killed while saving leaves a truncated record
+                    sys.stderr.write(
+                        f"Skipping malformed causal record in '{self.filename}' at offset {offset}: {e}\n"
+                    )
+
+    def to_json(self, indices=None):
+        """Returns the records in the layout of the aggregated causal JSON"""
+        if indices is None:
+            return causal_records_to_json(list(self))
+        return causal_records_to_json([self[i] for i in indices])
+
+
+def load_causal_record(line):
+    return json.loads(line)["omnitrace"]["causal"]["record"]
+
+
+def causal_records_to_json(records):
+    return {"omnitrace": {"causal": {"records": records}}}
+
+
+def is_causal_records_file(filename):
+    return filename.endswith(".jsonl")
+
+
+def load_causal_json(filename):
+    """Reads either the append-only records or an aggregated causal JSON file"""
+    if is_causal_records_file(filename):
+        return causal_records(filename).to_json()
+    with open(filename, "r") as f:
+        return json.load(f)
+
+
+def convert_causal_records(input_files, output_file, indent=4):
+    """Writes the records of one or more causal files as one aggregated causal JSON"""
+    records = []
+    for itr in input_files:
+        _data = load_causal_json(itr)
+        if "omnitrace" in _data and "causal" in _data["omnitrace"]:
+            records += _data["omnitrace"]["causal"]["records"]
+
+    with open(output_file, "w") as f:
+        json.dump(causal_records_to_json(records), f, indent=indent)
+        f.write("\n")
+
+    return len(records)
+
+
 def parse_files(
     files,
     experiments=".*",
@@ -587,63 +669,63 @@ def parse_files(
     sample_df = pd.DataFrame()
 
     def name_wo_ext(x):
-        return x.replace(".json", "").replace(".coz", "")
+        return x.replace(".jsonl", "").replace(".json", "").replace(".coz", "")
 
+    jsonl_files = [x for x in filter(lambda y: y.endswith(".jsonl"), files)]
     json_files = [x for x in filter(lambda y: y.endswith(".json"), files)]
     coz_files = [x for x in filter(lambda y: y.endswith(".coz"), files)]
     read_files = []
     file_names = []
 
-    # prefer JSON files first
-    files = json_files + coz_files
+    # prefer the records first, then the (legacy) aggregated JSON, then COZ files
+    files = jsonl_files + json_files + coz_files
     for file in files:
         if verbose >= 3:
             print(f"Potentially reading causal profile: '{file}'...")
 
         _base_name = name_wo_ext(file)
-        # do not read in a COZ file if the JSON already read
+        # do not read in a JSON or COZ file if the records were already read
         if _base_name in read_files:
             continue
 
         if verbose >= 3 or (verbose >= 1 and not cli):
             print(f"Reading causal profile: '{file}'...")
 
-        if file.endswith(".json"):
-            with open(file, "r") as j:
-                _data = json.load(j)
-                dict_data = {}
-                # make sure the JSON is an omnitrace causal JSON
-                if "omnitrace" not in _data or "causal" not in _data["omnitrace"]:
-                    continue
-                dict_data[file] = process_data({}, _data, experiments, progress_points)
-                samps = process_samples({}, _data)
-                sample_df = pd.concat(
-                    [
-                        sample_df,
-                        pd.DataFrame(
-                            [
-                                {"location": loc, "count": count}
-                                for loc, count in sorted(samps.items())
-                            ]
-                        ),
-                    ]
-                )
-                result_df = pd.concat(
-                    [
-                        result_df,
-                        compute_sorts(
-                            compute_speedups(
-                                dict_data,
-                                speedups,
-                                num_points,
-                                validate,
-                                verbose >= 3 or cli,
-                            )
-                        ),
-                    ]
-                )
-                read_files.append(_base_name)
-                file_names.append(file)
+        if file.endswith(".jsonl") or file.endswith(".json"):
+            _data = load_causal_json(file)
+            dict_data = {}
+            # make sure the JSON is an omnitrace causal JSON
+            if "omnitrace" not in _data or "causal" not in _data["omnitrace"]:
+                continue
+            dict_data[file] = process_data({}, _data, experiments, progress_points)
+            samps = process_samples({}, _data)
+            sample_df = pd.concat(
+                [
+                    sample_df,
+                    pd.DataFrame(
+                        [
+                            {"location": loc, "count": count}
+                            for loc, count in sorted(samps.items())
+                        ]
+                    ),
+                ]
+            )
+            result_df = pd.concat(
+                [
+                    result_df,
+                    compute_sorts(
+                        compute_speedups(
+                            dict_data,
+                            speedups,
+                            num_points,
+                            validate,
+                            verbose >= 3 or cli,
+                        )
+                    ),
+                ]
+            )
+            read_files.append(_base_name)
+            file_names.append(file)
 
         elif file.endswith(".coz"):
             try:
@@ -714,7 +796,12 @@ def parse_uploaded_file(file_name, file, experiments=".*", progress_points=".*")
     data = pd.DataFrame()
     if "{" in file:
         dict_data = {}
-        _data = json.loads(file)
+        if is_causal_records_file(file_name):
+            _data = causal_records_to_json(
+                [load_causal_record(x) for x in file.split("\n") if x.strip()]
+            )
+        else:
+            _data = json.loads(file)
 
         dict_data = {
             file_name: process_data(dict_data, _data, experiments, progress_points)
@@ -827,7 +914,9 @@ def find_causal_files(workload_path, verbose, recursive):
     def find_causal_files_helper(inp, _files):
         _input_files_tmp = []
         for itr in _files:
-            if os.path.isfile(itr) and itr.endswith(".json"):
+            if os.path.isfile(itr) and is_causal_records_file(itr):
+                _input_files_tmp += [itr]
+            elif os.path.isfile(itr) and itr.endswith(".json"):
                 with open(itr, "r") as f:
                     inp_data = json.load(f)
                     if (
@@ -90,3 +90,31 @@ else()
         LABELS "annotate"
         ARGS --key-names thread_cpu_clock --key-counts 6)
 endif()
+
+# combines the traces of the annotate tests with omnitrace-merge-perfetto
+if(TARGET omnitrace-merge-perfetto AND TEST annotate-binary-rewrite-run)
+    set(_merge_perfetto_dir ${PROJECT_BINARY_DIR}/omnitrace-tests-output)
+
+    add_test(
+        NAME annotate-merge-perfetto
+        COMMAND
+            ${CMAKE_CURRENT_LIST_DIR}/run-omnitrace-merge-perfetto.sh
+            $<TARGET_FILE:omnitrace-merge-perfetto>
+            ${_merge_perfetto_dir}/annotate-merge-perfetto/perfetto-trace.proto
+            ${_merge_perfetto_dir}/annotate-binary-rewrite/perfetto-trace.proto
+            ${_merge_perfetto_dir}/annotate-sampling/perfetto-trace.proto
+        WORKING_DIRECTORY ${PROJECT_BINARY_DIR})
+
+    set_tests_properties(
+        annotate-merge-perfetto
+        PROPERTIES TIMEOUT
+                   120
+                   LABELS
+                   "annotate"
+                   DEPENDS
+                   "annotate-binary-rewrite-run;annotate-sampling"
+                   PASS_REGULAR_EXPRESSION
+                   "combined trace .*/perfetto-trace.proto is [1-9][0-9]* bytes"
+                   FAIL_REGULAR_EXPRESSION
+                   "Error!")
+endif()
@@ -17,3 +17,22 @@ omnitrace_add_test(
     SAMPLING_FAIL_REGEX "(${OMNITRACE_ABORT_FAIL_REGEX})"
     RUNTIME_FAIL_REGEX "(${OMNITRACE_ABORT_FAIL_REGEX})"
     REWRITE_RUN_FAIL_REGEX "(${OMNITRACE_ABORT_FAIL_REGEX})")
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+    NAME fork-child-profiling
+    TARGET fork-example
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_SAMPLING_FREQ=250;OMNITRACE_SAMPLING_REALTIME=ON;OMNITRACE_FORK_CHILD_PROFILING=ON"
+    SAMPLING_PASS_REGEX "finalizing child process [0-9]+"
+    SAMPLING_FAIL_REGEX "(${OMNITRACE_ABORT_FAIL_REGEX})")
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+    NAME fork-child-profiling-quick-exit
+    TARGET fork-example
+    RUN_ARGS 4 1 _exit
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_SAMPLING_FREQ=250;OMNITRACE_SAMPLING_REALTIME=ON;OMNITRACE_FORK_CHILD_PROFILING=ON"
+    SAMPLING_PASS_REGEX "finalizing child process [0-9]+"
+    SAMPLING_FAIL_REGEX "(${OMNITRACE_ABORT_FAIL_REGEX})")
@@ -52,3 +52,129 @@ omnitrace_add_test(
     ENVIRONMENT
         "${_lock_environment};OMNITRACE_FLAT_PROFILE=ON;OMNITRACE_PROFILE=OFF;OMNITRACE_TRACE=ON;OMNITRACE_SAMPLING_KEEP_INTERNAL=OFF"
     )
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_SAMPLING
+    NAME parallel-overhead-jobs
+    TARGET parallel-overhead
+    LABELS "function-include"
+    REWRITE_ARGS
+        -e
+        -v
+        2
+        -j
+        4
+        --function-include
+        "^fib$"
+        "^run$"
+        --print-instrumented
+        functions
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT "${_base_environment}"
+    REWRITE_PASS_REGEX
+        "\\[function\\]\\[Forcing\\] function-include-regex :: 'fib'.*\\[function\\]\\[Forcing\\] function-include-regex :: 'run'"
+    )
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_SAMPLING
+    NAME parallel-overhead-flat-aggregator
+    TARGET parallel-overhead
+    REWRITE_ARGS -e -v 2 --min-instructions=8
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_PROFILE=ON;OMNITRACE_TRACE=OFF;OMNITRACE_PROFILE_BACKEND=flat;OMNITRACE_PROFILE_FLAT_EDGES=ON"
+    REWRITE_RUN_PASS_REGEX "/flat-profile.txt")
+
+# at least one region must have a nonzero count and inclusive time and an edge must be
+# recorded
+omnitrace_add_output_test(
+    NAME parallel-overhead-flat-aggregator-binary-rewrite
+    FILE flat-profile.txt
+    PASS_REGEX " [1-9][0-9]* +(0\\.[0-9]*[1-9]|[1-9])[0-9.]* .* -> ")
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME
+    NAME parallel-overhead-timestamp-counter
+    TARGET parallel-overhead
+    REWRITE_ARGS -e -v 2 --min-instructions=8
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_VERBOSE=1;OMNITRACE_TIMESTAMP_SOURCE=counter"
+    SAMPLING_PASS_REGEX "Timestamp counter drift|not supported on this CPU"
+    REWRITE_RUN_PASS_REGEX "Timestamp counter drift|not supported on this CPU")
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_SAMPLING
+    NAME parallel-overhead-event-log
+    TARGET parallel-overhead
+    REWRITE_ARGS -e -v 2 --min-instructions=8
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_TRACE=ON;OMNITRACE_PROFILE=OFF;OMNITRACE_TRACE_BACKEND=event-log;OMNITRACE_EVENT_LOG_BUFFER_SIZE=1024"
+    REWRITE_RUN_PASS_REGEX "/perfetto-trace.proto")
+
+# the host slices are only written by the event log post-processing
+omnitrace_add_validation_test(
+    NAME parallel-overhead-event-log-binary-rewrite
+    PERFETTO_METRIC "host"
+    PERFETTO_FILE "perfetto-trace.proto"
+    LABELS "event-log"
+    ARGS -l parallel-overhead-event-log.inst -c 1 -d 0)
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+    NAME parallel-overhead-heap-profile
+    TARGET parallel-overhead
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_HEAP_PROFILE=ON;OMNITRACE_HEAP_PROFILE_INTERVAL=64"
+    SAMPLING_PASS_REGEX "/heap-profile.txt")
+
+# at least one allocation site must have sampled allocations with a nonzero size
+omnitrace_add_output_test(
+    NAME parallel-overhead-heap-profile-sampling
+    FILE heap-profile.txt
+    PASS_REGEX "\n +[1-9][0-9]* +[0-9]+ +[1-9][0-9]* ")
+
+# produces the flat profile and then instruments from it within the same test
+if(TARGET parallel-overhead)
+    add_test(
+        NAME parallel-overhead-profile-guided
+        COMMAND
+            ${CMAKE_CURRENT_LIST_DIR}/run-omnitrace-profile-guided.sh
+            $<TARGET_FILE:omnitrace-instrument> $<TARGET_FILE:omnitrace-run>
+            ${PROJECT_BINARY_DIR}/omnitrace-tests-output/parallel-overhead-profile-guided 5
+            -- $<TARGET_FILE:parallel-overhead> 10 ${NUM_THREADS} 1000
+        WORKING_DIRECTORY ${PROJECT_BINARY_DIR})
+
+    set_tests_properties(
+        parallel-overhead-profile-guided
+        PROPERTIES ENVIRONMENT
+                   "${_base_environment};OMNITRACE_CI=ON"
+                   TIMEOUT
+                   300
+                   LABELS
+                   "parallel-overhead;binary-rewrite"
+                   PASS_REGULAR_EXPRESSION
+                   "profile-guided :: selected [1-9][0-9]* of [1-9][0-9]* functions"
+                   FAIL_REGULAR_EXPRESSION
+                   "${OMNITRACE_ABORT_FAIL_REGEX}"
+                   RUN_SERIAL
+                   ON)
+endif()
+
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_RUNTIME SKIP_SAMPLING
+    NAME parallel-overhead-throttle
+    TARGET parallel-overhead
+    REWRITE_ARGS -e -v 2 --min-instructions=8
+    RUN_ARGS 10 ${NUM_THREADS} 1000
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_THROTTLE_REGIONS=ON;OMNITRACE_THROTTLE_REGIONS_COUNT=100;OMNITRACE_THROTTLE_REGIONS_MEAN_DURATION=1000"
+    REWRITE_RUN_PASS_REGEX "/throttled.txt")
+
+# at least one function must have been skipped after it was throttled
+omnitrace_add_output_test(
+    NAME parallel-overhead-throttle-binary-rewrite
+    FILE throttled.txt
+    PASS_REGEX "--function-exclude .* [1-9][0-9]* +[0-9]+ +[1-9][0-9]* ")
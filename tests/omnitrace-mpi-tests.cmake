@@ -77,6 +77,22 @@ omnitrace_add_test(
         ">>> mpi-flat.inst(.*\n.*)>>> MPI_Init_thread(.*\n.*)>>> pthread_create(.*\n.*)>>> MPI_Comm_size(.*\n.*)>>> MPI_Comm_rank(.*\n.*)>>> MPI_Barrier(.*\n.*)>>> MPI_Alltoall"
     )
 
+# only rank 0 outputs the combined trace. Rank 1 outputs its own trace when the
+# traces are not combined
+omnitrace_add_test(
+    SKIP_RUNTIME SKIP_SAMPLING
+    NAME "mpi-combine-perfetto"
+    TARGET mpi-example
+    MPI ON
+    NUM_PROCS 2
+    REWRITE_ARGS -e -v 2 --min-instructions 0
+    ENVIRONMENT
+        "${_base_environment};OMNITRACE_VERBOSE=1;OMNITRACE_PERFETTO_COMBINE_TRACES=ON;OMNITRACE_PERFETTO_COMBINE_METHOD=mpi-io"
+    REWRITE_RUN_PASS_REGEX "/perfetto-trace-0.proto"
+    REWRITE_RUN_FAIL_REGEX
+        "/perfetto-trace-1.proto|combining the perfetto traces via MPI-IO failed|perfetto-trace[-0-9]*.rank-[0-9]+.proto|${OMNITRACE_ABORT_FAIL_REGEX}"
+    )
+
 set(_mpip_environment
     "OMNITRACE_TRACE=ON"
     "OMNITRACE_PROFILE=ON"
@@ -120,3 +136,23 @@ foreach(_EXAMPLE all2all allgather allreduce bcast reduce scatter-gather send-re
         RUN_ARGS 30
         ENVIRONMENT "${_mpip_${_EXAMPLE}_environment}")
 endforeach()
+
+omnitrace_add_test(
+    SKIP_RUNTIME SKIP_SAMPLING
+    NAME "mpi-send-recv-wait-states"
+    TARGET mpi-send-recv
+    MPI ON
+    NUM_PROCS 2
+    LABELS "mpip"
+    REWRITE_ARGS -e -v 2 --min-instructions 0
+    RUN_ARGS 30
+    ENVIRONMENT "${_mpip_environment};OMNITRACE_MPI_WAIT_STATES=ON"
+    REWRITE_RUN_PASS_REGEX "/mpi-wait-states-0.txt"
+    REWRITE_RUN_FAIL_REGEX
+        "Error opening mpi-wait-states output file|${OMNITRACE_ABORT_FAIL_REGEX}")
+
+# each rank receives before the other rank sends so the wait must be nonzero
+omnitrace_add_output_test(
+    NAME mpi-send-recv-wait-states-binary-rewrite
+    FILE mpi-wait-states-0.txt
+    PASS_REGEX "late-sender +[0-9]+ +[1-9][0-9]* +(0\\.[0-9]*[1-9]|[1-9])")
@@ -6,8 +6,12 @@
 
 if(OMNITRACE_OPENMP_USING_LIBOMP_LIBRARY AND OMNITRACE_USE_OMPT)
     set(_OMPT_PASS_REGEX "\\|_ompt_")
+    set(_OMPT_PARALLEL_PASS_REGEX "\\|_ompt_implicit_task")
+    set(_OMPT_PARALLEL_FAIL_REGEX "\\|_ompt_(work|sync_region)")
 else()
     set(_OMPT_PASS_REGEX "")
+    set(_OMPT_PARALLEL_PASS_REGEX "")
+    set(_OMPT_PARALLEL_FAIL_REGEX "")
 endif()
 
 omnitrace_add_test(
@@ -23,6 +27,18 @@ omnitrace_add_test(
     RUNTIME_PASS_REGEX "${_OMPT_PASS_REGEX}"
     REWRITE_FAIL_REGEX "0 instrumented loops in procedure")
 
+omnitrace_add_test(
+    SKIP_BASELINE SKIP_REWRITE
+    NAME openmp-cg-ompt-parallel
+    TARGET openmp-cg
+    LABELS "openmp"
+    RUNTIME_ARGS -e -v 1 --label return args
+    RUNTIME_TIMEOUT 360
+    ENVIRONMENT
+        "${_ompt_environment};OMNITRACE_OMPT_CALLBACKS=parallel;OMNITRACE_USE_SAMPLING=OFF;OMNITRACE_COUT_OUTPUT=ON"
+    RUNTIME_PASS_REGEX "${_OMPT_PARALLEL_PASS_REGEX}"
+    RUNTIME_FAIL_REGEX "${_OMPT_PARALLEL_FAIL_REGEX}")
+
 omnitrace_add_test(
     SKIP_RUNTIME
     NAME openmp-lu
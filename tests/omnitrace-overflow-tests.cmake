@@ -29,4 +29,94 @@ if(omnitrace_perf_event_paranoid LESS_EQUAL 3
         SAMPLING_PASS_REGEX "sampling_wall_clock.txt"
         RUNTIME_PASS_REGEX "sampling_wall_clock.txt"
         REWRITE_RUN_PASS_REGEX "sampling_wall_clock.txt")
+
+    # requires Intel PEBS (mem-loads) or AMD IBS
+    if(EXISTS /sys/bus/event_source/devices/cpu/events/mem-loads
+       OR EXISTS /sys/bus/event_source/devices/cpu_core/events/mem-loads
+       OR EXISTS /sys/bus/event_source/devices/ibs_op/type)
+        omnitrace_add_test(
+            SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+            NAME overflow-memory
+            TARGET parallel-overhead
+            RUN_ARGS 30 2 200
+            ENVIRONMENT
+                "${_overflow_environment};OMNITRACE_SAMPLING_MEMORY=ON;OMNITRACE_SAMPLING_MEMORY_ALLOCATION_SIZE=4096"
+            LABELS "perf;overflow;numa"
+            SAMPLING_PASS_REGEX "/memory-locality.txt")
+
+        # at least one function must have memory access samples
+        omnitrace_add_output_test(
+            NAME overflow-memory-sampling
+            FILE memory-locality.txt
+            PASS_REGEX "\n +[1-9][0-9]* +[0-9.]+ +[0-9.]+ ")
+    endif()
+
+    omnitrace_add_test(
+        SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+        NAME overflow-branch
+        TARGET parallel-overhead
+        RUN_ARGS 30 2 200
+        ENVIRONMENT
+            "${_overflow_environment};OMNITRACE_SAMPLING_OVERFLOW_EVENT=PERF_COUNT_HW_CPU_CYCLES;OMNITRACE_SAMPLING_BRANCH=ON"
+        LABELS "perf;overflow"
+        # the report is only written when taken branches were recorded
+        SAMPLING_PASS_REGEX
+            "/branch-profile.txt|branch-record sampling is not available")
+
+    omnitrace_add_test(
+        SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+        NAME overflow-overhead
+        TARGET parallel-overhead
+        RUN_ARGS 30 2 200
+        ENVIRONMENT "${_overflow_environment};OMNITRACE_SAMPLING_OVERHEAD=0.05"
+        LABELS "perf;overflow"
+        SAMPLING_PASS_REGEX "/sampling-overhead.txt")
+
+    # at least one thread must have kept timer samples
+    omnitrace_add_output_test(
+        NAME overflow-overhead-sampling
+        FILE sampling-overhead.txt
+        PASS_REGEX "# overhead budget: .*\n +[0-9]+ +[0-9.]+ +[0-9.]+ +[1-9][0-9]* ")
+endif()
+
+if(omnitrace_perf_event_paranoid LESS_EQUAL 1
+   OR omnitrace_cap_sys_admin EQUAL 0
+   OR omnitrace_cap_perfmon EQUAL 0)
+    omnitrace_add_test(
+        SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+        NAME overflow-offcpu
+        TARGET parallel-overhead
+        RUN_ARGS 30 2 200
+        ENVIRONMENT
+            "${_base_environment};OMNITRACE_SAMPLING_CPUTIME=ON;OMNITRACE_SAMPLING_OFFCPU=ON"
+        LABELS "perf;offcpu"
+        SAMPLING_PASS_REGEX "/sampling_wall_clock.txt")
+
+    # the blocked time is attributed to the off-CPU leaf of the call-stacks
+    omnitrace_add_output_test(
+        NAME overflow-offcpu-sampling
+        FILE sampling_wall_clock.txt
+        PASS_REGEX "\\[off-cpu(: preempted)?\\]")
+endif()
+
+if(omnitrace_perf_event_paranoid LESS_EQUAL 2
+   OR omnitrace_cap_sys_admin EQUAL 0
+   OR omnitrace_cap_perfmon EQUAL 0)
+    omnitrace_add_test(
+        SKIP_BASELINE SKIP_RUNTIME SKIP_REWRITE
+        NAME sampling-perf-events
+        TARGET parallel-overhead
+        RUN_ARGS 30 2 200
+        ENVIRONMENT
+            "${_base_environment};OMNITRACE_SAMPLING_CPUTIME=ON;OMNITRACE_SAMPLING_PERF_EVENTS=PERF_COUNT_SW_PAGE_FAULTS PERF_COUNT_SW_CONTEXT_SWITCHES PERF_COUNT_HW_INSTRUCTIONS"
+        LABELS "perf")
+
+    # the software events are always available so the samples must be annotated with
+    # their values
+    omnitrace_add_validation_test(
+        NAME sampling-perf-events-sampling
+        PERFETTO_FILE "perfetto-trace.proto"
+        LABELS "perf"
+        ARGS --key-names PERF_COUNT_SW_PAGE_FAULTS PERF_COUNT_SW_CONTEXT_SWITCHES
+             --key-min-counts 1 1)
 endif()
@@ -32,3 +32,20 @@ omnitrace_add_test(
     REWRITE_RUN_PASS_REGEX
         "start_thread (.*) 4 (.*) pthread_mutex_lock (.*) 4000 (.*) pthread_mutex_unlock (.*) 4000"
     )
+
+omnitrace_add_test(
+    SKIP_RUNTIME SKIP_SAMPLING
+    NAME parallel-overhead-locks-contention
+    TARGET parallel-overhead-locks
+    LABELS "locks"
+    REWRITE_ARGS -e -i 256
+    RUN_ARGS 10 4 1000
+    ENVIRONMENT
+        "${_lock_environment};OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION=ON;OMNITRACE_TRACE_THREAD_LOCKS_CONTENTION_THRESHOLD=1;OMNITRACE_PROFILE=OFF;OMNITRACE_TRACE=ON"
+    REWRITE_RUN_PASS_REGEX "/lock-contention.txt")
+
+# at least one lock must have a nonzero count and total wait
+omnitrace_add_output_test(
+    NAME parallel-overhead-locks-contention-binary-rewrite
+    FILE lock-contention.txt
+    PASS_REGEX "0x[0-9a-f]+ +([^ ]+ +)?[1-9][0-9]* +[1-9][0-9]* ")
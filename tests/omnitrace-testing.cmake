@@ -1018,3 +1018,74 @@ function(OMNITRACE_ADD_VALIDATION_TEST)
                        ${TEST_PROPERTIES})
     endforeach()
 endfunction()
+
+# -------------------------------------------------------------------------------------- #
+#
+# Output file content test function
+#
+# -------------------------------------------------------------------------------------- #
+
+if(CMAKE_VERSION VERSION_LESS "3.18.0")
+    find_program(
+        OMNITRACE_CAT_EXE
+        NAMES cat
+        PATH_SUFFIXES bin)
+
+    if(OMNITRACE_CAT_EXE)
+        set(OMNITRACE_OUTPUT_CAT_COMMAND ${OMNITRACE_CAT_EXE})
+    endif()
+else()
+    set(OMNITRACE_OUTPUT_CAT_COMMAND ${CMAKE_COMMAND} -E cat)
+endif()
+
+function(OMNITRACE_ADD_OUTPUT_TEST)
+
+    if(NOT OMNITRACE_OUTPUT_CAT_COMMAND)
+        return()
+    endif()
+
+    cmake_parse_arguments(TEST "" "NAME;FILE;TIMEOUT"
+                          "LABELS;PROPERTIES;PASS_REGEX;FAIL_REGEX;SKIP_REGEX" ${ARGN})
+
+    if(NOT TEST "${TEST_NAME}")
+        omnitrace_message(
+            AUTHOR_WARNING
+            "No output test(s) for ${TEST_NAME} because test does not exist")
+        return()
+    endif()
+
+    if(NOT TEST_TIMEOUT)
+        set(TEST_TIMEOUT 30)
+    endif()
+
+    set(TEST_DEPENDS "${TEST_NAME}")
+    if("${TEST_NAME}" MATCHES "-binary-rewrite$")
+        list(APPEND TEST_DEPENDS "${TEST_NAME}-run")
+    endif()
+
+    get_filename_component(_LABEL "${TEST_FILE}" NAME_WE)
+    list(APPEND TEST_LABELS "check-output")
+
+    set(_TEST check-${TEST_NAME}-${_LABEL})
+    add_test(
+        NAME ${_TEST}
+        COMMAND ${OMNITRACE_OUTPUT_CAT_COMMAND}
+                ${PROJECT_BINARY_DIR}/omnitrace-tests-output/${TEST_NAME}/${TEST_FILE}
+        WORKING_DIRECTORY ${PROJECT_BINARY_DIR})
+
+    set_tests_properties(
+        ${_TEST}
+        PROPERTIES TIMEOUT
+                   ${TEST_TIMEOUT}
+                   LABELS
+                   "${TEST_LABELS}"
+                   DEPENDS
+                   "${TEST_DEPENDS}"
+                   PASS_REGULAR_EXPRESSION
+                   "${TEST_PASS_REGEX}"
+                   FAIL_REGULAR_EXPRESSION
+                   "${TEST_FAIL_REGEX}"
+                   SKIP_REGULAR_EXPRESSION
+                   "${TEST_SKIP_REGEX}"
+                   ${TEST_PROPERTIES})
+endfunction()
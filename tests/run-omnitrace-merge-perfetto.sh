@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+# usage: run-omnitrace-merge-perfetto.sh <omnitrace-merge-perfetto> <output>
+#            <inputs...>
+#
+# combines the perfetto traces of <inputs...> into <output> and verifies that the
+# combined trace is the concatenation of the inputs
+
+set -e
+
+OMNITRACE_MERGE_PERFETTO=${1}
+OUTPUT=${2}
+shift 2
+
+EXPECTED=0
+for i in ${@}; do
+    if [ ! -s ${i} ]; then
+        echo "Error! input trace ${i} does not exist or is empty"
+        exit 1
+    fi
+    EXPECTED=$((EXPECTED + $(stat -c %s ${i})))
+done
+
+rm -f ${OUTPUT}
+
+${OMNITRACE_MERGE_PERFETTO} --verbose --validate -o ${OUTPUT} -i ${@}
+
+if [ ! -s ${OUTPUT} ]; then
+    echo "Error! ${OUTPUT} was not produced"
+    exit 1
+fi
+
+SIZE=$(stat -c %s ${OUTPUT})
+if [ ${SIZE} -ne ${EXPECTED} ]; then
+    echo "Error! ${OUTPUT} is ${SIZE} bytes, expected ${EXPECTED} bytes"
+    exit 1
+fi
+
+echo "combined trace ${OUTPUT} is ${SIZE} bytes"
@@ -0,0 +1,47 @@
+#!/bin/bash
+#
+# usage: run-omnitrace-profile-guided.sh <omnitrace-instrument> <omnitrace-run>
+#            <output-dir> <budget> -- <target> <args...>
+#
+# instruments <target> with the flat profile backend, runs it to produce
+# flat-profile.json, and then instruments <target> again with the functions selected
+# from that profile
+
+set -e
+
+OMNITRACE_INSTRUMENT=${1}
+OMNITRACE_RUN=${2}
+OUTPUT_DIR=${3}
+BUDGET=${4}
+shift 4
+
+if [ "${1}" == "--" ]; then
+    shift
+fi
+
+TARGET=${1}
+shift
+
+mkdir -p ${OUTPUT_DIR}
+rm -f ${OUTPUT_DIR}/profile/flat-profile.json
+
+${OMNITRACE_INSTRUMENT} -o ${OUTPUT_DIR}/profile.inst -e -v 1 --min-instructions=8 \
+    -- ${TARGET}
+
+OMNITRACE_PROFILE=ON \
+OMNITRACE_TRACE=OFF \
+OMNITRACE_PROFILE_BACKEND=flat \
+OMNITRACE_USE_PID=OFF \
+OMNITRACE_TIME_OUTPUT=OFF \
+OMNITRACE_OUTPUT_PATH=${OUTPUT_DIR} \
+OMNITRACE_OUTPUT_PREFIX=profile/ \
+    ${OMNITRACE_RUN} -- ${OUTPUT_DIR}/profile.inst ${@}
+
+if [ ! -s ${OUTPUT_DIR}/profile/flat-profile.json ]; then
+    echo "Error! ${OUTPUT_DIR}/profile/flat-profile.json was not produced"
+    exit 1
+fi
+
+${OMNITRACE_INSTRUMENT} -o ${OUTPUT_DIR}/profile-guided.inst -e -v 2 \
+    --profile-guided ${OUTPUT_DIR}/profile/flat-profile.json \
+    --overhead-budget ${BUDGET} -- ${TARGET}
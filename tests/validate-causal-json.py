@@ -488,7 +488,21 @@ def main():
     samp = {}
     for inp in args.input:
         with open(inp, "r") as f:
-            inp_data = json.load(f)
+            if inp.endswith(".jsonl"):
+                # append-only records: one record per line
+                inp_data = {
+                    "omnitrace": {
+                        "causal": {
+                            "records": [
+                                json.loads(x)["omnitrace"]["causal"]["record"]
+                                for x in f
+                                if x.strip()
+                            ]
+                        }
+                    }
+                }
+            else:
+                inp_data = json.load(f)
         data = process_data(data, inp_data, args)
         samp = process_samples(samp, inp_data)
 
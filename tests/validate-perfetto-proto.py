@@ -85,6 +85,13 @@ if __name__ == "__main__":
         default=[],
         nargs="*",
     )
+    parser.add_argument(
+        "--key-min-counts",
+        type=int,
+        help="Minimum number of debug args (used instead of --key-counts)",
+        default=[],
+        nargs="*",
+    )
 
     args = parser.parse_args()
 
@@ -143,7 +150,9 @@ if __name__ == "__main__":
         print(f"{e}")
         ret = 1
 
-    for key_name, key_count in zip(args.key_names, args.key_counts):
+    key_min = len(args.key_min_counts) > 0
+    key_counts = args.key_min_counts if key_min else args.key_counts
+    for key_name, key_count in zip(args.key_names, key_counts):
         slice_args = tp.query(
             f"select * from slice join args using (arg_set_id) where key='debug.{key_name}'"
         )
@@ -155,9 +164,14 @@ if __name__ == "__main__":
             if args.print:
                 for key, val in row.__dict__.items():
                     print(f"  - {key:20} :: {val}")
-        print(f"Number of entries with {key_name} = {count} (expected: {key_count})")
-        if key_count != count:
-            ret = 1
+        if key_min:
+            print(f"Number of entries with {key_name} = {count} (minimum: {key_count})")
+            if count < key_count:
+                ret = 1
+        else:
+            print(f"Number of entries with {key_name} = {count} (expected: {key_count})")
+            if key_count != count:
+                ret = 1
 
     if ret == 0:
         print(f"{args.input} validated")